@@ -0,0 +1,94 @@
+/*
+ * Region allocator. Blocks form a list; allocation bumps within the current
+ * block and moves on to the next one (allocating it only if the list has
+ * run out). Resetting rewinds to the first block, so an arena that is reset
+ * after every query stops calling malloc once it has grown to fit the
+ * largest query.
+ */
+
+#include <stdlib.h>
+#include <assert.h>
+#include "arena.h"
+
+// alignment of every allocation, enough for any of the tree's types
+typedef union arena_align {
+    long double d;
+    long long l;
+    void* p;
+} arena_align_t;
+#define ARENA_ALIGN sizeof(arena_align_t)
+
+/* allocate a block of at least size bytes */
+arena_block_t* init_block(size_t size);
+
+/* initialize an arena whose blocks are block_size bytes */
+arena_t* init_arena(size_t block_size) {
+    assert(block_size > 0);
+    arena_t* arena = (arena_t*) malloc(sizeof(arena_t));
+    assert(arena);
+    arena->block_size = block_size;
+    arena->head = init_block(block_size);
+    arena->current = arena->head;
+    return arena;
+}
+
+/* allocate a block */
+arena_block_t* init_block(size_t size) {
+    arena_block_t* block = (arena_block_t*) malloc(sizeof(arena_block_t));
+    assert(block);
+    block->data = (unsigned char*) malloc(size);
+    assert(block->data);
+    block->next = NULL;
+    block->size = size;
+    block->used = 0;
+    return block;
+}
+
+/* allocate size bytes from the arena, aligned for any of the tree's types */
+void* arena_alloc(arena_t* arena, size_t size) {
+    assert(arena);
+    size = (size + ARENA_ALIGN - 1) / ARENA_ALIGN * ARENA_ALIGN;
+    arena_block_t* block = arena->current;
+    // move on to the next block that fits, making one if there is none
+    while (block->used + size > block->size) {
+        if (block->next == NULL) {
+            size_t bytes = (size > arena->block_size) ? size : arena->block_size;
+            block->next = init_block(bytes);
+        }
+        block = block->next;
+        block->used = 0;
+    }
+    arena->current = block;
+    void* memory = block->data + block->used;
+    block->used += size;
+    return memory;
+}
+
+/* release everything allocated so far, keeping the blocks for reuse */
+void arena_reset(arena_t* arena) {
+    assert(arena);
+    arena->current = arena->head;
+    arena->head->used = 0;
+}
+
+/* bytes reserved by the arena's blocks */
+size_t arena_bytes(arena_t* arena) {
+    assert(arena);
+    size_t bytes = 0;
+    for (arena_block_t* block = arena->head; block != NULL; block = block->next)
+        bytes += block->size;
+    return bytes;
+}
+
+/* free the arena along with everything allocated from it */
+void free_arena(arena_t* arena) {
+    assert(arena);
+    arena_block_t* block = arena->head;
+    while (block != NULL) {
+        arena_block_t* next = block->next;
+        free(block->data);
+        free(block);
+        block = next;
+    }
+    free(arena);
+}
@@ -0,0 +1,37 @@
+/*
+ * Arena header: a region allocator handing out memory from large blocks
+ * by bumping a pointer. Nothing is freed individually; the whole arena is
+ * either reset (keeping its blocks for reuse) or freed at once.
+ */
+
+#include <stddef.h>
+
+#ifndef QTREE_SELF_IMPLEMENTATION_ARENA_H
+#define QTREE_SELF_IMPLEMENTATION_ARENA_H
+
+#define ARENA_BLOCK_SIZE 65536  // default size of an arena block, in bytes
+#define ARENA_SCRATCH_SIZE 1024 // block size of a per-query scratch arena
+
+// structures
+typedef struct arena_block arena_block_t;
+struct arena_block {
+    arena_block_t* next;
+    size_t size;
+    size_t used;
+    unsigned char* data;
+};
+
+typedef struct arena {
+    arena_block_t* head;
+    arena_block_t* current;
+    size_t block_size;
+} arena_t;
+
+// function prototypes
+arena_t* init_arena(size_t block_size);
+void* arena_alloc(arena_t* arena, size_t size);
+void arena_reset(arena_t* arena);
+size_t arena_bytes(arena_t* arena);
+void free_arena(arena_t* arena);
+
+#endif //QTREE_SELF_IMPLEMENTATION_ARENA_H
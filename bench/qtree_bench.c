@@ -0,0 +1,696 @@
+/*
+ * Benchmark suite - times tree building, point lookups and range queries
+ * over the footpath datasets and larger synthetic sets derived from them,
+ * and writes the results to stdout as JSON:
+ *   ./qtree_bench [data directory] [synthetic size ...]
+ * Point lookups replay the stage 3 query files (test1-8.s3.in) and range
+ * queries replay the windows of test12, test13 and test14.s4.in, from the
+ * narrowest to the widest. Every point of a footpath (start and end) is
+ * inserted, as in stages 3 and 4. The generic/ workloads repeat the same
+ * over a qtree_generic.h instance holding BENCH_CAPACITY points per leaf.
+ * The frontier/ workloads run the range windows breadth-first (see
+ * range_frontier), the cached/ workloads repeat them through a range cache
+ * (see cache.h), the frozen/ workloads run over the tree once frozen (see
+ * frozen.h) and the compressed/ workloads over a compressed tree (see
+ * compressed.h). The rcu/ workloads look points up in an RCU tree (see
+ * rcu.h), idle and then while a writer thread keeps inserting into it.
+ * locked/build inserts every point with one writer per core (see locked.h),
+ * and the parallel/ workloads split the range windows among one worker per
+ * core (see parallel.h). The filter/ workloads run the range windows for
+ * BENCH_FILTER_VALUE footpaths only (see filter.h); every point carries the
+ * categories of its footpath, and a synthetic point those of the real one
+ * it is derived from.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/resource.h>
+#include "qtree.h"
+#include "cursor.h"
+#include "footpath.h"
+#include "qtree_generic.h"
+#include "frozen.h"
+#include "compressed.h"
+#include "cache.h"
+#include "rcu.h"
+#include "locked.h"
+#include "pool.h"
+#include "parallel.h"
+#include "filter.h"
+
+#ifndef QTREE_DATA_DIR
+#define QTREE_DATA_DIR "tests/tests"
+#endif
+
+#define BENCH_MIN_NS 200000000LL  // minimum time spent on each workload
+#define BENCH_PAGE 512            // page size used to drain range cursors
+#define MAX_PATH_LEN 512          // maximum length of a fixture path
+#define SYNTH_JITTER 0.0005L      // spread of synthetic points around real ones
+#define BENCH_CAPACITY 8          // leaf capacity of the generic tree
+#define BENCH_WRITES 100000       // points the writer of the rcu/ workloads inserts
+#define BENCH_FILTER_COLUMN "asset_type"      // column the filter/ workloads filter on
+#define BENCH_FILTER_VALUE "Road Footway"     // the value they keep
+
+// a growable array of points
+typedef struct points {
+    point_t** items;
+    int length;
+    int capacity;
+} points_t;
+
+// a growable array of query windows
+typedef struct windows {
+    square_t** items;
+    int length;
+    int capacity;
+} windows_t;
+
+// the writer of the rcu/ workloads, inserting until stopped or out of points
+typedef struct rcu_writer {
+    rcu_tree_t* rcu;
+    points_t* pts;
+    int stop;
+    int inserted;
+} rcu_writer_t;
+
+/* allocation counting; only wired up when linked with --wrap=malloc etc. */
+#ifdef BENCH_COUNT_ALLOCS
+static long long alloc_count = 0;
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t n, size_t size);
+void* __real_realloc(void* ptr, size_t size);
+void* __wrap_malloc(size_t size) { alloc_count++; return __real_malloc(size); }
+void* __wrap_calloc(size_t n, size_t size) { alloc_count++; return __real_calloc(n, size); }
+void* __wrap_realloc(void* ptr, size_t size) { alloc_count++; return __real_realloc(ptr, size); }
+#define ALLOCS() alloc_count
+#else
+#define ALLOCS() (-1LL)
+#endif
+
+static int first_result = 1;
+
+// the generic tree, specialised to the benchmark's points
+QTREE_INIT(gen, point_t*, long double, BENCH_CAPACITY)
+
+/* monotonic clock, in nanoseconds */
+long long now_ns();
+/* peak resident set size so far, in kilobytes */
+long peak_rss_kb();
+/* append to a point / window array */
+void points_add(points_t* pts, point_t* point);
+void windows_add(windows_t* wins, square_t* window);
+/* load every start and end point of a footpath dataset, with the categories
+ * of its footpath; 0 if unreadable
+ */
+int load_dataset(char* dir, char* name, category_dict_t* dict, points_t* pts);
+/* load the points or windows of a query file into pts or wins */
+void load_queries(char* dir, char* name, points_t* pts, windows_t* wins);
+/* derive n synthetic points scattered around the real ones */
+void synthesize(points_t* real, int n, points_t* pts);
+/* smallest outer square containing every point */
+square_t* bounding_square(points_t* pts);
+/* print a single JSON result */
+void report(char* workload, char* dataset, long long ops, long long ns,
+            long long allocs, double hits);
+/* benchmark workloads over a dataset */
+void bench_dataset(char* dataset, points_t* pts, points_t* lookups, filter_t* filter,
+                   windows_t* ranges, char** range_names, int nranges);
+/* the same workloads over the generic tree */
+void bench_generic(char* dataset, square_t* square, points_t* pts, points_t* queries,
+                   windows_t* ranges, char** range_names, int nranges);
+/* build a generic tree over square from every point */
+gen_tree_t* build_generic(square_t* square, points_t* pts);
+
+/* the point and range workloads over the frozen tree */
+void bench_frozen(char* dataset, qtnode_t* tree, points_t* queries,
+                  windows_t* ranges, char** range_names, int nranges);
+
+/* the build, point and range workloads over a compressed tree */
+void bench_compressed(char* dataset, square_t* square, points_t* pts, points_t* queries,
+                      windows_t* ranges, char** range_names, int nranges);
+
+/* build a compressed tree over a copy of square from every point */
+cqnode_t* build_compressed(square_t* square, points_t* pts);
+
+/* the build and point workloads over an RCU tree, with and without a writer */
+void bench_rcu(char* dataset, square_t* square, points_t* pts, points_t* queries);
+
+/* build an RCU tree over a copy of square from every point */
+rcu_tree_t* build_rcu(square_t* square, points_t* pts);
+
+/* insert a writer's points into its tree until told to stop */
+void* rcu_write(void* arg);
+qtnode_t* build_tree(square_t* square, points_t* pts);
+
+
+int main(int argc, char** argv) {
+    char* dir = (argc > 1) ? argv[1] : QTREE_DATA_DIR;
+    char path[MAX_PATH_LEN];
+    // point lookups from the stage 3 fixtures
+    points_t lookups = {NULL, 0, 0};
+    for (int i=1; i <= 8; i++) {
+        snprintf(path, MAX_PATH_LEN, "test%d.s3.in", i);
+        load_queries(dir, path, &lookups, NULL);
+    }
+    // range windows from the stage 4 fixtures, narrowest to widest
+    char* range_names[] = {"range/test12", "range/test13", "range/test14"};
+    windows_t ranges[3] = {{NULL, 0, 0}, {NULL, 0, 0}, {NULL, 0, 0}};
+    for (int i=0; i < 3; i++) {
+        snprintf(path, MAX_PATH_LEN, "test%d.s4.in", 12+i);
+        load_queries(dir, path, NULL, &ranges[i]);
+    }
+
+    printf("{\"benchmarks\": [\n");
+    points_t real = {NULL, 0, 0};
+    char* datasets[] = {"dataset_100.csv", "dataset_1000.csv"};
+    category_dict_t* dict = init_category_dict();
+    filter_t* filter = NULL;
+    for (int i=0; i < 2; i++) {
+        points_t pts = {NULL, 0, 0};
+        if (!load_dataset(dir, datasets[i], dict, &pts)) {
+            fprintf(stderr, "ERROR: cannot read %s/%s\n", dir, datasets[i]);
+            exit(EXIT_FAILURE);
+        }
+        // the filtered value is only in the dictionary once a dataset is read
+        if (filter == NULL) {
+            filter = init_filter();
+            filter_add(filter, dict, BENCH_FILTER_COLUMN, BENCH_FILTER_VALUE);
+        }
+        bench_dataset(datasets[i], &pts, &lookups, filter, ranges, range_names, 3);
+        if (i == 1) real = pts;
+    }
+    // synthetic sets scaled up from the largest dataset
+    int defaults[] = {10000, 100000, 1000000};
+    int nsizes = (argc > 2) ? argc-2 : 3;
+    for (int i=0; i < nsizes; i++) {
+        int n = (argc > 2) ? atoi(argv[i+2]) : defaults[i];
+        if (n <= 0) continue;
+        points_t pts = {NULL, 0, 0};
+        synthesize(&real, n, &pts);
+        char name[MAX_PATH_LEN];
+        snprintf(name, MAX_PATH_LEN, "synthetic_%d", n);
+        bench_dataset(name, &pts, &lookups, filter, ranges, range_names, 3);
+    }
+    printf("\n], \"peak_rss_kb\": %ld}\n", peak_rss_kb());
+    free_filter(filter);
+    free_category_dict(dict);
+    return 0;
+}
+
+/* benchmark build, point and range workloads over a dataset */
+void bench_dataset(char* dataset, points_t* pts, points_t* lookups, filter_t* filter,
+                   windows_t* ranges, char** range_names, int nranges) {
+    square_t* square = bounding_square(pts);
+    long long start, elapsed, allocs, ops;
+
+    // incremental build: insert every point into a fresh tree
+    ops = 0; elapsed = 0; allocs = ALLOCS();
+    do {
+        start = now_ns();
+        qtnode_t* tree = build_tree(square, pts);
+        elapsed += now_ns() - start;
+        ops += pts->length;
+        free_tree(tree);
+    } while (elapsed < BENCH_MIN_NS);
+    report("build", dataset, ops, elapsed, ALLOCS() - allocs, 0);
+
+    // the same build split among one writer per core
+    int nthreads = pool_default_threads();
+    ops = 0; elapsed = 0; allocs = ALLOCS();
+    do {
+        start = now_ns();
+        locked_tree_t* locked = init_locked_tree(init_square(square->bottom_left,
+                                                             square->top_right));
+        parallel_insert(locked, pts->items, pts->length, nthreads);
+        elapsed += now_ns() - start;
+        ops += pts->length;
+        free_locked_tree(locked);
+    } while (elapsed < BENCH_MIN_NS);
+    report("locked/build", dataset, ops, elapsed, ALLOCS() - allocs, 0);
+
+    qtnode_t* tree = build_tree(square, pts);
+
+    // point lookups: fixture queries inside the o.s, then every stored point
+    points_t queries = {NULL, 0, 0};
+    for (int i=0; i < lookups->length; i++)
+        if (in_sq(square, lookups->items[i])) points_add(&queries, lookups->items[i]);
+    for (int i=0; i < pts->length; i++) points_add(&queries, pts->items[i]);
+    long long hits = 0;
+    ops = 0; allocs = ALLOCS(); start = now_ns();
+    do {
+        for (int i=0; i < queries.length; i++)
+            hits += (find_pt(tree, queries.items[i]) != NULL);
+        ops += queries.length;
+        elapsed = now_ns() - start;
+    } while (elapsed < BENCH_MIN_NS);
+    report("point", dataset, ops, elapsed, ALLOCS() - allocs, (double) hits / ops);
+
+    // range queries, drained a page at a time
+    point_t* page[BENCH_PAGE];
+    for (int r=0; r < nranges; r++) {
+        if (ranges[r].length == 0) continue;
+        hits = 0; ops = 0; allocs = ALLOCS(); start = now_ns();
+        do {
+            for (int i=0; i < ranges[r].length; i++) {
+                range_cursor_t* cursor = init_range_cursor(tree, ranges[r].items[i]);
+                int n;
+                while ((n = range_cursor_next(cursor, page, BENCH_PAGE)) > 0) hits += n;
+                free_range_cursor(cursor);
+            }
+            ops += ranges[r].length;
+            elapsed = now_ns() - start;
+        } while (elapsed < BENCH_MIN_NS);
+        report(range_names[r], dataset, ops, elapsed, ALLOCS() - allocs,
+               (double) hits / ops);
+    }
+
+    // the same windows breadth-first, a page at most written out
+    for (int r=0; r < nranges; r++) {
+        if (ranges[r].length == 0) continue;
+        hits = 0; ops = 0; allocs = ALLOCS(); start = now_ns();
+        do {
+            for (int i=0; i < ranges[r].length; i++)
+                hits += range_frontier(tree, ranges[r].items[i], page, BENCH_PAGE);
+            ops += ranges[r].length;
+            elapsed = now_ns() - start;
+        } while (elapsed < BENCH_MIN_NS);
+        char name[MAX_PATH_LEN];
+        snprintf(name, MAX_PATH_LEN, "frontier/%s", range_names[r]);
+        report(name, dataset, ops, elapsed, ALLOCS() - allocs, (double) hits / ops);
+    }
+
+    // the same windows for the footpaths matching the filter only
+    for (int r=0; r < nranges; r++) {
+        if (ranges[r].length == 0) continue;
+        hits = 0; ops = 0; allocs = ALLOCS(); start = now_ns();
+        do {
+            for (int i=0; i < ranges[r].length; i++)
+                hits += range_filter(tree, ranges[r].items[i], filter, page, BENCH_PAGE);
+            ops += ranges[r].length;
+            elapsed = now_ns() - start;
+        } while (elapsed < BENCH_MIN_NS);
+        char name[MAX_PATH_LEN];
+        snprintf(name, MAX_PATH_LEN, "filter/%s", range_names[r]);
+        report(name, dataset, ops, elapsed, ALLOCS() - allocs, (double) hits / ops);
+    }
+
+    // the same windows split among the workers of a pool
+    pool_t* pool = init_pool(nthreads);
+    for (int r=0; r < nranges; r++) {
+        if (ranges[r].length == 0) continue;
+        hits = 0; ops = 0; allocs = ALLOCS(); start = now_ns();
+        do {
+            for (int i=0; i < ranges[r].length; i++) {
+                point_t** found;
+                hits += parallel_range(pool, tree, ranges[r].items[i], &found);
+                free(found);
+            }
+            ops += ranges[r].length;
+            elapsed = now_ns() - start;
+        } while (elapsed < BENCH_MIN_NS);
+        char name[MAX_PATH_LEN];
+        snprintf(name, MAX_PATH_LEN, "parallel/%s", range_names[r]);
+        report(name, dataset, ops, elapsed, ALLOCS() - allocs, (double) hits / ops);
+    }
+    free_pool(pool);
+
+    // the same windows again through a range cache; the tree stays unchanged,
+    // so only the first of each window searches the tree
+    range_cache_t* cache = init_range_cache(tree, CACHE_DEFAULT_CAP);
+    for (int r=0; r < nranges; r++) {
+        if (ranges[r].length == 0) continue;
+        hits = 0; ops = 0; allocs = ALLOCS(); start = now_ns();
+        do {
+            point_t** cached;
+            for (int i=0; i < ranges[r].length; i++)
+                hits += cached_range(cache, ranges[r].items[i], NULL, &cached);
+            ops += ranges[r].length;
+            elapsed = now_ns() - start;
+        } while (elapsed < BENCH_MIN_NS);
+        char name[MAX_PATH_LEN];
+        snprintf(name, MAX_PATH_LEN, "cached/%s", range_names[r]);
+        report(name, dataset, ops, elapsed, ALLOCS() - allocs, (double) hits / ops);
+    }
+    free_range_cache(cache);
+    bench_frozen(dataset, tree, &queries, ranges, range_names, nranges);
+    free_tree(tree);
+    bench_generic(dataset, square, pts, &queries, ranges, range_names, nranges);
+    bench_compressed(dataset, square, pts, &queries, ranges, range_names, nranges);
+    bench_rcu(dataset, square, pts, &queries);
+    free(queries.items);
+}
+
+/* the same workloads over the generic tree */
+void bench_generic(char* dataset, square_t* square, points_t* pts, points_t* queries,
+                   windows_t* ranges, char** range_names, int nranges) {
+    long long start, elapsed, allocs, ops, hits;
+    char name[MAX_PATH_LEN];
+
+    ops = 0; elapsed = 0; allocs = ALLOCS();
+    do {
+        start = now_ns();
+        gen_tree_t* tree = build_generic(square, pts);
+        elapsed += now_ns() - start;
+        ops += pts->length;
+        gen_free(tree);
+    } while (elapsed < BENCH_MIN_NS);
+    report("generic/build", dataset, ops, elapsed, ALLOCS() - allocs, 0);
+
+    gen_tree_t* tree = build_generic(square, pts);
+    hits = 0; ops = 0; allocs = ALLOCS(); start = now_ns();
+    do {
+        for (int i=0; i < queries->length; i++) {
+            point_t* q = queries->items[i];
+            hits += (gen_find(tree, q->x, q->y) != NULL);
+        }
+        ops += queries->length;
+        elapsed = now_ns() - start;
+    } while (elapsed < BENCH_MIN_NS);
+    report("generic/point", dataset, ops, elapsed, ALLOCS() - allocs, (double) hits / ops);
+
+    // the whole result is wanted, so the buffer holds every point
+    gen_entry_t** found = (gen_entry_t**) malloc(sizeof(gen_entry_t*) * pts->length);
+    for (int r=0; r < nranges; r++) {
+        if (ranges[r].length == 0) continue;
+        hits = 0; ops = 0; allocs = ALLOCS(); start = now_ns();
+        do {
+            for (int i=0; i < ranges[r].length; i++) {
+                square_t* w = ranges[r].items[i];
+                hits += gen_range(tree, w->bottom_left->x, w->bottom_left->y,
+                                  w->top_right->x, w->top_right->y, found, pts->length);
+            }
+            ops += ranges[r].length;
+            elapsed = now_ns() - start;
+        } while (elapsed < BENCH_MIN_NS);
+        snprintf(name, MAX_PATH_LEN, "generic/%s", range_names[r]);
+        report(name, dataset, ops, elapsed, ALLOCS() - allocs, (double) hits / ops);
+    }
+    free(found);
+    gen_free(tree);
+}
+
+/* the point and range workloads over the frozen tree */
+void bench_frozen(char* dataset, qtnode_t* tree, points_t* queries,
+                  windows_t* ranges, char** range_names, int nranges) {
+    long long start, elapsed, allocs, ops, hits;
+    char name[MAX_PATH_LEN];
+
+    ops = 0; elapsed = 0; allocs = ALLOCS();
+    do {
+        start = now_ns();
+        frozen_t* frozen = freeze(tree);
+        elapsed += now_ns() - start;
+        ops += frozen->length;
+        free_frozen(frozen);
+    } while (elapsed < BENCH_MIN_NS);
+    report("frozen/freeze", dataset, ops, elapsed, ALLOCS() - allocs, 0);
+
+    frozen_t* frozen = freeze(tree);
+    hits = 0; ops = 0; allocs = ALLOCS(); start = now_ns();
+    do {
+        for (int i=0; i < queries->length; i++)
+            hits += (frozen_find_pt(frozen, queries->items[i]) != NULL);
+        ops += queries->length;
+        elapsed = now_ns() - start;
+    } while (elapsed < BENCH_MIN_NS);
+    report("frozen/point", dataset, ops, elapsed, ALLOCS() - allocs, (double) hits / ops);
+
+    // drained a page at a time, as the cursor is
+    point_t* page[BENCH_PAGE];
+    for (int r=0; r < nranges; r++) {
+        if (ranges[r].length == 0) continue;
+        hits = 0; ops = 0; allocs = ALLOCS(); start = now_ns();
+        do {
+            for (int i=0; i < ranges[r].length; i++)
+                hits += frozen_range(frozen, ranges[r].items[i], page, BENCH_PAGE);
+            ops += ranges[r].length;
+            elapsed = now_ns() - start;
+        } while (elapsed < BENCH_MIN_NS);
+        snprintf(name, MAX_PATH_LEN, "frozen/%s", range_names[r]);
+        report(name, dataset, ops, elapsed, ALLOCS() - allocs, (double) hits / ops);
+    }
+    free_frozen(frozen);
+}
+
+/* the build, point and range workloads over a compressed tree */
+void bench_compressed(char* dataset, square_t* square, points_t* pts, points_t* queries,
+                      windows_t* ranges, char** range_names, int nranges) {
+    long long start, elapsed, allocs, ops, hits;
+    char name[MAX_PATH_LEN];
+
+    ops = 0; elapsed = 0; allocs = ALLOCS();
+    do {
+        start = now_ns();
+        cqnode_t* tree = build_compressed(square, pts);
+        elapsed += now_ns() - start;
+        ops += pts->length;
+        free_compressed(tree);
+    } while (elapsed < BENCH_MIN_NS);
+    report("compressed/build", dataset, ops, elapsed, ALLOCS() - allocs, 0);
+
+    cqnode_t* tree = build_compressed(square, pts);
+    hits = 0; ops = 0; allocs = ALLOCS(); start = now_ns();
+    do {
+        for (int i=0; i < queries->length; i++)
+            hits += (compressed_find_pt(tree, queries->items[i]) != NULL);
+        ops += queries->length;
+        elapsed = now_ns() - start;
+    } while (elapsed < BENCH_MIN_NS);
+    report("compressed/point", dataset, ops, elapsed, ALLOCS() - allocs, (double) hits / ops);
+
+    point_t* page[BENCH_PAGE];
+    for (int r=0; r < nranges; r++) {
+        if (ranges[r].length == 0) continue;
+        hits = 0; ops = 0; allocs = ALLOCS(); start = now_ns();
+        do {
+            for (int i=0; i < ranges[r].length; i++)
+                hits += compressed_range(tree, ranges[r].items[i], page, BENCH_PAGE);
+            ops += ranges[r].length;
+            elapsed = now_ns() - start;
+        } while (elapsed < BENCH_MIN_NS);
+        snprintf(name, MAX_PATH_LEN, "compressed/%s", range_names[r]);
+        report(name, dataset, ops, elapsed, ALLOCS() - allocs, (double) hits / ops);
+    }
+    free_compressed(tree);
+}
+
+/* build a compressed tree over a copy of square from every point */
+cqnode_t* build_compressed(square_t* square, points_t* pts) {
+    cqnode_t* tree = init_compressed(init_square(square->bottom_left, square->top_right));
+    for (int i=0; i < pts->length; i++) compressed_insert(tree, pts->items[i]);
+    return tree;
+}
+
+/* the build and point workloads over an RCU tree, with and without a writer */
+void bench_rcu(char* dataset, square_t* square, points_t* pts, points_t* queries) {
+    long long start, elapsed, allocs, ops, hits;
+
+    ops = 0; elapsed = 0; allocs = ALLOCS();
+    do {
+        start = now_ns();
+        rcu_tree_t* rcu = build_rcu(square, pts);
+        elapsed += now_ns() - start;
+        ops += pts->length;
+        free_rcu_tree(rcu);
+    } while (elapsed < BENCH_MIN_NS);
+    report("rcu/build", dataset, ops, elapsed, ALLOCS() - allocs, 0);
+
+    rcu_tree_t* rcu = build_rcu(square, pts);
+    int reader = rcu_register(rcu);
+    hits = 0; ops = 0; allocs = ALLOCS(); start = now_ns();
+    do {
+        for (int i=0; i < queries->length; i++)
+            hits += (rcu_find_pt(rcu, reader, queries->items[i]) != NULL);
+        ops += queries->length;
+        elapsed = now_ns() - start;
+    } while (elapsed < BENCH_MIN_NS);
+    report("rcu/point", dataset, ops, elapsed, ALLOCS() - allocs, (double) hits / ops);
+
+    // the same lookups while a writer inserts points scattered around the
+    // stored ones, timed only for as long as the writer is busy; the writer
+    // allocates too, so allocations are not counted
+    points_t scattered = {NULL, 0, 0}, writes = {NULL, 0, 0};
+    synthesize(pts, BENCH_WRITES, &scattered);
+    for (int i=0; i < scattered.length; i++) {
+        if (in_sq(square, scattered.items[i])) points_add(&writes, scattered.items[i]);
+        else free(scattered.items[i]);
+    }
+    free(scattered.items);
+    rcu_writer_t writer = {rcu, &writes, 0, 0};
+    pthread_t thread;
+    pthread_create(&thread, NULL, rcu_write, &writer);
+    hits = 0; ops = 0; start = now_ns();
+    do {
+        for (int i=0; i < queries->length; i++)
+            hits += (rcu_find_pt(rcu, reader, queries->items[i]) != NULL);
+        ops += queries->length;
+        elapsed = now_ns() - start;
+    } while (elapsed < BENCH_MIN_NS &&
+             __atomic_load_n(&writer.inserted, __ATOMIC_RELAXED) < writes.length);
+    __atomic_store_n(&writer.stop, 1, __ATOMIC_RELAXED);
+    pthread_join(thread, NULL);
+    report("rcu/point_writer", dataset, ops, elapsed, -1, (double) hits / ops);
+    free_rcu_tree(rcu);
+    for (int i=0; i < writes.length; i++) free(writes.items[i]);
+    free(writes.items);
+}
+
+/* build an RCU tree over a copy of square from every point */
+rcu_tree_t* build_rcu(square_t* square, points_t* pts) {
+    rcu_tree_t* rcu = init_rcu_tree(init_square(square->bottom_left, square->top_right));
+    for (int i=0; i < pts->length; i++) rcu_insert(rcu, pts->items[i]);
+    return rcu;
+}
+
+/* insert a writer's points into its tree until told to stop */
+void* rcu_write(void* arg) {
+    rcu_writer_t* writer = (rcu_writer_t*) arg;
+    for (int i=0; i < writer->pts->length; i++) {
+        if (__atomic_load_n(&writer->stop, __ATOMIC_RELAXED)) break;
+        rcu_insert(writer->rcu, writer->pts->items[i]);
+        __atomic_store_n(&writer->inserted, i + 1, __ATOMIC_RELAXED);
+    }
+    return NULL;
+}
+
+/* build a generic tree over square from every point */
+gen_tree_t* build_generic(square_t* square, points_t* pts) {
+    gen_tree_t* tree = gen_init(square->bottom_left->x, square->bottom_left->y,
+                                square->top_right->x, square->top_right->y);
+    for (int i=0; i < pts->length; i++)
+        gen_insert(tree, pts->items[i]->x, pts->items[i]->y, pts->items[i]);
+    return tree;
+}
+
+/* build a tree over a copy of square (free_tree frees the root's square)
+ * from every point
+ */
+qtnode_t* build_tree(square_t* square, points_t* pts) {
+    qtnode_t* tree = init_tree(init_square(square->bottom_left, square->top_right));
+    for (int i=0; i < pts->length; i++) insert(tree, pts->items[i]);
+    return tree;
+}
+
+/* print a single JSON result */
+void report(char* workload, char* dataset, long long ops, long long ns,
+            long long allocs, double hits) {
+    printf("%s  {\"workload\": \"%s\", \"dataset\": \"%s\", \"ops\": %lld, "
+           "\"ns_per_op\": %.1f, \"allocs_per_op\": ",
+           first_result ? "" : ",\n", workload, dataset, ops, (double) ns / ops);
+    if (allocs < 0) printf("null");
+    else printf("%.3f", (double) allocs / ops);
+    printf(", \"hits_per_op\": %.3f, \"peak_rss_kb\": %ld}", hits, peak_rss_kb());
+    first_result = 0;
+    fflush(stdout);
+}
+
+/* load every start and end point of a footpath dataset, with the categories
+ * of its footpath
+ */
+int load_dataset(char* dir, char* name, category_dict_t* dict, points_t* pts) {
+    char path[MAX_PATH_LEN];
+    snprintf(path, MAX_PATH_LEN, "%s/%s", dir, name);
+    FILE* f = fopen(path, "r");
+    if (f == NULL) return 0;
+    int n;
+    footpath_t** fps = read_footpaths(f, &n);
+    fclose(f);
+    for (int i=0; i < n; i++) {
+        point_t* start = init_point(fps[i]->start_lon, fps[i]->start_lat);
+        point_t* end = init_point(fps[i]->end_lon, fps[i]->end_lat);
+        start->category = end->category = footpath_categories(dict, fps[i]);
+        points_add(pts, start);
+        points_add(pts, end);
+    }
+    free_footpaths(fps, n);
+    return 1;
+}
+
+/* load a query file: "x y" lines into pts, or "x1 y1 x2 y2" lines into wins */
+void load_queries(char* dir, char* name, points_t* pts, windows_t* wins) {
+    char path[MAX_PATH_LEN];
+    int length = snprintf(path, MAX_PATH_LEN, "%s/%s", dir, name);
+    FILE* f = (length < MAX_PATH_LEN) ? fopen(path, "r") : NULL;
+    if (f == NULL) {
+        fprintf(stderr, "WARNING: cannot read %s/%s, skipping\n", dir, name);
+        return;
+    }
+    long double x1, y1, x2, y2;
+    if (pts != NULL)
+        while (fscanf(f, "%Lf %Lf", &x1, &y1) == 2)
+            points_add(pts, init_point(x1, y1));
+    if (wins != NULL)
+        while (fscanf(f, "%Lf %Lf %Lf %Lf", &x1, &y1, &x2, &y2) == 4)
+            windows_add(wins, init_square(init_point(x1, y1), init_point(x2, y2)));
+    fclose(f);
+}
+
+/* derive n synthetic points, each a real point jittered by up to
+ * SYNTH_JITTER in either direction; seeded so runs are comparable
+ */
+void synthesize(points_t* real, int n, points_t* pts) {
+    srand(20003);
+    for (int i=0; i < n; i++) {
+        point_t* base = real->items[rand() % real->length];
+        long double dx = ((long double) rand() / RAND_MAX * 2 - 1) * SYNTH_JITTER;
+        long double dy = ((long double) rand() / RAND_MAX * 2 - 1) * SYNTH_JITTER;
+        point_t* point = init_point(base->x + dx, base->y + dy);
+        point->category = base->category;
+        points_add(pts, point);
+    }
+}
+
+/* smallest outer square containing every point */
+square_t* bounding_square(points_t* pts) {
+    long double xL = pts->items[0]->x, xR = xL, yB = pts->items[0]->y, yT = yB;
+    for (int i=1; i < pts->length; i++) {
+        point_t* p = pts->items[i];
+        if (p->x < xL) xL = p->x;
+        if (p->x > xR) xR = p->x;
+        if (p->y < yB) yB = p->y;
+        if (p->y > yT) yT = p->y;
+    }
+    long double side = (xR - xL > yT - yB) ? xR - xL : yT - yB;
+    return init_square(init_point(xL, yB), init_point(xL + side, yB + side));
+}
+
+/* append to a point array */
+void points_add(points_t* pts, point_t* point) {
+    if (pts->length == pts->capacity) {
+        pts->capacity = (pts->capacity) ? pts->capacity * 2 : 64;
+        pts->items = (point_t**) realloc(pts->items, sizeof(point_t*) * pts->capacity);
+    }
+    pts->items[pts->length++] = point;
+}
+
+/* append to a window array */
+void windows_add(windows_t* wins, square_t* window) {
+    if (wins->length == wins->capacity) {
+        wins->capacity = (wins->capacity) ? wins->capacity * 2 : 8;
+        wins->items = (square_t**) realloc(wins->items, sizeof(square_t*) * wins->capacity);
+    }
+    wins->items[wins->length++] = window;
+}
+
+/* monotonic clock, in nanoseconds */
+long long now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long) ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/* peak resident set size, in kilobytes (ru_maxrss is in bytes on macOS) */
+long peak_rss_kb() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    return usage.ru_maxrss / 1024;
+#else
+    return usage.ru_maxrss;
+#endif
+}
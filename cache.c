@@ -0,0 +1,246 @@
+/*
+ * Range cache (see cache.h). Results are gathered with a range cursor, so
+ * they come in search_range's order, then filtered with filter_match_point;
+ * each is kept as a single array of the stored points, which serve as the
+ * ids.
+ * Windows are hashed on their coordinates and the filter's masks.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "cache.h"
+#include "cursor.h"
+#include "grid.h"
+
+#define CACHE_PAGE 64  // points fetched from the cursor at a time
+
+/* hash of a window and a filter, which may be NULL */
+uint64_t window_hash(square_t* rectangle, filter_t* filter);
+
+/* mix a 64-bit word into an FNV-1a hash */
+uint64_t hash_word(uint64_t hash, uint64_t word);
+
+/* whether an entry holds the given window and filter */
+int entry_match(cache_entry_t* entry, square_t* rectangle, filter_t* filter);
+
+/* run the search of an entry's window, storing its cover and results */
+void cache_fill(range_cache_t* cache, cache_entry_t* entry, square_t* rectangle,
+                filter_t* filter);
+
+/* move an entry to the front of the recently used list */
+void cache_touch(range_cache_t* cache, cache_entry_t* entry);
+
+/* take an entry out of the recently used list */
+void cache_unlink(range_cache_t* cache, cache_entry_t* entry);
+
+/* drop the least recently used entry */
+void cache_evict(range_cache_t* cache);
+
+/* initialize a cache of up to capacity windows over a tree */
+range_cache_t* init_range_cache(qtnode_t* tree, int capacity) {
+    assert(tree); assert(capacity > 0);
+    range_cache_t* cache = (range_cache_t*) malloc(sizeof(range_cache_t));
+    assert(cache);
+    cache->tree = tree;
+    cache->capacity = capacity;
+    cache->length = 0;
+    // at least twice as many buckets as entries, a power of 2
+    cache->nbuckets = 1;
+    while (cache->nbuckets < 2 * capacity) cache->nbuckets <<= 1;
+    cache->buckets = (cache_entry_t**) calloc(cache->nbuckets, sizeof(cache_entry_t*));
+    assert(cache->buckets);
+    cache->head = cache->tail = NULL;
+    cache->hits = cache->misses = 0;
+    return cache;
+}
+
+/* the points within the rectangle that match the filter (NULL for none),
+ * through the cache; points is set to the cache's own copy of the results,
+ * valid until the next call, and their number is returned
+ */
+int cached_range(range_cache_t* cache, square_t* rectangle, filter_t* filter,
+                 point_t*** points) {
+    uint64_t hash = window_hash(rectangle, filter);
+    cache_entry_t** bucket = &cache->buckets[hash & (cache->nbuckets - 1)];
+    cache_entry_t* entry = *bucket;
+    while (entry != NULL && !entry_match(entry, rectangle, filter))
+        entry = entry->chain;
+
+    if (entry != NULL && entry->cover->generation == entry->generation) {
+        cache->hits++;
+        cache_unlink(cache, entry);
+    }
+    else {
+        cache->misses++;
+        if (entry != NULL) {
+            // stale: the covering node has seen an insertion since
+            free(entry->points);
+            cache_unlink(cache, entry);
+        }
+        else {
+            if (cache->length == cache->capacity)
+                cache_evict(cache);
+            entry = (cache_entry_t*) malloc(sizeof(cache_entry_t));
+            assert(entry);
+            entry->x1 = rectangle->bottom_left->x;
+            entry->y1 = rectangle->bottom_left->y;
+            entry->x2 = rectangle->top_right->x;
+            entry->y2 = rectangle->top_right->y;
+            entry->clauses = (filter == NULL) ? 0 : filter->length;
+            for (int i=0; i < entry->clauses; i++)
+                entry->masks[i] = filter->masks[i];
+            entry->hash = hash;
+            entry->chain = *bucket;
+            *bucket = entry;
+            cache->length++;
+        }
+        cache_fill(cache, entry, rectangle, filter);
+    }
+    cache_touch(cache, entry);
+    *points = entry->points;
+    return entry->length;
+}
+
+/* range search through the cache, printing as search_range does */
+void search_range_cached(range_cache_t* cache, square_t* rectangle, filter_t* filter) {
+    point_t** points;
+    int found = cached_range(cache, rectangle, filter, &points);
+    for (int i=0; i < found; i++)
+        printf("Range search: (%Lf, %Lf)\n", points[i]->x, points[i]->y);
+    if (!found)
+        printf("Range search: no point found!\n");
+}
+
+/* the deepest node that every point within the rectangle is inserted
+ * through: descend while both corners fall in the same present quadrant.
+ * Each quadrant is a product of ranges along x and y, so the whole
+ * rectangle falls where its corners do
+ */
+qtnode_t* covering_node(qtnode_t* tree, square_t* rectangle) {
+    point_t corners[2] = {*rectangle->bottom_left, *rectangle->top_right};
+    if (!in_sq(tree->square, &corners[0]) || !in_sq(tree->square, &corners[1]))
+        return tree;
+    GRID_POINT(tree->square, &corners[0]);
+    GRID_POINT(tree->square, &corners[1]);
+    while (!IS_LEAF(tree)) {
+        enum quadrant q = QUADRANT(tree->square, &corners[0]);
+        qtnode_t* child = get_child(tree, q);
+        if (child == NULL || QUADRANT(tree->square, &corners[1]) != q)
+            break;
+        tree = child;
+    }
+    return tree;
+}
+
+/* run the search of an entry's window, storing its cover and results */
+void cache_fill(range_cache_t* cache, cache_entry_t* entry, square_t* rectangle,
+                filter_t* filter) {
+    entry->cover = covering_node(cache->tree, rectangle);
+    entry->generation = entry->cover->generation;
+    int capacity = CACHE_PAGE, length = 0, n;
+    point_t** points = (point_t**) malloc(sizeof(point_t*) * capacity);
+    assert(points);
+    range_cursor_t* cursor = init_range_cursor(cache->tree, rectangle);
+    do {
+        if (capacity - length < CACHE_PAGE) {
+            capacity *= 2;
+            points = (point_t**) realloc(points, sizeof(point_t*) * capacity);
+            assert(points);
+        }
+        // the page lands past the kept points, which then absorb its matches
+        n = range_cursor_next(cursor, points + length, CACHE_PAGE);
+        point_t** page = points + length;
+        for (int i=0; i < n; i++)
+            if (filter_match_point(filter, page[i]))
+                points[length++] = page[i];
+    } while (n == CACHE_PAGE);
+    free_range_cursor(cursor);
+    entry->points = points;
+    entry->length = length;
+}
+
+/* hash of a window and a filter, which may be NULL */
+uint64_t window_hash(square_t* rectangle, filter_t* filter) {
+    long double coords[4] = {rectangle->bottom_left->x, rectangle->bottom_left->y,
+                             rectangle->top_right->x, rectangle->top_right->y};
+    uint64_t hash = 14695981039346656037ULL;
+    for (int i=0; i < 4; i++) {
+        // long double has padding bytes, so hash the value as a double
+        double value = (double) coords[i];
+        uint64_t word;
+        memcpy(&word, &value, sizeof(word));
+        hash = hash_word(hash, word);
+    }
+    int clauses = (filter == NULL) ? 0 : filter->length;
+    for (int i=0; i < clauses; i++)
+        hash = hash_word(hash, filter->masks[i]);
+    return hash_word(hash, (uint64_t) clauses);
+}
+
+/* mix a 64-bit word into an FNV-1a hash */
+uint64_t hash_word(uint64_t hash, uint64_t word) {
+    for (int i=0; i < 8; i++) {
+        hash ^= (word >> (8 * i)) & 0xff;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+/* whether an entry holds the given window and filter */
+int entry_match(cache_entry_t* entry, square_t* rectangle, filter_t* filter) {
+    int clauses = (filter == NULL) ? 0 : filter->length;
+    if (entry->x1 != rectangle->bottom_left->x || entry->y1 != rectangle->bottom_left->y ||
+        entry->x2 != rectangle->top_right->x || entry->y2 != rectangle->top_right->y ||
+        entry->clauses != clauses)
+        return 0;
+    for (int i=0; i < clauses; i++)
+        if (entry->masks[i] != filter->masks[i]) return 0;
+    return 1;
+}
+
+/* move an entry to the front of the recently used list */
+void cache_touch(range_cache_t* cache, cache_entry_t* entry) {
+    entry->prev = NULL;
+    entry->next = cache->head;
+    if (cache->head != NULL) cache->head->prev = entry;
+    cache->head = entry;
+    if (cache->tail == NULL) cache->tail = entry;
+}
+
+/* take an entry out of the recently used list */
+void cache_unlink(range_cache_t* cache, cache_entry_t* entry) {
+    if (entry->prev != NULL) entry->prev->next = entry->next;
+    else cache->head = entry->next;
+    if (entry->next != NULL) entry->next->prev = entry->prev;
+    else cache->tail = entry->prev;
+    entry->prev = entry->next = NULL;
+}
+
+/* drop the least recently used entry */
+void cache_evict(range_cache_t* cache) {
+    cache_entry_t* entry = cache->tail;
+    assert(entry);
+    cache_unlink(cache, entry);
+    cache_entry_t** link = &cache->buckets[entry->hash & (cache->nbuckets - 1)];
+    while (*link != entry) link = &(*link)->chain;
+    *link = entry->chain;
+    free(entry->points);
+    free(entry);
+    cache->length--;
+}
+
+/* free the cache and every result held; the tree is left as it is */
+void free_range_cache(range_cache_t* cache) {
+    assert(cache);
+    cache_entry_t* entry = cache->head;
+    while (entry != NULL) {
+        cache_entry_t* next = entry->next;
+        free(entry->points);
+        free(entry);
+        entry = next;
+    }
+    free(cache->buckets);
+    free(cache);
+}
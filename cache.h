@@ -0,0 +1,56 @@
+/*
+ * Range cache header: a bounded, least recently used cache of range search
+ * results, keyed by the window and the filter (if any). An entry remembers
+ * the covering node of its window - the deepest node every point within
+ * the window would be inserted through - along with that node's generation,
+ * and is only served while the generation is unchanged; any insertion that
+ * could change the result passes through the covering node and bumps it.
+ */
+
+#include "qtree.h"
+#include "filter.h"
+
+#ifndef QTREE_SELF_IMPLEMENTATION_CACHE_H
+#define QTREE_SELF_IMPLEMENTATION_CACHE_H
+
+#define CACHE_DEFAULT_CAP 256  // default number of cached windows
+
+// structures
+typedef struct cache_entry cache_entry_t;
+struct cache_entry {
+    long double x1, y1, x2, y2;
+    category_t masks[MAX_CLAUSES];
+    int clauses;
+    qtnode_t* cover;
+    uint32_t generation;
+    uint64_t hash;
+    point_t** points;
+    int length;
+    cache_entry_t* prev;
+    cache_entry_t* next;
+    cache_entry_t* chain;
+};
+
+// entries are chained in buckets by hash, and listed from the most to the
+// least recently used
+typedef struct range_cache {
+    qtnode_t* tree;
+    cache_entry_t** buckets;
+    int nbuckets;
+    int length;
+    int capacity;
+    cache_entry_t* head;
+    cache_entry_t* tail;
+    long long hits;
+    long long misses;
+} range_cache_t;
+
+// function prototypes
+range_cache_t* init_range_cache(qtnode_t* tree, int capacity);
+int cached_range(range_cache_t* cache, square_t* rectangle, filter_t* filter,
+                 point_t*** points);
+void search_range_cached(range_cache_t* cache, square_t* rectangle, filter_t* filter);
+qtnode_t* covering_node(qtnode_t* tree, square_t* rectangle);
+void free_range_cache(range_cache_t* cache);
+
+#endif //QTREE_SELF_IMPLEMENTATION_CACHE_H
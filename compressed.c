@@ -0,0 +1,271 @@
+/*
+ * Compressed quadtree (see compressed.h). A child may sit several levels
+ * below its parent; the levels skipped in between are walked again, with
+ * the same midpoints split() computes, whenever a point has to be placed
+ * or found below the parent. A point leaving the child's path on the way
+ * down gets a new node at the level where it does, so every internal node
+ * keeps at least 2 children.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include "compressed.h"
+
+// a square during descent, kept on the stack until a node needs it
+typedef struct cq_frame {
+    point_t bottom_left;
+    point_t top_right;
+    square_t square;
+    int depth;
+} cq_frame_t;
+
+/* start a frame at the square of a node */
+void cq_frame(cq_frame_t* frame, cqnode_t* node);
+
+/* narrow a frame down to its quadrant q, as split does */
+void cq_narrow(cq_frame_t* frame, enum quadrant q);
+
+/* a copy of a frame's square within the arena */
+square_t* cq_square(arena_t* arena, cq_frame_t* frame);
+
+/* a node within the arena, at the square and depth of a frame */
+cqnode_t* cq_node(arena_t* arena, cq_frame_t* frame, point_t* point);
+
+/* the quadrant of an outer square that an inner square lies in */
+enum quadrant square_quad(square_t* outer, square_t* inner);
+
+/* recursively collect the points within range below a node */
+void compressed_range_level(cqnode_t* node, square_t* rectangle, point_t** out,
+                            int max, int* found);
+
+/* initialize a compressed tree over a square; it becomes the root, with an
+ * arena of its own
+ */
+cqnode_t* init_compressed(square_t* square) {
+    cqnode_t* tree = (cqnode_t*) malloc(sizeof(cqnode_t));
+    assert(tree);
+    tree->point = NULL;
+    tree->square = square;
+    tree->arena = init_arena(ARENA_BLOCK_SIZE);
+    tree->depth = 0;
+    tree->child[sw] = tree->child[nw] = tree->child[ne] = tree->child[se] = NULL;
+    return tree;
+}
+
+/* insert a data point to the compressed tree */
+void compressed_insert(cqnode_t* tree, point_t* point) {
+    assert(tree->arena);
+    cq_frame_t frame, split_frame;
+    // a root holding a point moves it down a level, into its quadrant; the
+    // root's square is fixed, so only the root may have a single child
+    if (CQ_IS_LEAF(tree)) {
+        if (tree->point == NULL) {
+            tree->point = point;
+            return;
+        }
+        if (point_cmp(tree->point, point)) {
+            tree->point = merge_duplicate(tree->point, point, tree->arena);
+            return;
+        }
+        enum quadrant q = determine_quad(tree->square, tree->point);
+        cq_frame(&frame, tree);
+        cq_narrow(&frame, q);
+        tree->child[q] = cq_node(tree->arena, &frame, tree->point);
+        tree->point = NULL;
+    }
+    cqnode_t* node = tree;
+    for (;;) {
+        enum quadrant q = determine_quad(node->square, point);
+        cqnode_t* child = node->child[q];
+        cq_frame(&frame, node);
+        cq_narrow(&frame, q);
+        if (child == NULL) {
+            node->child[q] = cq_node(tree->arena, &frame, point);
+            return;
+        }
+        // walk the levels skipped above the child; if the point leaves its
+        // path, a new node at that level takes both
+        while (frame.depth < child->depth) {
+            enum quadrant qchild = square_quad(&frame.square, child->square);
+            enum quadrant qpoint = determine_quad(&frame.square, point);
+            if (qchild != qpoint) {
+                cqnode_t* parent = cq_node(tree->arena, &frame, NULL);
+                cq_frame(&split_frame, parent);
+                cq_narrow(&split_frame, qpoint);
+                parent->child[qchild] = child;
+                parent->child[qpoint] = cq_node(tree->arena, &split_frame, point);
+                node->child[q] = parent;
+                return;
+            }
+            cq_narrow(&frame, qchild);
+        }
+        if (!CQ_IS_LEAF(child)) {
+            node = child;
+            continue;
+        }
+        // the 2 points must not be the same, as in split_insert
+        if (point_cmp(child->point, point)) {
+            child->point = merge_duplicate(child->point, point, tree->arena);
+            return;
+        }
+        // the leaf becomes the node at the first level separating the points
+        point_t* existing = child->point;
+        enum quadrant qexisting, qpoint;
+        while ((qexisting = determine_quad(&frame.square, existing)) ==
+               (qpoint = determine_quad(&frame.square, point)))
+            cq_narrow(&frame, qexisting);
+        if (frame.depth > child->depth) {
+            child->square = cq_square(tree->arena, &frame);
+            child->depth = frame.depth;
+        }
+        child->point = NULL;
+        cq_frame(&split_frame, child);
+        cq_narrow(&split_frame, qexisting);
+        child->child[qexisting] = cq_node(tree->arena, &split_frame, existing);
+        cq_frame(&split_frame, child);
+        cq_narrow(&split_frame, qpoint);
+        child->child[qpoint] = cq_node(tree->arena, &split_frame, point);
+        return;
+    }
+}
+
+/* find the stored point at the same location as point; NULL if none */
+point_t* compressed_find_pt(cqnode_t* tree, point_t* point) {
+    cq_frame_t frame;
+    cqnode_t* node = tree;
+    while (!CQ_IS_LEAF(node)) {
+        enum quadrant q = determine_quad(node->square, point);
+        cqnode_t* child = node->child[q];
+        if (child == NULL) return NULL;
+        // a leaf's point settles it; otherwise the point must follow the
+        // child's path through the skipped levels
+        if (!CQ_IS_LEAF(child)) {
+            cq_frame(&frame, node);
+            cq_narrow(&frame, q);
+            while (frame.depth < child->depth) {
+                enum quadrant qchild = square_quad(&frame.square, child->square);
+                if (determine_quad(&frame.square, point) != qchild) return NULL;
+                cq_narrow(&frame, qchild);
+            }
+        }
+        node = child;
+    }
+    if (node->point != NULL && point_cmp(node->point, point))
+        return node->point;
+    return NULL;
+}
+
+/* point searching in the compressed tree */
+void compressed_search_pt(cqnode_t* tree, point_t* point) {
+    point_t* found = compressed_find_pt(tree, point);
+    if (found != NULL)
+        printf("The point (%Lf, %Lf) has been found.\n", found->x, found->y);
+    else printf("Point not found!\n");
+}
+
+/* points within the rectangle, in search_range's order; up to max are
+ * written to out, and the number found is returned even past max
+ */
+int compressed_range(cqnode_t* tree, square_t* rectangle, point_t** out, int max) {
+    int found = 0;
+    compressed_range_level(tree, rectangle, out, max, &found);
+    return found;
+}
+
+/* recursively collect the points within range below a node */
+void compressed_range_level(cqnode_t* node, square_t* rectangle, point_t** out,
+                            int max, int* found) {
+    if (CQ_IS_LEAF(node)) {
+        if (node->point != NULL && in_sq(rectangle, node->point)) {
+            if (*found < max) out[*found] = node->point;
+            (*found)++;
+        }
+        return;
+    }
+    cqnode_t* children[4] = {node->child[nw], node->child[ne], node->child[sw], node->child[se]};
+    for (int i=0; i < 4; i++) {
+        if (children[i] != NULL && rectangle_intersect(children[i]->square, rectangle))
+            compressed_range_level(children[i], rectangle, out, max, found);
+    }
+}
+
+/* range search all valid points in the compressed tree */
+void compressed_search_range(cqnode_t* tree, square_t* rectangle) {
+    int found = compressed_range(tree, rectangle, NULL, 0);
+    point_t** points = (point_t**) malloc(sizeof(point_t*) * (found ? found : 1));
+    assert(points);
+    compressed_range(tree, rectangle, points, found);
+    for (int i = 0; i < found; i++)
+        printf("Range search: (%Lf, %Lf)\n", points[i]->x, points[i]->y);
+    if (!found)
+        printf("Range search: no point found!\n");
+    free(points);
+}
+
+/* number of nodes on the longest path down from a node */
+int compressed_height(cqnode_t* tree) {
+    int height = 0;
+    for (enum quadrant q = sw; q <= se; q++) {
+        if (tree->child[q] == NULL) continue;
+        int h = compressed_height(tree->child[q]);
+        if (h > height) height = h;
+    }
+    return height + 1;
+}
+
+/* start a frame at the square of a node */
+void cq_frame(cq_frame_t* frame, cqnode_t* node) {
+    frame->bottom_left = *node->square->bottom_left;
+    frame->top_right = *node->square->top_right;
+    frame->square = *node->square;
+    frame->square.bottom_left = &frame->bottom_left;
+    frame->square.top_right = &frame->top_right;
+    frame->depth = node->depth;
+}
+
+/* narrow a frame down to its quadrant q, as split does */
+void cq_narrow(cq_frame_t* frame, enum quadrant q) {
+    long double xMid, yMid;
+    get_midpoints(&frame->square, &xMid, &yMid);
+    if (q == nw || q == sw) frame->top_right.x = xMid;
+    else frame->bottom_left.x = xMid;
+    if (q == sw || q == se) frame->top_right.y = yMid;
+    else frame->bottom_left.y = yMid;
+    frame->depth++;
+}
+
+/* a copy of a frame's square within the arena */
+square_t* cq_square(arena_t* arena, cq_frame_t* frame) {
+    return arena_square(arena, arena_point(arena, frame->bottom_left.x, frame->bottom_left.y),
+                        arena_point(arena, frame->top_right.x, frame->top_right.y));
+}
+
+/* a node within the arena, at the square and depth of a frame */
+cqnode_t* cq_node(arena_t* arena, cq_frame_t* frame, point_t* point) {
+    cqnode_t* node = (cqnode_t*) arena_alloc(arena, sizeof(cqnode_t));
+    node->point = point;
+    node->square = cq_square(arena, frame);
+    node->arena = NULL;
+    node->depth = frame->depth;
+    node->child[sw] = node->child[nw] = node->child[ne] = node->child[se] = NULL;
+    return node;
+}
+
+/* the quadrant of an outer square that an inner square lies in, decided by
+ * the inner square's center, which never lies on the outer midlines
+ */
+enum quadrant square_quad(square_t* outer, square_t* inner) {
+    point_t center = {.x = 0, .y = 0};
+    get_midpoints(inner, &center.x, &center.y);
+    return determine_quad(outer, &center);
+}
+
+/* free the entire compressed tree; points belong to the caller */
+void free_compressed(cqnode_t* tree) {
+    if (tree == NULL) return;
+    assert(tree->arena);
+    free_arena(tree->arena);
+    free(tree->square);
+    free(tree);
+}
@@ -0,0 +1,45 @@
+/*
+ * Compressed quadtree header: a quadtree in which chains of single-child
+ * nodes are never materialised. Where qtree.c splits level after level
+ * until two close points land in different quadrants, a compressed node
+ * jumps straight to the smallest quadrant separating its points and
+ * records how deep it sits instead. The tree then holds fewer than 2n nodes
+ * for n points, however close they are. Quadrants and squares are still
+ * exactly those split() would make, so searches find the same points as
+ * in the uncompressed tree.
+ */
+
+#include "qtree.h"
+
+#ifndef QTREE_SELF_IMPLEMENTATION_COMPRESSED_H
+#define QTREE_SELF_IMPLEMENTATION_COMPRESSED_H
+
+// structures
+
+// a compressed node: a leaf holding a point, or an internal node with at
+// least 2 children; depth counts every level below the root, skipped ones
+// included. As in qtree.h, the root owns the arena everything else lives in
+typedef struct cqnode cqnode_t;
+struct cqnode {
+    point_t* point;
+    square_t* square;
+    arena_t* arena;
+    int depth;
+    cqnode_t* child[4];
+};
+
+#define CQ_IS_LEAF(node) \
+    ((node)->child[0] == NULL && (node)->child[1] == NULL && \
+     (node)->child[2] == NULL && (node)->child[3] == NULL)
+
+// function prototypes
+cqnode_t* init_compressed(square_t* square);
+void compressed_insert(cqnode_t* tree, point_t* point);
+point_t* compressed_find_pt(cqnode_t* tree, point_t* point);
+void compressed_search_pt(cqnode_t* tree, point_t* point);
+int compressed_range(cqnode_t* tree, square_t* rectangle, point_t** out, int max);
+void compressed_search_range(cqnode_t* tree, square_t* rectangle);
+int compressed_height(cqnode_t* tree);
+void free_compressed(cqnode_t* tree);
+
+#endif //QTREE_SELF_IMPLEMENTATION_COMPRESSED_H
@@ -0,0 +1,88 @@
+/*
+ * A range cursor walks the same nodes as search_range, in the same order
+ * (nw, ne, sw, se), but does so with an explicit stack rather than the
+ * call stack. The traversal therefore stops as soon as a page is full,
+ * and the cost of a page depends on the page size, not the window size.
+ */
+
+#include <stdlib.h>
+#include <assert.h>
+#include "cursor.h"
+#include "grid.h"
+
+/* push a node onto the cursor's stack, growing the stack if needed */
+void cursor_push(range_cursor_t* cursor, qtnode_t* node);
+
+/*
+ * initialize cursor over the given tree and range; nothing is visited
+ * until the first call to range_cursor_next
+ */
+range_cursor_t* init_range_cursor(qtnode_t* tree, square_t* rectangle) {
+    assert(tree); assert(rectangle);
+    range_cursor_t* cursor = (range_cursor_t*) malloc(sizeof(range_cursor_t));
+    assert(cursor);
+    cursor->rectangle = rectangle;
+    GRID_SQUARE(tree->square, rectangle);
+    cursor->size = 0;
+    cursor->capacity = CURSOR_INIT_CAP;
+    cursor->stack = (qtnode_t**) malloc(sizeof(qtnode_t*) * cursor->capacity);
+    assert(cursor->stack);
+    cursor_push(cursor, tree);
+    return cursor;
+}
+
+/*
+ * push to stack; children are pushed in reverse so that they are popped
+ * in the same order search_range visits them
+ */
+void cursor_push(range_cursor_t* cursor, qtnode_t* node) {
+    if (cursor->size == cursor->capacity) {
+        cursor->capacity *= 2;
+        cursor->stack = (qtnode_t**) realloc(cursor->stack,
+                                             sizeof(qtnode_t*) * cursor->capacity);
+        assert(cursor->stack);
+    }
+    cursor->stack[cursor->size++] = node;
+}
+
+/*
+ * fetch up to max points within range into buf, returning how many were
+ * written; a return value less than max means the range is exhausted
+ */
+int range_cursor_next(range_cursor_t* cursor, point_t** buf, int max) {
+    assert(cursor); assert(buf || max <= 0);
+    square_t* rectangle = cursor->rectangle;
+    int n = 0;
+    while (n < max && cursor->size > 0) {
+        qtnode_t* tree = cursor->stack[--cursor->size];
+        // base case - leaf node
+        if (IS_LEAF(tree)) {
+            if (tree->point != NULL && IN_RANGE(rectangle, tree->point))
+                buf[n++] = tree->point;
+            continue;
+        }
+        // otherwise, queue up the present quadrants the rectangle intersects with
+        qtnode_t* children[4] = {tree->se, tree->sw, tree->ne, tree->nw};
+        for (int i=0; i < 4; i++)
+            if (children[i] != NULL && OVERLAPS(children[i]->square, rectangle))
+                cursor_push(cursor, children[i]);
+    }
+    return n;
+}
+
+/* check whether the cursor has no more nodes left to visit */
+int range_cursor_done(range_cursor_t* cursor) {
+    assert(cursor);
+    return cursor->size == 0;
+}
+
+/*
+ * free the cursor; may be called at any point, the tree and the range
+ * itself are not owned by the cursor
+ */
+void free_range_cursor(range_cursor_t* cursor) {
+    assert(cursor);
+    free(cursor->stack);
+    cursor->stack = NULL;
+    free(cursor);
+}
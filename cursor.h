@@ -0,0 +1,29 @@
+/*
+ * Range cursor header: a resumable range search that keeps its own
+ * explicit traversal stack, so results can be handed out a page at a
+ * time and the search resumed (or abandoned) later.
+ */
+
+#include "qtree.h"
+
+#ifndef QTREE_SELF_IMPLEMENTATION_CURSOR_H
+#define QTREE_SELF_IMPLEMENTATION_CURSOR_H
+
+#define CURSOR_INIT_CAP 16  // initial capacity of the cursor's node stack
+
+// structures
+typedef struct range_cursor range_cursor_t;
+struct range_cursor {
+    square_t* rectangle;
+    qtnode_t** stack;
+    int size;
+    int capacity;
+};
+
+// function prototypes
+range_cursor_t* init_range_cursor(qtnode_t* tree, square_t* rectangle);
+int range_cursor_next(range_cursor_t* cursor, point_t** buf, int max);
+int range_cursor_done(range_cursor_t* cursor);
+void free_range_cursor(range_cursor_t* cursor);
+
+#endif //QTREE_SELF_IMPLEMENTATION_CURSOR_H
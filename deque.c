@@ -0,0 +1,133 @@
+/*
+ * Work-stealing deque (see deque.h), after Le, Pop, Cohen and Zappa
+ * Nardelli's C11 formulation of Chase and Lev's. The slots of a task are
+ * read and written with relaxed atomics, as a thief may read a slot the
+ * owner is overwriting; it then loses the compare-and-swap on top, and
+ * drops what it read.
+ */
+
+#include <stdlib.h>
+#include <assert.h>
+#include "deque.h"
+
+/* a buffer of the given capacity, a power of 2 */
+deque_buffer_t* init_buffer(int64_t capacity);
+
+/* copy the tasks between top and bottom into a buffer twice the size */
+deque_buffer_t* grow_buffer(deque_buffer_t* buffer, int64_t top, int64_t bottom);
+
+/* the slot of a buffer holding the i-th task pushed */
+#define DEQUE_SLOT(buffer, i) (&(buffer)->tasks[(i) & ((buffer)->capacity - 1)])
+
+/* initialize an empty deque */
+deque_t* init_deque() {
+    deque_t* deque = (deque_t*) malloc(sizeof(deque_t));
+    assert(deque);
+    deque->top = 0;
+    deque->bottom = 0;
+    deque->buffer = init_buffer(DEQUE_INIT_CAP);
+    return deque;
+}
+
+/* push a task at the bottom; owner only */
+void deque_push(deque_t* deque, task_fn_t fn, void* arg) {
+    int64_t bottom = __atomic_load_n(&deque->bottom, __ATOMIC_RELAXED);
+    int64_t top = __atomic_load_n(&deque->top, __ATOMIC_ACQUIRE);
+    deque_buffer_t* buffer = __atomic_load_n(&deque->buffer, __ATOMIC_RELAXED);
+    if (bottom - top >= buffer->capacity) {
+        buffer = grow_buffer(buffer, top, bottom);
+        __atomic_store_n(&deque->buffer, buffer, __ATOMIC_RELEASE);
+    }
+    task_t* slot = DEQUE_SLOT(buffer, bottom);
+    __atomic_store_n(&slot->fn, fn, __ATOMIC_RELAXED);
+    __atomic_store_n(&slot->arg, arg, __ATOMIC_RELAXED);
+    __atomic_store_n(&deque->bottom, bottom + 1, __ATOMIC_RELEASE);
+}
+
+/* take the newest task from the bottom; owner only. Returns DEQUE_TAKEN
+ * or DEQUE_EMPTY
+ */
+int deque_take(deque_t* deque, task_t* task) {
+    int64_t bottom = __atomic_load_n(&deque->bottom, __ATOMIC_RELAXED) - 1;
+    deque_buffer_t* buffer = __atomic_load_n(&deque->buffer, __ATOMIC_RELAXED);
+    // claim the bottom slot before looking at top, so that a thief either
+    // sees the claim or is seen by us
+    __atomic_store_n(&deque->bottom, bottom, __ATOMIC_SEQ_CST);
+    int64_t top = __atomic_load_n(&deque->top, __ATOMIC_SEQ_CST);
+    if (top > bottom) {
+        __atomic_store_n(&deque->bottom, bottom + 1, __ATOMIC_RELAXED);
+        return DEQUE_EMPTY;
+    }
+    task_t* slot = DEQUE_SLOT(buffer, bottom);
+    task->fn = __atomic_load_n(&slot->fn, __ATOMIC_RELAXED);
+    task->arg = __atomic_load_n(&slot->arg, __ATOMIC_RELAXED);
+    if (top < bottom) return DEQUE_TAKEN;
+    // the last task: race the thieves for it
+    int won = __atomic_compare_exchange_n(&deque->top, &top, top + 1, 0,
+                                          __ATOMIC_SEQ_CST, __ATOMIC_RELAXED);
+    __atomic_store_n(&deque->bottom, bottom + 1, __ATOMIC_RELAXED);
+    return won ? DEQUE_TAKEN : DEQUE_EMPTY;
+}
+
+/* steal the oldest task from the top; any thread. Returns DEQUE_TAKEN,
+ * DEQUE_EMPTY, or DEQUE_ABORT when another thread got it first
+ */
+int deque_steal(deque_t* deque, task_t* task) {
+    int64_t top = __atomic_load_n(&deque->top, __ATOMIC_SEQ_CST);
+    int64_t bottom = __atomic_load_n(&deque->bottom, __ATOMIC_SEQ_CST);
+    if (top >= bottom) return DEQUE_EMPTY;
+    deque_buffer_t* buffer = __atomic_load_n(&deque->buffer, __ATOMIC_ACQUIRE);
+    task_t* slot = DEQUE_SLOT(buffer, top);
+    task_t stolen;
+    stolen.fn = __atomic_load_n(&slot->fn, __ATOMIC_RELAXED);
+    stolen.arg = __atomic_load_n(&slot->arg, __ATOMIC_RELAXED);
+    if (!__atomic_compare_exchange_n(&deque->top, &top, top + 1, 0,
+                                     __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+        return DEQUE_ABORT;
+    *task = stolen;
+    return DEQUE_TAKEN;
+}
+
+/* number of tasks in the deque; exact only for its owner */
+int64_t deque_size(deque_t* deque) {
+    int64_t bottom = __atomic_load_n(&deque->bottom, __ATOMIC_SEQ_CST);
+    int64_t top = __atomic_load_n(&deque->top, __ATOMIC_SEQ_CST);
+    return (bottom > top) ? bottom - top : 0;
+}
+
+/* a buffer of the given capacity, a power of 2 */
+deque_buffer_t* init_buffer(int64_t capacity) {
+    deque_buffer_t* buffer = (deque_buffer_t*) malloc(sizeof(deque_buffer_t) +
+                                                      sizeof(task_t) * capacity);
+    assert(buffer);
+    buffer->capacity = capacity;
+    buffer->retired = NULL;
+    return buffer;
+}
+
+/* copy the tasks between top and bottom into a buffer twice the size; the
+ * old one is kept on the new one's retired list
+ */
+deque_buffer_t* grow_buffer(deque_buffer_t* buffer, int64_t top, int64_t bottom) {
+    deque_buffer_t* grown = init_buffer(buffer->capacity * 2);
+    for (int64_t i=top; i < bottom; i++) {
+        task_t* from = DEQUE_SLOT(buffer, i);
+        task_t* to = DEQUE_SLOT(grown, i);
+        to->fn = __atomic_load_n(&from->fn, __ATOMIC_RELAXED);
+        to->arg = __atomic_load_n(&from->arg, __ATOMIC_RELAXED);
+    }
+    grown->retired = buffer;
+    return grown;
+}
+
+/* free the deque and every buffer it has had; no thread may still use it */
+void free_deque(deque_t* deque) {
+    assert(deque);
+    deque_buffer_t* buffer = deque->buffer;
+    while (buffer != NULL) {
+        deque_buffer_t* retired = buffer->retired;
+        free(buffer);
+        buffer = retired;
+    }
+    free(deque);
+}
@@ -0,0 +1,53 @@
+/*
+ * Deque header: a work-stealing deque of tasks (Chase and Lev). Its owner
+ * pushes and takes tasks at the bottom, as a stack, without locks; other
+ * threads steal the oldest task from the top, racing each other and the
+ * owner with a single compare-and-swap. The buffer is a ring whose
+ * capacity doubles when full; a thief may still be reading an outgrown
+ * buffer, so those are only freed along with the deque.
+ */
+
+#include <stdint.h>
+
+#ifndef QTREE_SELF_IMPLEMENTATION_DEQUE_H
+#define QTREE_SELF_IMPLEMENTATION_DEQUE_H
+
+#define DEQUE_INIT_CAP 64  // initial capacity of a deque, a power of 2
+#define DEQUE_TAKEN 1      // a task was taken or stolen
+#define DEQUE_EMPTY 0      // there was no task
+#define DEQUE_ABORT (-1)   // a steal lost a race; the deque may not be empty
+
+// structures
+typedef void (*task_fn_t)(void* arg);
+typedef struct task task_t;
+struct task {
+    task_fn_t fn;
+    void* arg;
+};
+
+typedef struct deque_buffer deque_buffer_t;
+struct deque_buffer {
+    int64_t capacity;
+    deque_buffer_t* retired;
+    task_t tasks[];
+};
+
+// top and bottom are written by different threads, so each has its own
+// cache line
+typedef struct deque {
+    int64_t top;
+    char pad_top[64 - sizeof(int64_t)];
+    int64_t bottom;
+    char pad_bottom[64 - sizeof(int64_t)];
+    deque_buffer_t* buffer;
+} deque_t;
+
+// function prototypes
+deque_t* init_deque();
+void deque_push(deque_t* deque, task_fn_t fn, void* arg);
+int deque_take(deque_t* deque, task_t* task);
+int deque_steal(deque_t* deque, task_t* task);
+int64_t deque_size(deque_t* deque);
+void free_deque(deque_t* deque);
+
+#endif //QTREE_SELF_IMPLEMENTATION_DEQUE_H
@@ -0,0 +1,227 @@
+/*
+ * Category dictionaries, filters and the filtered versions of point and
+ * range search. A NULL filter matches everything, so filtered searches
+ * behave exactly like their unfiltered counterparts when given none.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "filter.h"
+#include "grid.h"
+
+/* filtered point search below a node, the query already quantised */
+point_t* find_pt_filter_level(qtnode_t* tree, point_t* point, filter_t* filter);
+
+/* filtered range search below a node, the rectangle already quantised;
+ * up to max points are written to out, found counts them even past max
+ */
+void range_filter_level(qtnode_t* tree, square_t* rectangle, filter_t* filter,
+                        point_t** out, int max, int* found);
+
+
+/* initialize an empty category dictionary */
+category_dict_t* init_category_dict() {
+    category_dict_t* dict = (category_dict_t*) malloc(sizeof(category_dict_t));
+    assert(dict);
+    dict->length = 0;
+    return dict;
+}
+
+/* bit of the given column's value; if add is set, an unseen value is given
+ * the next free bit. Returns -1 if the value is unseen and add is not set.
+ * Running out of bits is an error, as a value without a bit could never be
+ * filtered on: the program exits rather than leave it out
+ */
+int category_bit(category_dict_t* dict, char* column, char* value, int add) {
+    assert(dict); assert(column); assert(value);
+    char name[MAX_NAME_LEN];
+    snprintf(name, MAX_NAME_LEN, "%s=%s", column, value);
+    for (int i=0; i < dict->length; i++)
+        if (strcmp(dict->names[i], name) == 0) return i;
+    if (!add) return -1;
+    if (dict->length == MAX_CATEGORIES) {
+        fprintf(stderr, "ERROR: more than %d category values, no bit for %s!\n",
+                MAX_CATEGORIES, name);
+        exit(EXIT_FAILURE);
+    }
+    dict->names[dict->length] = (char*) malloc(strlen(name) + 1);
+    assert(dict->names[dict->length]);
+    strcpy(dict->names[dict->length], name);
+    return dict->length++;
+}
+
+/* category bitmap of a footpath, over its categorical columns: asset_type,
+ * clue_sa, segside and statusid
+ */
+category_t footpath_categories(category_dict_t* dict, footpath_t* fp) {
+    char status[MAX_NAME_LEN];
+    snprintf(status, MAX_NAME_LEN, "%d", fp->statusid);
+    int bits[4];
+    bits[0] = category_bit(dict, "asset_type", fp->asset_type, 1);
+    bits[1] = category_bit(dict, "clue_sa", fp->clue_sa, 1);
+    bits[2] = category_bit(dict, "segside", fp->segside, 1);
+    bits[3] = category_bit(dict, "statusid", status, 1);
+    category_t category = 0;
+    for (int i=0; i < 4; i++) category |= (category_t) 1 << bits[i];
+    return category;
+}
+
+/* free the category dictionary */
+void free_category_dict(category_dict_t* dict) {
+    assert(dict);
+    for (int i=0; i < dict->length; i++) free(dict->names[i]);
+    free(dict);
+}
+
+/* initialize a filter with no clauses, which matches everything */
+filter_t* init_filter() {
+    filter_t* filter = (filter_t*) malloc(sizeof(filter_t));
+    assert(filter);
+    filter->length = 0;
+    return filter;
+}
+
+/* allow column = value; values of the same column are or-ed together,
+ * different columns are and-ed. Returns 0 if the value is unknown to the
+ * dictionary, in which case the clause still exists but matches nothing
+ */
+int filter_add(filter_t* filter, category_dict_t* dict, char* column, char* value) {
+    assert(filter); assert(dict);
+    int bit = category_bit(dict, column, value, 0);
+    int i;
+    for (i=0; i < filter->length; i++)
+        if (strcmp(filter->columns[i], column) == 0) break;
+    // new column, new clause
+    if (i == filter->length) {
+        assert(filter->length < MAX_CLAUSES);
+        filter->columns[i] = (char*) malloc(strlen(column) + 1);
+        assert(filter->columns[i]);
+        strcpy(filter->columns[i], column);
+        filter->masks[i] = 0;
+        filter->length++;
+    }
+    if (bit < 0) return 0;
+    filter->masks[i] |= (category_t) 1 << bit;
+    return 1;
+}
+
+/* check whether a point's categories satisfy every clause of the filter */
+int filter_match(filter_t* filter, category_t category) {
+    if (filter == NULL) return 1;
+    for (int i=0; i < filter->length; i++)
+        if ((category & filter->masks[i]) == 0) return 0;
+    return 1;
+}
+
+/* check whether one of the records a stored point stands for satisfies
+ * every clause of the filter by itself
+ */
+int filter_match_point(filter_t* filter, point_t* point) {
+    if (filter == NULL) return 1;
+    // the union fails whenever every record does
+    if (!filter_match(filter, point->category)) return 0;
+    int n;
+    category_t* words = point_records(point, &n);
+    for (int i=0; i < n; i++)
+        if (filter_match(filter, words[i])) return 1;
+    return 0;
+}
+
+/* check whether nothing below node can match the filter */
+int filter_prune(filter_t* filter, qtnode_t* node) {
+    return !filter_match(filter, node->categories);
+}
+
+/* free the filter */
+void free_filter(filter_t* filter) {
+    assert(filter);
+    for (int i=0; i < filter->length; i++) free(filter->columns[i]);
+    free(filter);
+}
+
+/* filtered point search */
+void search_pt_filter(qtnode_t* tree, point_t* point, filter_t* filter) {
+    point_t* found = find_pt_filter(tree, point, filter);
+    if (found != NULL)
+        printf("The point (%Lf, %Lf) has been found.\n", found->x, found->y);
+    else printf("Point not found!\n");
+}
+
+/* find the stored point at the same location as point, if it matches the
+ * filter; NULL if none
+ */
+point_t* find_pt_filter(qtnode_t* tree, point_t* point, filter_t* filter) {
+    GRID_POINT(tree->square, point);
+    return find_pt_filter_level(tree, point, filter);
+}
+
+/* filtered point search below a node, the query already quantised */
+point_t* find_pt_filter_level(qtnode_t* tree, point_t* point, filter_t* filter) {
+    // nothing below can match
+    if (filter_prune(filter, tree)) return NULL;
+    // base case - leaf node
+    if (IS_LEAF(tree)) {
+        if (tree->point != NULL && point_cmp(tree->point, point) &&
+            filter_match_point(filter, tree->point))
+            return tree->point;
+        return NULL;
+    }
+    // otherwise, find the right quadrant; an absent one holds nothing
+    qtnode_t* child = get_child(tree, QUADRANT(tree->square, point));
+    return (child == NULL) ? NULL : find_pt_filter_level(child, point, filter);
+}
+
+/* filtered range search below a node, the rectangle already quantised */
+void range_filter_level(qtnode_t* tree, square_t* rectangle, filter_t* filter,
+                        point_t** out, int max, int* found) {
+    // base case - leaf node
+    if (IS_LEAF(tree)) {
+        if (tree->point != NULL && IN_RANGE(rectangle, tree->point) &&
+            filter_match_point(filter, tree->point)) {
+            if (*found < max) out[*found] = tree->point;
+            (*found)++;
+        }
+        return;
+    }
+    // otherwise, find which present, matching quadrant rectangle intersects with
+    qtnode_t* children[4] = {tree->nw, tree->ne, tree->sw, tree->se};
+    for (int i=0; i < 4; i++) {
+        if (children[i] == NULL || filter_prune(filter, children[i])) continue;
+        if (OVERLAPS(children[i]->square, rectangle))
+            range_filter_level(children[i], rectangle, filter, out, max, found);
+    }
+}
+
+/* filtered range search, in search_range's order; up to max points are
+ * written to out, and the number found is returned even past max
+ */
+int range_filter(qtnode_t* tree, square_t* rectangle, filter_t* filter,
+                 point_t** out, int max) {
+    int found = 0;
+    GRID_SQUARE(tree->square, rectangle);
+    if (!filter_prune(filter, tree))
+        range_filter_level(tree, rectangle, filter, out, max, &found);
+    return found;
+}
+
+/* filtered range search */
+void search_range_filter(qtnode_t* tree, square_t* rectangle, filter_t* filter) {
+    // a second search is only needed when the first buffer was too small
+    int capacity = FILTER_INIT_CAP;
+    point_t** points = (point_t**) malloc(sizeof(point_t*) * capacity);
+    assert(points);
+    int found = range_filter(tree, rectangle, filter, points, capacity);
+    if (found > capacity) {
+        free(points);
+        points = (point_t**) malloc(sizeof(point_t*) * found);
+        assert(points);
+        range_filter(tree, rectangle, filter, points, found);
+    }
+    for (int i=0; i < found; i++)
+        printf("Range search: (%Lf, %Lf)\n", points[i]->x, points[i]->y);
+    if (!found)
+        printf("Range search: no point found!\n");
+    free(points);
+}
@@ -0,0 +1,54 @@
+/*
+ * Attribute filter header: categorical attribute values (e.g. asset_type
+ * "Road Footway", statusid 2) are each given one bit of a point's category
+ * bitmap, and a filter is a conjunction of per-column sets of allowed values.
+ * Each tree node keeps the union of the bitmaps below it, so filtered
+ * queries skip whole subtrees holding no matching category. A location
+ * holding several records matches if one of them does on its own: the
+ * union is only used to prune, as it may satisfy clauses that no single
+ * record satisfies together.
+ */
+
+#include "qtree.h"
+#include "footpath.h"
+
+#ifndef QTREE_SELF_IMPLEMENTATION_FILTER_H
+#define QTREE_SELF_IMPLEMENTATION_FILTER_H
+
+#define MAX_CATEGORIES 64  // number of bits in category_t
+#define MAX_CLAUSES 8      // maximum number of filtered columns
+#define MAX_NAME_LEN 128   // maximum length of a "column=value" name
+#define FILTER_INIT_CAP 64 // initial capacity of a range search's result buffer
+
+// structures
+typedef struct category_dict {
+    char* names[MAX_CATEGORIES];
+    int length;
+} category_dict_t;
+
+// a point matches a filter if, for every clause (column), it has at least
+// one of the clause's allowed values
+typedef struct filter {
+    char* columns[MAX_CLAUSES];
+    category_t masks[MAX_CLAUSES];
+    int length;
+} filter_t;
+
+// function prototypes
+category_dict_t* init_category_dict();
+int category_bit(category_dict_t* dict, char* column, char* value, int add);
+category_t footpath_categories(category_dict_t* dict, footpath_t* fp);
+void free_category_dict(category_dict_t* dict);
+filter_t* init_filter();
+int filter_add(filter_t* filter, category_dict_t* dict, char* column, char* value);
+int filter_match(filter_t* filter, category_t category);
+int filter_match_point(filter_t* filter, point_t* point);
+int filter_prune(filter_t* filter, qtnode_t* node);
+void free_filter(filter_t* filter);
+void search_pt_filter(qtnode_t* tree, point_t* point, filter_t* filter);
+point_t* find_pt_filter(qtnode_t* tree, point_t* point, filter_t* filter);
+int range_filter(qtnode_t* tree, square_t* rectangle, filter_t* filter,
+                 point_t** out, int max);
+void search_range_filter(qtnode_t* tree, square_t* rectangle, filter_t* filter);
+
+#endif //QTREE_SELF_IMPLEMENTATION_FILTER_H
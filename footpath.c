@@ -0,0 +1,193 @@
+/*
+ * Reading and printing footpath records. Rows follow the datasets'
+ * header line, where text fields may be quoted when they contain commas
+ * (e.g. "Melbourne, CBD"), and integer columns are stored as decimals
+ * (e.g. 1388910.0).
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "footpath.h"
+
+/* split a CSV row into its fields in place, honouring quoted fields;
+ * returns the number of fields found
+ */
+int split_fields(char* line, char** fields, int max);
+
+/* copy a field into freshly allocated memory */
+char* copy_field(char* field);
+
+/* copy a text field to the end of a packed text block */
+char* pack_field(char** text, char* field);
+
+/* read every footpath of a CSV file, skipping its header line */
+footpath_t** read_footpaths(FILE* f, int* n) {
+    assert(f); assert(n);
+    char line[MAX_LINE_LEN];
+    int capacity = FOOTPATH_INIT_CAP;
+    footpath_t** fps = (footpath_t**) malloc(sizeof(footpath_t*) * capacity);
+    assert(fps);
+    *n = 0;
+    // header line
+    if (fgets(line, MAX_LINE_LEN, f) == NULL) return fps;
+    while (fgets(line, MAX_LINE_LEN, f) != NULL) {
+        footpath_t* fp = parse_footpath(line);
+        if (fp == NULL) continue;
+        if (*n == capacity) {
+            capacity *= 2;
+            fps = (footpath_t**) realloc(fps, sizeof(footpath_t*) * capacity);
+            assert(fps);
+        }
+        fps[(*n)++] = fp;
+    }
+    return fps;
+}
+
+/* parse a single CSV row; returns NULL if the row is malformed */
+footpath_t* parse_footpath(char* line) {
+    char* fields[FOOTPATH_FIELDS];
+    if (split_fields(line, fields, FOOTPATH_FIELDS) != FOOTPATH_FIELDS)
+        return NULL;
+    footpath_t* fp = (footpath_t*) malloc(sizeof(footpath_t));
+    assert(fp);
+    fp->footpath_id = (int) strtod(fields[0], NULL);
+    fp->address = copy_field(fields[1]);
+    fp->clue_sa = copy_field(fields[2]);
+    fp->asset_type = copy_field(fields[3]);
+    fp->deltaz = strtod(fields[4], NULL);
+    fp->distance = strtod(fields[5], NULL);
+    fp->grade1in = strtod(fields[6], NULL);
+    fp->mcc_id = (int) strtod(fields[7], NULL);
+    fp->mccid_int = (int) strtod(fields[8], NULL);
+    fp->rlmax = strtod(fields[9], NULL);
+    fp->rlmin = strtod(fields[10], NULL);
+    fp->segside = copy_field(fields[11]);
+    fp->statusid = (int) strtod(fields[12], NULL);
+    fp->streetid = (int) strtod(fields[13], NULL);
+    fp->street_group = (int) strtod(fields[14], NULL);
+    fp->start_lat = strtold(fields[15], NULL);
+    fp->start_lon = strtold(fields[16], NULL);
+    fp->end_lat = strtold(fields[17], NULL);
+    fp->end_lon = strtold(fields[18], NULL);
+    return fp;
+}
+
+/* split a CSV row into fields in place */
+int split_fields(char* line, char** fields, int max) {
+    int n = 0;
+    char* read = line;
+    char* write = line;
+    // strip trailing newline
+    line[strcspn(line, "\r\n")] = '\0';
+    while (n < max) {
+        fields[n++] = write;
+        int quoted = 0;
+        while (*read != '\0' && (quoted || *read != ',')) {
+            // a doubled quote within a quoted field is a literal quote
+            if (*read == '"' && quoted && *(read+1) == '"') {
+                *write++ = '"';
+                read += 2;
+                continue;
+            }
+            if (*read == '"') quoted = !quoted;
+            else *write++ = *read;
+            read++;
+        }
+        int end = (*read == '\0');
+        *write++ = '\0';
+        read++;
+        if (end) break;
+    }
+    return n;
+}
+
+/* copy a field into freshly allocated memory */
+char* copy_field(char* field) {
+    char* copy = (char*) malloc(strlen(field) + 1);
+    assert(copy);
+    strcpy(copy, field);
+    return copy;
+}
+
+/* print a footpath in the stage 3/4 output format */
+void print_footpath(FILE* f, footpath_t* fp) {
+    fprintf(f, "--> footpath_id: %d || address: %s || clue_sa: %s || "
+               "asset_type: %s || deltaz: %.2f || distance: %.2f || "
+               "grade1in: %.1f || mcc_id: %d || mccid_int: %d || "
+               "rlmax: %.2f || rlmin: %.2f || segside: %s || statusid: %d || "
+               "streetid: %d || street_group: %d || start_lat: %.6Lf || "
+               "start_lon: %.6Lf || end_lat: %.6Lf || end_lon: %.6Lf || \n",
+            fp->footpath_id, fp->address, fp->clue_sa, fp->asset_type,
+            fp->deltaz, fp->distance, fp->grade1in, fp->mcc_id, fp->mccid_int,
+            fp->rlmax, fp->rlmin, fp->segside, fp->statusid, fp->streetid,
+            fp->street_group, fp->start_lat, fp->start_lon, fp->end_lat,
+            fp->end_lon);
+}
+
+/* free an array of footpaths along with their text fields */
+void free_footpaths(footpath_t** fps, int n) {
+    assert(fps);
+    for (int i=0; i < n; i++) {
+        free(fps[i]->address);
+        free(fps[i]->clue_sa);
+        free(fps[i]->asset_type);
+        free(fps[i]->segside);
+        free(fps[i]);
+    }
+    free(fps);
+}
+
+/* move footpaths, in their current order, into one contiguous block of
+ * records and one of text, freeing the originals; the result must be freed
+ * with free_packed_footpaths. No footpaths need no blocks
+ */
+footpath_t** pack_footpaths(footpath_t** fps, int n) {
+    assert(fps); assert(n >= 0);
+    footpath_t** packed = (footpath_t**) malloc(sizeof(footpath_t*) * (n > 0 ? (size_t) n : 1));
+    assert(packed);
+    if (n == 0) {
+        free_footpaths(fps, n);
+        return packed;
+    }
+    size_t text_len = 0;
+    for (int i=0; i < n; i++)
+        text_len += strlen(fps[i]->address) + strlen(fps[i]->clue_sa) +
+                    strlen(fps[i]->asset_type) + strlen(fps[i]->segside) + 4;
+    footpath_t* records = (footpath_t*) malloc(sizeof(footpath_t) * (size_t) n);
+    char* text = (char*) malloc(text_len);
+    assert(records); assert(text);
+    // the block starts with the first record's address, see free_packed_footpaths
+    char* end = text;
+    for (int i=0; i < n; i++) {
+        records[i] = *fps[i];
+        records[i].address = pack_field(&end, fps[i]->address);
+        records[i].clue_sa = pack_field(&end, fps[i]->clue_sa);
+        records[i].asset_type = pack_field(&end, fps[i]->asset_type);
+        records[i].segside = pack_field(&end, fps[i]->segside);
+        packed[i] = &records[i];
+    }
+    free_footpaths(fps, n);
+    return packed;
+}
+
+/* copy a text field to the end of a packed text block */
+char* pack_field(char** text, char* field) {
+    char* copy = *text;
+    size_t len = strlen(field) + 1;
+    memcpy(copy, field, len);
+    *text += len;
+    return copy;
+}
+
+/* free footpaths packed by pack_footpaths; the first record and its address
+ * start the record and text blocks, of which there are none if n is 0
+ */
+void free_packed_footpaths(footpath_t** fps, int n) {
+    assert(fps); assert(n >= 0);
+    if (n > 0) {
+        free(fps[0]->address);
+        free(fps[0]);
+    }
+    free(fps);
+}
@@ -0,0 +1,47 @@
+/*
+ * Footpath header: the record carried by the tree's points in the
+ * footpath datasets (tests/tests/dataset_*.csv), along with reading
+ * and printing those records in the datasets' 19-column CSV schema.
+ */
+
+#include <stdio.h>
+
+#ifndef QTREE_SELF_IMPLEMENTATION_FOOTPATH_H
+#define QTREE_SELF_IMPLEMENTATION_FOOTPATH_H
+
+#define FOOTPATH_FIELDS 19  // number of columns in a footpath CSV row
+#define MAX_LINE_LEN 512    // maximum length of a footpath CSV row
+#define FOOTPATH_INIT_CAP 64  // initial capacity of a footpath array
+
+// a single footpath record, one per CSV row
+typedef struct footpath {
+    int footpath_id;
+    char* address;
+    char* clue_sa;
+    char* asset_type;
+    double deltaz;
+    double distance;
+    double grade1in;
+    int mcc_id;
+    int mccid_int;
+    double rlmax;
+    double rlmin;
+    char* segside;
+    int statusid;
+    int streetid;
+    int street_group;
+    long double start_lat;
+    long double start_lon;
+    long double end_lat;
+    long double end_lon;
+} footpath_t;
+
+// function prototypes
+footpath_t** read_footpaths(FILE* f, int* n);
+footpath_t* parse_footpath(char* line);
+void print_footpath(FILE* f, footpath_t* fp);
+void free_footpaths(footpath_t** fps, int n);
+footpath_t** pack_footpaths(footpath_t** fps, int n);
+void free_packed_footpaths(footpath_t** fps, int n);
+
+#endif //QTREE_SELF_IMPLEMENTATION_FOOTPATH_H
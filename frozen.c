@@ -0,0 +1,265 @@
+/*
+ * Freezing a tree into van Emde Boas order (see frozen.h). Freezing first
+ * lists the nodes in layout order, then links each to its children by
+ * looking their addresses up in a sorted copy of that list. Searches
+ * follow the same quadrants and overlap checks as qtree.c, so a frozen tree
+ * answers exactly as the tree it was frozen from.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include "frozen.h"
+#include "grid.h"
+
+// the order nodes are searched in, as in search_range_check
+static const enum quadrant SEARCH_ORDER[4] = {nw, ne, sw, se};
+
+// a node address along with its index in the layout, to link children
+typedef struct placed {
+    qtnode_t* node;
+    uint32_t index;
+} placed_t;
+
+// nodes in layout order
+typedef struct layout {
+    qtnode_t** nodes;
+    uint32_t length;
+} layout_t;
+
+/* number of levels below and including a node */
+int tree_height(qtnode_t* tree);
+
+/* lay out the top height levels below a node in van Emde Boas order */
+void veb_layout(layout_t* layout, qtnode_t* node, int height);
+
+/* collect the nodes exactly depth levels below a node, in quadrant order */
+void collect_depth(qtnode_t* node, int depth, layout_t* frontier);
+
+/* the index of a node in the layout */
+uint32_t placed_index(placed_t* placed, uint32_t length, qtnode_t* node);
+
+/* address comparison, for qsort */
+int placed_cmp(const void* a, const void* b);
+
+/* start a traversal at the root of a frozen tree */
+void frame_root(frozen_t* frozen, frozen_frame_t* frame);
+
+/* move a frame down to the child in quadrant q, with the square split gives it */
+void frame_child(frozen_frame_t* frame, enum quadrant q, uint32_t index);
+
+/* copy a built tree into a contiguous, read-only array */
+frozen_t* freeze(qtnode_t* tree) {
+    assert(tree);
+    frozen_t* frozen = (frozen_t*) malloc(sizeof(frozen_t));
+    assert(frozen);
+    frozen->height = tree_height(tree);
+
+    // nodes in layout order, then sorted by address for linking
+    layout_t layout = {NULL, 0};
+    layout.nodes = (qtnode_t**) malloc(sizeof(qtnode_t*) * 64);
+    assert(layout.nodes);
+    veb_layout(&layout, tree, frozen->height);
+    placed_t* placed = (placed_t*) malloc(sizeof(placed_t) * layout.length);
+    assert(placed);
+    for (uint32_t i = 0; i < layout.length; i++)
+        placed[i] = (placed_t) {layout.nodes[i], i};
+    qsort(placed, layout.length, sizeof(placed_t), placed_cmp);
+
+    frozen->length = layout.length;
+    frozen->nodes = (frozen_node_t*) malloc(sizeof(frozen_node_t) * layout.length);
+    assert(frozen->nodes);
+    for (uint32_t i = 0; i < layout.length; i++) {
+        qtnode_t* node = layout.nodes[i];
+        frozen->nodes[i].point = node->point;
+        for (enum quadrant q = sw; q <= se; q++) {
+            qtnode_t* child = get_child(node, q);
+            frozen->nodes[i].child[q] = (child == NULL) ? FROZEN_NONE
+                                      : placed_index(placed, layout.length, child);
+        }
+    }
+    // the root's square, grid span included
+    frozen->bottom_left = *tree->square->bottom_left;
+    frozen->top_right = *tree->square->top_right;
+    frozen->square = *tree->square;
+    frozen->square.bottom_left = &frozen->bottom_left;
+    frozen->square.top_right = &frozen->top_right;
+
+    free(placed);
+    free(layout.nodes);
+    return frozen;
+}
+
+/* lay out the top height levels below a node in van Emde Boas order: the
+ * upper half of those levels, then every subtree below it
+ */
+void veb_layout(layout_t* layout, qtnode_t* node, int height) {
+    if (height <= 1) {
+        // the list starts at 64 entries and doubles whenever a power of 2 fills
+        if ((layout->length & (layout->length - 1)) == 0 && layout->length >= 64) {
+            layout->nodes = (qtnode_t**) realloc(layout->nodes,
+                                                 sizeof(qtnode_t*) * layout->length * 2);
+            assert(layout->nodes);
+        }
+        layout->nodes[layout->length++] = node;
+        return;
+    }
+    int top = (height + 1) / 2;
+    veb_layout(layout, node, top);
+    layout_t frontier = {NULL, 0};
+    frontier.nodes = (qtnode_t**) malloc(sizeof(qtnode_t*) * 64);
+    assert(frontier.nodes);
+    collect_depth(node, top, &frontier);
+    for (uint32_t i = 0; i < frontier.length; i++)
+        veb_layout(layout, frontier.nodes[i], height - top);
+    free(frontier.nodes);
+}
+
+/* collect the nodes exactly depth levels below a node, in quadrant order */
+void collect_depth(qtnode_t* node, int depth, layout_t* frontier) {
+    if (depth == 0) {
+        if ((frontier->length & (frontier->length - 1)) == 0 && frontier->length >= 64) {
+            frontier->nodes = (qtnode_t**) realloc(frontier->nodes,
+                                                   sizeof(qtnode_t*) * frontier->length * 2);
+            assert(frontier->nodes);
+        }
+        frontier->nodes[frontier->length++] = node;
+        return;
+    }
+    for (enum quadrant q = sw; q <= se; q++) {
+        qtnode_t* child = get_child(node, q);
+        if (child != NULL) collect_depth(child, depth - 1, frontier);
+    }
+}
+
+/* number of levels below and including a node */
+int tree_height(qtnode_t* tree) {
+    int height = 0;
+    for (enum quadrant q = sw; q <= se; q++) {
+        qtnode_t* child = get_child(tree, q);
+        if (child != NULL) {
+            int h = tree_height(child);
+            if (h > height) height = h;
+        }
+    }
+    return height + 1;
+}
+
+/* find the stored point at the same location as point; NULL if none */
+point_t* frozen_find_pt(frozen_t* frozen, point_t* point) {
+    frozen_frame_t frame;
+    frame_root(frozen, &frame);
+    GRID_POINT(&frozen->square, point);
+    frozen_node_t* node = &frozen->nodes[0];
+    while (!FROZEN_IS_LEAF(node)) {
+        enum quadrant q = QUADRANT(&frame.square, point);
+        uint32_t child = node->child[q];
+        if (child == FROZEN_NONE) return NULL;
+        frame_child(&frame, q, child);
+        node = &frozen->nodes[child];
+    }
+    return (node->point != NULL && point_cmp(node->point, point)) ? node->point : NULL;
+}
+
+/* point searching in the frozen tree */
+void frozen_search_pt(frozen_t* frozen, point_t* point) {
+    point_t* found = frozen_find_pt(frozen, point);
+    if (found != NULL)
+        printf("The point (%Lf, %Lf) has been found.\n", found->x, found->y);
+    else printf("Point not found!\n");
+}
+
+/* points within the rectangle, in search_range's order; up to max are
+ * written to out, and the number found is returned even past max
+ */
+int frozen_range(frozen_t* frozen, square_t* rectangle, point_t** out, int max) {
+    // each level leaves at most 3 siblings on the stack
+    frozen_frame_t* stack = (frozen_frame_t*) malloc(sizeof(frozen_frame_t) *
+                                                     (3 * frozen->height + 4));
+    assert(stack);
+    int size = 0, found = 0;
+    GRID_SQUARE(&frozen->square, rectangle);
+    frame_root(frozen, &stack[size++]);
+    while (size > 0) {
+        frozen_frame_t frame = stack[--size];
+        frame.square.bottom_left = &frame.bottom_left;
+        frame.square.top_right = &frame.top_right;
+        frozen_node_t* node = &frozen->nodes[frame.index];
+        if (FROZEN_IS_LEAF(node)) {
+            if (node->point != NULL && IN_RANGE(rectangle, node->point)) {
+                if (found < max) out[found] = node->point;
+                found++;
+            }
+            continue;
+        }
+        // pushed in reverse, so they are popped in search order
+        for (int i = 3; i >= 0; i--) {
+            enum quadrant q = SEARCH_ORDER[i];
+            if (node->child[q] == FROZEN_NONE) continue;
+            frozen_frame_t* child = &stack[size];
+            *child = frame;
+            child->square.bottom_left = &child->bottom_left;
+            child->square.top_right = &child->top_right;
+            frame_child(child, q, node->child[q]);
+            if (OVERLAPS(&child->square, rectangle)) size++;
+        }
+    }
+    free(stack);
+    return found;
+}
+
+/* range search all valid points in the frozen tree */
+void frozen_search_range(frozen_t* frozen, square_t* rectangle) {
+    int found = frozen_range(frozen, rectangle, NULL, 0);
+    point_t** points = (point_t**) malloc(sizeof(point_t*) * (found ? found : 1));
+    assert(points);
+    frozen_range(frozen, rectangle, points, found);
+    for (int i = 0; i < found; i++)
+        printf("Range search: (%Lf, %Lf)\n", points[i]->x, points[i]->y);
+    if (!found)
+        printf("Range search: no point found!\n");
+    free(points);
+}
+
+/* start a traversal at the root of a frozen tree */
+void frame_root(frozen_t* frozen, frozen_frame_t* frame) {
+    frame->index = 0;
+    frame->bottom_left = frozen->bottom_left;
+    frame->top_right = frozen->top_right;
+    frame->square = frozen->square;
+    frame->square.bottom_left = &frame->bottom_left;
+    frame->square.top_right = &frame->top_right;
+}
+
+/* move a frame down to the child in quadrant q, with the square split gives it */
+void frame_child(frozen_frame_t* frame, enum quadrant q, uint32_t index) {
+    square_t parent = frame->square;
+    long double xMid, yMid;
+    get_midpoints(&parent, &xMid, &yMid);
+    if (q == nw || q == sw) frame->top_right.x = xMid;
+    else frame->bottom_left.x = xMid;
+    if (q == sw || q == se) frame->top_right.y = yMid;
+    else frame->bottom_left.y = yMid;
+    GRID_CHILD(&parent, &frame->square, q);
+    frame->index = index;
+}
+
+/* the index of a node in the layout */
+uint32_t placed_index(placed_t* placed, uint32_t length, qtnode_t* node) {
+    placed_t key = {node, 0};
+    placed_t* found = (placed_t*) bsearch(&key, placed, length, sizeof(placed_t), placed_cmp);
+    assert(found);
+    return found->index;
+}
+
+/* address comparison, for qsort */
+int placed_cmp(const void* a, const void* b) {
+    qtnode_t *n1 = ((placed_t*) a)->node, *n2 = ((placed_t*) b)->node;
+    return (n1 > n2) - (n1 < n2);
+}
+
+/* free a frozen tree; its points still belong to the tree it was frozen from */
+void free_frozen(frozen_t* frozen) {
+    free(frozen->nodes);
+    free(frozen);
+}
@@ -0,0 +1,52 @@
+/*
+ * Frozen tree header: a read-only copy of a built tree in one contiguous
+ * array, laid out in van Emde Boas order - the top half of the tree's
+ * levels first, then each subtree hanging below it, each laid out the same
+ * way recursively. Any root-to-leaf descent then touches O(log_B n) blocks
+ * for every block size B, without knowing B. Children are array indices,
+ * and squares are recomputed during descent rather than stored.
+ */
+
+#include <stdint.h>
+#include "qtree.h"
+
+#ifndef QTREE_SELF_IMPLEMENTATION_FROZEN_H
+#define QTREE_SELF_IMPLEMENTATION_FROZEN_H
+
+#define FROZEN_NONE 0  // index of an absent child (the root is never a child)
+
+// structures
+typedef struct frozen_node {
+    point_t* point;
+    uint32_t child[4];
+} frozen_node_t;
+
+typedef struct frozen {
+    frozen_node_t* nodes;
+    uint32_t length;
+    int height;
+    point_t bottom_left;
+    point_t top_right;
+    square_t square;
+} frozen_t;
+
+// a node during traversal, along with its square
+typedef struct frozen_frame {
+    uint32_t index;
+    point_t bottom_left;
+    point_t top_right;
+    square_t square;
+} frozen_frame_t;
+
+#define FROZEN_IS_LEAF(node) \
+    (((node)->child[0] | (node)->child[1] | (node)->child[2] | (node)->child[3]) == FROZEN_NONE)
+
+// function prototypes
+frozen_t* freeze(qtnode_t* tree);
+point_t* frozen_find_pt(frozen_t* frozen, point_t* point);
+void frozen_search_pt(frozen_t* frozen, point_t* point);
+int frozen_range(frozen_t* frozen, square_t* rectangle, point_t** out, int max);
+void frozen_search_range(frozen_t* frozen, square_t* rectangle);
+void free_frozen(frozen_t* frozen);
+
+#endif //QTREE_SELF_IMPLEMENTATION_FROZEN_H
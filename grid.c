@@ -0,0 +1,87 @@
+/*
+ * Quantisation onto the integer grid (see grid.h). The outer square spans
+ * grid coordinates 0 to GRID_MAX on either axis; a node at depth d spans
+ * 2^(32-d) cells, aligned to that size, so the bit of weight 2^(31-d) of a
+ * point's grid coordinates tells which half of the node it lies in.
+ */
+
+#include "grid.h"
+
+/* grid coordinate of v along an axis running from lo to hi, clamped */
+grid_coord_t grid_coord(long double lo, long double hi, long double v) {
+    long double cell = (v - lo) / (hi - lo) * GRID_CELLS;
+    if (cell <= 0) return 0;
+    if (cell >= GRID_MAX) return GRID_MAX;
+    return (grid_coord_t) cell;
+}
+
+#ifdef QTREE_GRID
+
+/* quantise a point against the outer square of its tree */
+void grid_point(square_t* root, point_t* point) {
+    point->gx = grid_coord(root->bottom_left->x, root->top_right->x, point->x);
+    point->gy = grid_coord(root->bottom_left->y, root->top_right->y, point->y);
+}
+
+/* quantise a window against the outer square of the tree it queries */
+void grid_square(square_t* root, square_t* square) {
+    square->gx0 = grid_coord(root->bottom_left->x, root->top_right->x, square->bottom_left->x);
+    square->gy0 = grid_coord(root->bottom_left->y, root->top_right->y, square->bottom_left->y);
+    square->gx1 = grid_coord(root->bottom_left->x, root->top_right->x, square->top_right->x);
+    square->gy1 = grid_coord(root->bottom_left->y, root->top_right->y, square->top_right->y);
+}
+
+/* the grid span of a node's child in quadrant q; once a node is a single
+ * cell wide, its children are that same cell
+ */
+void grid_child(square_t* parent, square_t* child, enum quadrant q) {
+    grid_coord_t half = ((parent->gx1 - parent->gx0) >> 1) + 1;
+    child->gx0 = parent->gx0; child->gx1 = parent->gx1;
+    child->gy0 = parent->gy0; child->gy1 = parent->gy1;
+    if (parent->gx0 == parent->gx1) return;
+    if (q == sw || q == nw) child->gx1 = parent->gx0 + (half - 1);
+    else child->gx0 = parent->gx0 + half;
+    if (q == sw || q == se) child->gy1 = parent->gy0 + (half - 1);
+    else child->gy0 = parent->gy0 + half;
+}
+
+/* the quadrant of a point, by testing the bit halving the node's span; a
+ * single-cell node splits on its real midpoints instead
+ */
+enum quadrant grid_quad(square_t* square, point_t* point) {
+    grid_coord_t half = ((square->gx1 - square->gx0) >> 1) + 1;
+    int east, north;
+    if (square->gx0 == square->gx1) {
+        long double xMid, yMid;
+        get_midpoints(square, &xMid, &yMid);
+        east = point->x >= xMid;
+        north = point->y >= yMid;
+    }
+    else {
+        east = (point->gx & half) != 0;
+        north = (point->gy & half) != 0;
+    }
+    // (east, north): (0, 0) sw, (0, 1) nw, (1, 1) ne, (1, 0) se
+    return (enum quadrant) ((east << 1) | (east ^ north));
+}
+
+/* whether a point lies within a window; only points in the window's edge
+ * cells need their real coordinates compared
+ */
+int grid_in_sq(square_t* square, point_t* point) {
+    if (point->gx < square->gx0 || point->gx > square->gx1 ||
+        point->gy < square->gy0 || point->gy > square->gy1)
+        return 0;
+    if (point->gx > square->gx0 && point->gx < square->gx1 &&
+        point->gy > square->gy0 && point->gy < square->gy1)
+        return 1;
+    return in_sq(square, point);
+}
+
+/* whether the grid spans of 2 squares overlap */
+int grid_intersect(square_t* r1, square_t* r2) {
+    return r1->gx0 <= r2->gx1 && r2->gx0 <= r1->gx1 &&
+           r1->gy0 <= r2->gy1 && r2->gy0 <= r1->gy1;
+}
+
+#endif
@@ -0,0 +1,46 @@
+/*
+ * Grid header: quantisation of the outer square onto a 2^32 x 2^32 integer
+ * grid, enabled by building with QTREE_GRID. Points and squares then carry
+ * grid coordinates next to their real ones, quadrants are picked by testing
+ * a single bit of those coordinates, and range checks compare integers,
+ * falling back to real coordinates only in the cells on a window's edges.
+ * A point on a midline goes east or north (the cell it falls in decides),
+ * rather than following determine_quad's tie rules.
+ * Without QTREE_GRID, the macros below fall back to the real-valued checks.
+ */
+
+#include "qtree.h"
+
+#ifndef QTREE_SELF_IMPLEMENTATION_GRID_H
+#define QTREE_SELF_IMPLEMENTATION_GRID_H
+
+// grid coordinate of v along an axis from lo to hi, in any build
+grid_coord_t grid_coord(long double lo, long double hi, long double v);
+
+#ifdef QTREE_GRID
+// function prototypes
+void grid_point(square_t* root, point_t* point);
+void grid_square(square_t* root, square_t* square);
+void grid_child(square_t* parent, square_t* child, enum quadrant q);
+enum quadrant grid_quad(square_t* square, point_t* point);
+int grid_in_sq(square_t* square, point_t* point);
+int grid_intersect(square_t* r1, square_t* r2);
+
+// quadrant, containment and overlap as used by the tree's traversals; points
+// and windows must be quantised against the root first
+#define QUADRANT(square, point) grid_quad(square, point)
+#define IN_RANGE(square, point) grid_in_sq(square, point)
+#define OVERLAPS(r1, r2) grid_intersect(r1, r2)
+#define GRID_POINT(root, point) grid_point(root, point)
+#define GRID_SQUARE(root, square) grid_square(root, square)
+#define GRID_CHILD(parent, child, q) grid_child(parent, child, q)
+#else
+#define QUADRANT(square, point) determine_quad(square, point)
+#define IN_RANGE(square, point) in_sq(square, point)
+#define OVERLAPS(r1, r2) rectangle_intersect(r1, r2)
+#define GRID_POINT(root, point) ((void) 0)
+#define GRID_SQUARE(root, square) ((void) 0)
+#define GRID_CHILD(parent, child, q) ((void) 0)
+#endif
+
+#endif //QTREE_SELF_IMPLEMENTATION_GRID_H
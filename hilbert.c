@@ -0,0 +1,73 @@
+/*
+ * Hilbert curve ordering (see hilbert.h). The index of a cell is built a
+ * level at a time from the top bit down: each level adds which of the 4
+ * sub-squares the cell is in, in curve order, then rotates or flips the
+ * cell so the sub-square's part of the curve has the standard orientation.
+ */
+
+#include <stdlib.h>
+#include <assert.h>
+#include "hilbert.h"
+#include "grid.h"
+
+// a footpath along with its position on the curve
+typedef struct keyed {
+    uint64_t key;
+    footpath_t* footpath;
+} keyed_t;
+
+/* position comparison, for qsort */
+int keyed_cmp(const void* a, const void* b);
+
+/* position of a grid cell along the curve */
+uint64_t hilbert_index(uint32_t x, uint32_t y) {
+    uint64_t d = 0;
+    for (uint32_t s = 1U << 31; s > 0; s >>= 1) {
+        uint32_t rx = (x & s) != 0, ry = (y & s) != 0;
+        d += (uint64_t) s * s * ((3 * rx) ^ ry);
+        // rotate the sub-square so its curve starts at its bottom left
+        if (ry == 0) {
+            if (rx == 1) {
+                x = ~x;
+                y = ~y;
+            }
+            uint32_t t = x;
+            x = y;
+            y = t;
+        }
+    }
+    return d;
+}
+
+/* position of a point of the outer square along the curve */
+uint64_t hilbert_point(square_t* square, long double x, long double y) {
+    return hilbert_index(grid_coord(square->bottom_left->x, square->top_right->x, x),
+                         grid_coord(square->bottom_left->y, square->top_right->y, y));
+}
+
+/* reorder footpaths along the curve by the middle of their 2 ends, and pack
+ * them contiguously in that order (see pack_footpaths); the input is freed
+ */
+footpath_t** hilbert_footpaths(footpath_t** fps, int n, square_t* square) {
+    keyed_t* keys = (keyed_t*) malloc(sizeof(keyed_t) * (n ? n : 1));
+    assert(keys);
+    for (int i=0; i < n; i++) {
+        keys[i].key = hilbert_point(square, (fps[i]->start_lon + fps[i]->end_lon) / 2,
+                                    (fps[i]->start_lat + fps[i]->end_lat) / 2);
+        keys[i].footpath = fps[i];
+    }
+    qsort(keys, n, sizeof(keyed_t), keyed_cmp);
+    for (int i=0; i < n; i++) fps[i] = keys[i].footpath;
+    free(keys);
+    return pack_footpaths(fps, n);
+}
+
+/* position comparison, ties broken by id so the order is the same on every
+ * platform; for qsort
+ */
+int keyed_cmp(const void* a, const void* b) {
+    keyed_t *k1 = (keyed_t*) a, *k2 = (keyed_t*) b;
+    if (k1->key != k2->key) return (k1->key > k2->key) - (k1->key < k2->key);
+    return (k1->footpath->footpath_id > k2->footpath->footpath_id) -
+           (k1->footpath->footpath_id < k2->footpath->footpath_id);
+}
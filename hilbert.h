@@ -0,0 +1,20 @@
+/*
+ * Hilbert header: ordering along a Hilbert curve over the outer square,
+ * on the 2^32 x 2^32 grid of grid.h. Records close along the curve are
+ * close in space, so storing them in curve order keeps the records a range
+ * query returns in few, mostly sequential runs of memory.
+ */
+
+#include <stdint.h>
+#include "qtree.h"
+#include "footpath.h"
+
+#ifndef QTREE_SELF_IMPLEMENTATION_HILBERT_H
+#define QTREE_SELF_IMPLEMENTATION_HILBERT_H
+
+// function prototypes
+uint64_t hilbert_index(uint32_t x, uint32_t y);
+uint64_t hilbert_point(square_t* square, long double x, long double y);
+footpath_t** hilbert_footpaths(footpath_t** fps, int n, square_t* square);
+
+#endif //QTREE_SELF_IMPLEMENTATION_HILBERT_H
@@ -0,0 +1,111 @@
+/*
+ * Dual-tree spatial join. A node pair is pruned as soon as the squares of
+ * the two nodes are more than d apart, so whole subtrees of either tree
+ * are skipped at once rather than probing tree B once per point of tree A.
+ * Each node pair is a task on a thread pool; below JOIN_TASK_DEPTH the
+ * pairs are small enough that they are recursed into on the same thread.
+ */
+
+#include <stdlib.h>
+#include <assert.h>
+#include "join.h"
+#include "pool.h"
+
+// state shared by every task of one join
+typedef struct join_ctx {
+    pool_t* pool;
+    long double d2;
+    join_callback_t callback;
+    void* data;
+} join_ctx_t;
+
+// a single node pair to be joined
+typedef struct join_task {
+    join_ctx_t* ctx;
+    qtnode_t* a;
+    qtnode_t* b;
+    int depth;
+} join_task_t;
+
+/* join a node pair, spawning or recursing into its child pairs */
+void join_pair(join_ctx_t* ctx, qtnode_t* a, qtnode_t* b, int depth);
+
+/* pool entry for join_pair */
+void join_task_run(void* arg);
+
+/* join a node pair either as a new task or on the current thread */
+void join_child(join_ctx_t* ctx, qtnode_t* a, qtnode_t* b, int depth);
+
+
+/* spatial join of 2 trees: callback is called for every pair of points
+ * (a in treeA, b in treeB) at most d apart
+ */
+void spatial_join(qtnode_t* treeA, qtnode_t* treeB, long double d,
+                  join_callback_t callback, void* data) {
+    assert(treeA); assert(treeB); assert(callback);
+    join_ctx_t ctx;
+    ctx.pool = init_pool(pool_default_threads());
+    ctx.d2 = d * d;
+    ctx.callback = callback;
+    ctx.data = data;
+    join_child(&ctx, treeA, treeB, 0);
+    pool_wait(ctx.pool);
+    free_pool(ctx.pool);
+}
+
+/* join a node pair as a pool task if shallow enough, otherwise inline;
+ * absent children have nothing to join
+ */
+void join_child(join_ctx_t* ctx, qtnode_t* a, qtnode_t* b, int depth) {
+    if (a == NULL || b == NULL) return;
+    if (depth >= JOIN_TASK_DEPTH) {
+        join_pair(ctx, a, b, depth);
+        return;
+    }
+    join_task_t* task = (join_task_t*) malloc(sizeof(join_task_t));
+    assert(task);
+    task->ctx = ctx;
+    task->a = a;
+    task->b = b;
+    task->depth = depth;
+    pool_submit(ctx->pool, join_task_run, task);
+}
+
+/* pool entry; the task owns its own argument */
+void join_task_run(void* arg) {
+    join_task_t* task = (join_task_t*) arg;
+    join_pair(task->ctx, task->a, task->b, task->depth);
+    free(task);
+}
+
+/* join a node pair */
+void join_pair(join_ctx_t* ctx, qtnode_t* a, qtnode_t* b, int depth) {
+    int aLeaf = IS_LEAF(a), bLeaf = IS_LEAF(b);
+    // empty leaves have nothing to join
+    if ((aLeaf && a->point == NULL) || (bLeaf && b->point == NULL))
+        return;
+    // prune pairs whose squares are too far apart
+    if (square_dist2(a->square, b->square) > ctx->d2)
+        return;
+    // base case - both leaves
+    if (aLeaf && bLeaf) {
+        if (point_dist2(a->point, b->point) <= ctx->d2)
+            ctx->callback(a->point, b->point, ctx->data);
+        return;
+    }
+    // otherwise, split whichever node is the larger one (or the only internal one)
+    long double aSide = a->square->top_right->x - a->square->bottom_left->x;
+    long double bSide = b->square->top_right->x - b->square->bottom_left->x;
+    if (bLeaf || (!aLeaf && aSide >= bSide)) {
+        join_child(ctx, a->nw, b, depth+1);
+        join_child(ctx, a->ne, b, depth+1);
+        join_child(ctx, a->sw, b, depth+1);
+        join_child(ctx, a->se, b, depth+1);
+    }
+    else {
+        join_child(ctx, a, b->nw, depth+1);
+        join_child(ctx, a, b->ne, depth+1);
+        join_child(ctx, a, b->sw, depth+1);
+        join_child(ctx, a, b->se, depth+1);
+    }
+}
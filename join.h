@@ -0,0 +1,21 @@
+/*
+ * Spatial join header: finds every pair of points, one from each of two
+ * trees, lying within a given distance of each other by traversing both
+ * trees together. Distances are Euclidean, in the trees' coordinate units.
+ */
+
+#include "qtree.h"
+
+#ifndef QTREE_SELF_IMPLEMENTATION_JOIN_H
+#define QTREE_SELF_IMPLEMENTATION_JOIN_H
+
+#define JOIN_TASK_DEPTH 6  // node pairs deeper than this are joined inline
+
+/* called once per matching pair; may be called from several threads at once */
+typedef void (*join_callback_t)(point_t* a, point_t* b, void* data);
+
+// function prototypes
+void spatial_join(qtnode_t* treeA, qtnode_t* treeB, long double d,
+                  join_callback_t callback, void* data);
+
+#endif //QTREE_SELF_IMPLEMENTATION_JOIN_H
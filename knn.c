@@ -0,0 +1,127 @@
+/*
+ * Best-first k-nearest neighbour search. Nodes wait in a min-heap keyed by
+ * the distance from the query to their square; the search stops once the
+ * nearest waiting square is further away than the k-th best point so far.
+ * Subtrees that cannot match the filter never enter the heap. Points at the
+ * same distance are ordered by x, then y, so that the k found, and their
+ * order, never depend on the shape of the tree.
+ */
+
+#include <stdlib.h>
+#include <assert.h>
+#include "knn.h"
+
+// a heap entry: a node and the squared distance to its square
+typedef struct knn_entry {
+    long double dist;
+    qtnode_t* node;
+} knn_entry_t;
+
+typedef struct knn_heap {
+    knn_entry_t* entries;
+    int length;
+    int capacity;
+} knn_heap_t;
+
+/* push a node onto the heap */
+void knn_push(knn_heap_t* heap, qtnode_t* node, long double dist);
+
+/* pop the nearest node off the heap */
+knn_entry_t knn_pop(knn_heap_t* heap);
+
+/* whether a point at squared distance d1 comes before one at d2: nearer
+ * first, then by x, then by y
+ */
+int knn_before(long double d1, point_t* p1, long double d2, point_t* p2);
+
+
+/* k nearest points to query (that match filter, if not NULL), written to
+ * out nearest first; returns the number of points found, at most k
+ */
+int search_knn(qtnode_t* tree, point_t* query, int k, filter_t* filter, point_t** out) {
+    assert(tree); assert(query); assert(out || k <= 0);
+    if (k <= 0) return 0;
+    long double* best = (long double*) malloc(sizeof(long double) * k);
+    assert(best);
+    knn_heap_t heap;
+    heap.length = 0;
+    heap.capacity = KNN_INIT_CAP;
+    heap.entries = (knn_entry_t*) malloc(sizeof(knn_entry_t) * heap.capacity);
+    assert(heap.entries);
+    int n = 0;
+    if (!filter_prune(filter, tree))
+        knn_push(&heap, tree, point_square_dist2(query, tree->square));
+    while (heap.length > 0) {
+        knn_entry_t entry = knn_pop(&heap);
+        // nothing left can beat the current k-th best
+        if (n == k && entry.dist > best[k-1]) break;
+        qtnode_t* node = entry.node;
+        // base case - leaf node; insertion sort into the best k
+        if (IS_LEAF(node)) {
+            if (node->point == NULL || !filter_match_point(filter, node->point))
+                continue;
+            long double dist = point_dist2(query, node->point);
+            if (n == k && !knn_before(dist, node->point, best[k-1], out[k-1])) continue;
+            int i = (n < k) ? n++ : k-1;
+            for (; i > 0 && knn_before(dist, node->point, best[i-1], out[i-1]); i--) {
+                best[i] = best[i-1];
+                out[i] = out[i-1];
+            }
+            best[i] = dist;
+            out[i] = node->point;
+            continue;
+        }
+        qtnode_t* children[4] = {node->nw, node->ne, node->sw, node->se};
+        for (int c=0; c < 4; c++) {
+            if (children[c] == NULL || filter_prune(filter, children[c])) continue;
+            knn_push(&heap, children[c], point_square_dist2(query, children[c]->square));
+        }
+    }
+    free(heap.entries);
+    free(best);
+    return n;
+}
+
+/* whether a point at squared distance d1 comes before one at d2: nearer
+ * first, then by x, then by y
+ */
+int knn_before(long double d1, point_t* p1, long double d2, point_t* p2) {
+    if (d1 != d2) return d1 < d2;
+    if (p1->x != p2->x) return p1->x < p2->x;
+    return p1->y < p2->y;
+}
+
+/* push onto the heap, sifting up */
+void knn_push(knn_heap_t* heap, qtnode_t* node, long double dist) {
+    if (heap->length == heap->capacity) {
+        heap->capacity *= 2;
+        heap->entries = (knn_entry_t*) realloc(heap->entries,
+                                               sizeof(knn_entry_t) * heap->capacity);
+        assert(heap->entries);
+    }
+    int i = heap->length++;
+    while (i > 0 && heap->entries[(i-1)/2].dist > dist) {
+        heap->entries[i] = heap->entries[(i-1)/2];
+        i = (i-1)/2;
+    }
+    heap->entries[i].dist = dist;
+    heap->entries[i].node = node;
+}
+
+/* pop off the heap, sifting down */
+knn_entry_t knn_pop(knn_heap_t* heap) {
+    assert(heap->length > 0);
+    knn_entry_t top = heap->entries[0];
+    knn_entry_t last = heap->entries[--heap->length];
+    int i = 0, child;
+    while ((child = 2*i + 1) < heap->length) {
+        if (child+1 < heap->length &&
+            heap->entries[child+1].dist < heap->entries[child].dist)
+            child++;
+        if (heap->entries[child].dist >= last.dist) break;
+        heap->entries[i] = heap->entries[child];
+        i = child;
+    }
+    heap->entries[i] = last;
+    return top;
+}
@@ -0,0 +1,18 @@
+/*
+ * k-nearest neighbour search header: best-first search over the tree's
+ * squares, nearest square first, optionally restricted by an attribute
+ * filter (see filter.h). Ties in distance are broken by coordinates.
+ */
+
+#include "qtree.h"
+#include "filter.h"
+
+#ifndef QTREE_SELF_IMPLEMENTATION_KNN_H
+#define QTREE_SELF_IMPLEMENTATION_KNN_H
+
+#define KNN_INIT_CAP 64  // initial capacity of the search's node heap
+
+// function prototypes
+int search_knn(qtnode_t* tree, point_t* query, int k, filter_t* filter, point_t** out);
+
+#endif //QTREE_SELF_IMPLEMENTATION_KNN_H
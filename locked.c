@@ -0,0 +1,180 @@
+/*
+ * Locked tree (see locked.h). A node only ever changes in two ways: a leaf
+ * takes a point or splits, or an internal node gains a child. Either is
+ * done with the node's lock held, and new children are built in full
+ * before a release store publishes them, as in rcu.c, so a writer passing
+ * through without the lock always sees complete nodes. An internal node
+ * never becomes a leaf again, and a leaf's point is only read with its
+ * lock held.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <assert.h>
+#include "locked.h"
+#include "rcu.h"
+#include "pool.h"
+#include "grid.h"
+
+// a slice of the points given to parallel_insert, inserted by one task
+typedef struct locked_task {
+    locked_tree_t* tree;
+    int writer;
+    point_t** points;
+    int n;
+} locked_task_t;
+
+/* the lock guarding a node */
+pthread_mutex_t* node_lock(locked_tree_t* tree, qtnode_t* node);
+
+/* pool entry inserting a slice of points with its writer id */
+void locked_task_run(void* arg);
+
+/* an empty node over the square of node, to build children on unseen;
+ * node itself is not copied, as other writers update its counters
+ */
+void init_scratch(qtnode_t* scratch, qtnode_t* node);
+
+/* initialize an empty tree over a square for many writers */
+locked_tree_t* init_locked_tree(square_t* square) {
+    locked_tree_t* tree = (locked_tree_t*) malloc(sizeof(locked_tree_t));
+    assert(tree);
+    tree->root = init_tree(square);
+    for (int i=0; i < LOCKED_STRIPES; i++)
+        pthread_mutex_init(&tree->locks[i], NULL);
+    tree->nwriters = 0;
+    tree->ntask_writers = 0;
+    return tree;
+}
+
+/* register a writer, returning the writer id it inserts with */
+int locked_register(locked_tree_t* tree) {
+    int writer = __atomic_fetch_add(&tree->nwriters, 1, __ATOMIC_SEQ_CST);
+    assert(writer < LOCKED_MAX_WRITERS);
+    tree->arenas[writer] = init_arena(ARENA_BLOCK_SIZE);
+    return writer;
+}
+
+/* insert a data point to the tree; any number of writers may insert at
+ * once, each with its own writer id
+ */
+void locked_insert(locked_tree_t* tree, int writer, point_t* point) {
+    arena_t* arena = tree->arenas[writer];
+    qtnode_t* node = tree->root;
+    GRID_POINT(node->square, point);
+    __atomic_or_fetch(&node->categories, point->category, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&node->generation, 1, __ATOMIC_RELAXED);
+    for (;;) {
+        if (RCU_LOAD(&node->occupied) != 0) {
+            enum quadrant q = QUADRANT(node->square, point);
+            qtnode_t** slot = child_slot(node, q);
+            qtnode_t* child = RCU_LOAD(slot);
+            if (child == NULL) {
+                pthread_mutex_t* lock = node_lock(tree, node);
+                pthread_mutex_lock(lock);
+                if (*slot != NULL) {
+                    // another writer filled the quadrant first
+                    pthread_mutex_unlock(lock);
+                    continue;
+                }
+                // the leaf is made on a scratch node over the same square
+                qtnode_t scratch;
+                init_scratch(&scratch, node);
+                qtnode_t* leaf = split(&scratch, q, arena);
+                leaf->point = point;
+                leaf->categories = point->category;
+                RCU_PUBLISH(slot, leaf);
+                __atomic_or_fetch(&node->occupied, 1 << q, __ATOMIC_RELEASE);
+                pthread_mutex_unlock(lock);
+                return;
+            }
+            node = child;
+            __atomic_or_fetch(&node->categories, point->category, __ATOMIC_RELAXED);
+            __atomic_add_fetch(&node->generation, 1, __ATOMIC_RELAXED);
+            continue;
+        }
+        pthread_mutex_t* lock = node_lock(tree, node);
+        pthread_mutex_lock(lock);
+        if (RCU_LOAD(&node->occupied) != 0) {
+            // another writer split the leaf first
+            pthread_mutex_unlock(lock);
+            continue;
+        }
+        if (node->point == NULL)
+            node->point = point;
+        // the 2 points must not be the same, as in split_insert
+        else if (point_cmp(node->point, point))
+            node->point = merge_duplicate(node->point, point, arena);
+        else {
+            // the leaf splits in place; its children are built on a scratch
+            // node and all stored before one release store of the mask
+            qtnode_t scratch;
+            init_scratch(&scratch, node);
+            rcu_separate(&scratch, node->point, point, arena);
+            node->point = NULL;
+            for (enum quadrant q = sw; q <= se; q++)
+                RCU_PUBLISH(child_slot(node, q), get_child(&scratch, q));
+            RCU_PUBLISH(&node->occupied, scratch.occupied);
+        }
+        pthread_mutex_unlock(lock);
+        return;
+    }
+}
+
+/* insert n points with nthreads writers, each taking a contiguous slice;
+ * returns once all are in. The i-th slice is inserted by the i-th task
+ * writer, registered by the first call that needs it and reused by every
+ * later one, so calls must not overlap
+ */
+void parallel_insert(locked_tree_t* tree, point_t** points, int n, int nthreads) {
+    assert(nthreads > 0);
+    while (tree->ntask_writers < nthreads)
+        tree->task_writers[tree->ntask_writers++] = locked_register(tree);
+    pool_t* pool = init_pool(nthreads);
+    locked_task_t* tasks = (locked_task_t*) malloc(sizeof(locked_task_t) * nthreads);
+    assert(tasks);
+    for (int i=0; i < nthreads; i++) {
+        int from = (int) ((long long) n * i / nthreads);
+        int to = (int) ((long long) n * (i+1) / nthreads);
+        tasks[i] = (locked_task_t) {tree, tree->task_writers[i], points + from, to - from};
+        pool_submit(pool, locked_task_run, &tasks[i]);
+    }
+    pool_wait(pool);
+    free_pool(pool);
+    free(tasks);
+}
+
+/* pool entry inserting a slice of points with its writer id */
+void locked_task_run(void* arg) {
+    locked_task_t* task = (locked_task_t*) arg;
+    for (int i=0; i < task->n; i++)
+        locked_insert(task->tree, task->writer, task->points[i]);
+}
+
+/* an empty node over the square of node, to build children on unseen */
+void init_scratch(qtnode_t* scratch, qtnode_t* node) {
+    scratch->point = NULL;
+    scratch->square = node->square;
+    scratch->arena = NULL;
+    scratch->categories = 0;
+    scratch->generation = 0;
+    scratch->occupied = 0;
+    scratch->nw = scratch->ne = scratch->sw = scratch->se = NULL;
+}
+
+/* the lock guarding a node, picked by a multiplicative hash of its address */
+pthread_mutex_t* node_lock(locked_tree_t* tree, qtnode_t* node) {
+    uint64_t hash = (uint64_t) (uintptr_t) node * 11400714819323198485ULL;
+    return &tree->locks[hash >> 54 & (LOCKED_STRIPES - 1)];
+}
+
+/* free the tree once every writer is done; points belong to the caller */
+void free_locked_tree(locked_tree_t* tree) {
+    assert(tree);
+    for (int i=0; i < tree->nwriters; i++)
+        free_arena(tree->arenas[i]);
+    for (int i=0; i < LOCKED_STRIPES; i++)
+        pthread_mutex_destroy(&tree->locks[i]);
+    free_tree(tree->root);
+    free(tree);
+}
@@ -0,0 +1,42 @@
+/*
+ * Locked tree header: a tree that many writers insert into at once. A
+ * writer descends without taking any lock, reading children as rcu.h's
+ * readers do, and only locks the node it is about to change: the leaf it
+ * splits or fills, or the node whose empty quadrant it fills. Having
+ * locked it, it checks the node is still what it saw, and otherwise goes
+ * on down from there. Locks are striped over a fixed table by node
+ * address, so nodes need no lock of their own; as nodes near the root
+ * soon stop changing, writers spread over the plane rarely meet. Each
+ * writer allocates from an arena of its own. parallel_insert registers its
+ * writers once and has later calls reuse them, so a tree may be built by
+ * any number of calls, one at a time. Once every writer is done, the root
+ * is an ordinary tree for the searches of qtree.h.
+ */
+
+#include <pthread.h>
+#include "qtree.h"
+
+#ifndef QTREE_SELF_IMPLEMENTATION_LOCKED_H
+#define QTREE_SELF_IMPLEMENTATION_LOCKED_H
+
+#define LOCKED_STRIPES 1024      // locks shared out among the nodes, a power of 2
+#define LOCKED_MAX_WRITERS 256   // maximum number of registered writers
+
+// structures
+typedef struct locked_tree {
+    qtnode_t* root;
+    pthread_mutex_t locks[LOCKED_STRIPES];
+    arena_t* arenas[LOCKED_MAX_WRITERS];
+    int nwriters;
+    int task_writers[LOCKED_MAX_WRITERS];  // writer ids of parallel_insert's tasks
+    int ntask_writers;
+} locked_tree_t;
+
+// function prototypes
+locked_tree_t* init_locked_tree(square_t* square);
+int locked_register(locked_tree_t* tree);
+void locked_insert(locked_tree_t* tree, int writer, point_t* point);
+void parallel_insert(locked_tree_t* tree, point_t** points, int n, int nthreads);
+void free_locked_tree(locked_tree_t* tree);
+
+#endif //QTREE_SELF_IMPLEMENTATION_LOCKED_H
@@ -3,13 +3,62 @@
  * 1. manual inputs to manually construct the quad tree, as well as
  *    other operations, namely insertion and searches.
  * 2. pass arguments from terminal (stdin).
+ * 3. stage 3 / 4 queries over a footpath dataset:
+ *    quadtree-in-c <3|4> dataset.csv output.txt x1 y1 x2 y2 [--hilbert] < queries
+ *    footpaths found go to output.txt, quadrants visited to stdout;
+ *    --hilbert stores the footpaths in Hilbert curve order once loaded.
+ * 4. a query server over a footpath dataset (see server.h):
+ *    quadtree-in-c --serve socket dataset.csv x1 y1 x2 y2 [--hilbert]
+ *    loads the dataset once, then answers requests at the Unix domain
+ *    socket (or TCP "host:port") until interrupted.
+ * 5. one shard of a footpath dataset split over 4^level servers, and the
+ *    coordinator answering clients from all of them (see shard.h):
+ *    quadtree-in-c --shard socket dataset.csv x1 y1 x2 y2 level index [--hilbert]
+ *    quadtree-in-c --coordinate socket x1 y1 x2 y2 level shard-socket...
+ *    the coordinator takes the shards' sockets in index order.
+ * Passing "--stats" alone runs case 1, printing the traversal statistics of
+ * every insertion and search to stderr (when built with QTREE_STATS).
  * The outer square covering all points will be referred to as o.s.
  */
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include "queue.h"
 #include "read.h"
+#include "stats.h"
+#include "stage.h"
+#include "hilbert.h"
+#include "server.h"
+
+#define STAGE_ARGS 8       // number of arguments of a stage 3 / 4 run
+#define SHARD_ARGS 10      // number of arguments of a shard server
+#define COORDINATE_ARGS 8  // number of arguments of a coordinator, before its shards
+
+/* run stage 3 or 4 queries from stdin over a footpath dataset */
+int stage_run(char** argv, int hilbert);
+
+/* serve queries over a footpath dataset at a Unix domain socket */
+int serve_run(char** argv, int hilbert);
+
+/* serve one shard of a footpath dataset */
+int shard_run(char** argv, int hilbert);
+
+/* serve queries over a sharded footpath dataset, asking its shards */
+int coordinate_run(int argc, char** argv);
+
+/* load a footpath dataset into a tree over the o.s of the 4 corner
+ * coordinates, keeping one shard of a map unless map is NULL; n and fps
+ * are set to its footpaths
+ */
+qtnode_t* load_tree(char* dataset, char** corners, int hilbert, shard_map_t* map, int shard,
+                    footpath_t*** fps, int* n);
+
+/* the o.s of the 4 corner coordinates */
+square_t* corner_square(char** corners);
+
+/* free a tree made by load_tree along with its footpaths */
+void unload_tree(qtnode_t* tree, footpath_t** fps, int n, int hilbert);
 
 /* program's entry */
 int main(int argc, char** argv) {
@@ -17,6 +66,46 @@ int main(int argc, char** argv) {
     if (argc <= 1)
         return manual_input();
 
+    /* case 1, dumping traversal statistics of every operation */
+    if (argc == 2 && strcmp(argv[1], "--stats") == 0) {
+        stats_verbose = 1;
+        if (!STATS_ENABLED)
+            fprintf(stderr, "WARNING: built without QTREE_STATS, no statistics to dump\n");
+        int status = manual_input();
+        print_total_stats(stderr);
+        return status;
+    }
+
+    /* case 4: query server over a footpath dataset */
+    if (strcmp(argv[1], "--serve") == 0) {
+        if (argc == STAGE_ARGS)
+            return serve_run(argv, 0);
+        if (argc == STAGE_ARGS+1 && strcmp(argv[STAGE_ARGS], "--hilbert") == 0)
+            return serve_run(argv, 1);
+        fprintf(stderr, "Usage: %s --serve socket dataset.csv x1 y1 x2 y2 [--hilbert]\n",
+                argv[0]);
+        exit(EXIT_FAILURE);
+    }
+
+    /* case 5: a shard of a footpath dataset, and their coordinator */
+    if (strcmp(argv[1], "--shard") == 0) {
+        if (argc == SHARD_ARGS)
+            return shard_run(argv, 0);
+        if (argc == SHARD_ARGS+1 && strcmp(argv[SHARD_ARGS], "--hilbert") == 0)
+            return shard_run(argv, 1);
+        fprintf(stderr, "Usage: %s --shard socket dataset.csv x1 y1 x2 y2 level index "
+                        "[--hilbert]\n", argv[0]);
+        exit(EXIT_FAILURE);
+    }
+    if (strcmp(argv[1], "--coordinate") == 0)
+        return coordinate_run(argc, argv);
+
+    /* case 3: stage 3 / 4 queries over a footpath dataset */
+    if (argc == STAGE_ARGS)
+        return stage_run(argv, 0);
+    if (argc == STAGE_ARGS+1 && strcmp(argv[STAGE_ARGS], "--hilbert") == 0)
+        return stage_run(argv, 1);
+
     /* case 2: terminal, or text file passed as argument */
     /// WIP
     else if (argc < MIN_ARGS) {
@@ -29,5 +118,124 @@ int main(int argc, char** argv) {
     point_t *tR = init_point(strtold(argv[3], NULL), strtold(argv[4], NULL));
     qtnode_t* tree = init_tree(init_square(bL, tR));
     print_tree(tree);
+    free_tree(tree);
+    free(bL);
+    free(tR);
     return 1;
 }
+
+/* run stage 3 or 4 queries from stdin over a footpath dataset */
+int stage_run(char** argv, int hilbert) {
+    int stage = atoi(argv[1]);
+    if (stage != STAGE_POINT && stage != STAGE_RANGE) {
+        fprintf(stderr, "Stage must be %d or %d!\n", STAGE_POINT, STAGE_RANGE);
+        exit(EXIT_FAILURE);
+    }
+    FILE* out = fopen(argv[3], "w");
+    if (out == NULL) {
+        fprintf(stderr, "Cannot open %s!\n", argv[3]);
+        exit(EXIT_FAILURE);
+    }
+    int n;
+    footpath_t** fps;
+    qtnode_t* tree = load_tree(argv[2], argv + 4, hilbert, NULL, 0, &fps, &n);
+    stage_query(tree, stage, stdin, out, stdout);
+    fclose(out);
+    unload_tree(tree, fps, n, hilbert);
+    return 0;
+}
+
+/* serve queries over a footpath dataset at a Unix domain socket */
+int serve_run(char** argv, int hilbert) {
+    int n;
+    footpath_t** fps;
+    qtnode_t* tree = load_tree(argv[3], argv + 4, hilbert, NULL, 0, &fps, &n);
+    int status = serve_footpaths(argv[2], tree);
+    unload_tree(tree, fps, n, hilbert);
+    return (status == 0) ? 0 : EXIT_FAILURE;
+}
+
+/* serve one shard of a footpath dataset */
+int shard_run(char** argv, int hilbert) {
+    int level = atoi(argv[8]), shard = atoi(argv[9]);
+    if (level < 0 || level > SHARD_MAX_LEVEL || shard < 0 || shard >= 1 << (2 * level)) {
+        fprintf(stderr, "No shard %s of level %s!\n", argv[9], argv[8]);
+        exit(EXIT_FAILURE);
+    }
+    square_t* square = corner_square(argv + 4);
+    point_t* bL = square->bottom_left;
+    point_t* tR = square->top_right;
+    shard_map_t* map = init_shard_map(square, level);
+    int n;
+    footpath_t** fps;
+    qtnode_t* tree = load_tree(argv[3], argv + 4, hilbert, map, shard, &fps, &n);
+    int status = serve_footpaths(argv[2], tree);
+    unload_tree(tree, fps, n, hilbert);
+    free_shard_map(map);
+    free(bL);
+    free(tR);
+    return (status == 0) ? 0 : EXIT_FAILURE;
+}
+
+/* serve queries over a sharded footpath dataset, asking its shards */
+int coordinate_run(int argc, char** argv) {
+    int level = (argc > COORDINATE_ARGS) ? atoi(argv[COORDINATE_ARGS-1]) : -1;
+    if (level < 0 || level > SHARD_MAX_LEVEL ||
+        argc != COORDINATE_ARGS + (1 << (2 * level))) {
+        fprintf(stderr, "Usage: %s --coordinate socket x1 y1 x2 y2 level shard-socket..."
+                        " (4^level of them)\n", argv[0]);
+        exit(EXIT_FAILURE);
+    }
+    square_t* square = corner_square(argv + 3);
+    point_t* bL = square->bottom_left;
+    point_t* tR = square->top_right;
+    shard_map_t* map = init_shard_map(square, level);
+    coordinator_t* coordinator = init_coordinator(map, argv + COORDINATE_ARGS);
+    int status = -1;
+    if (coordinator != NULL) {
+        status = server_serve(argv[2], coordinator_handler, coordinator);
+        free_coordinator(coordinator);
+    }
+    free_shard_map(map);
+    free(bL);
+    free(tR);
+    return (status == 0) ? 0 : EXIT_FAILURE;
+}
+
+/* load a footpath dataset into a tree over the o.s of the 4 corner
+ * coordinates, keeping one shard of a map unless map is NULL; n and fps
+ * are set to its footpaths
+ */
+qtnode_t* load_tree(char* dataset, char** corners, int hilbert, shard_map_t* map, int shard,
+                    footpath_t*** fps, int* n) {
+    FILE* data = fopen(dataset, "r");
+    if (data == NULL) {
+        fprintf(stderr, "Cannot open %s!\n", dataset);
+        exit(EXIT_FAILURE);
+    }
+    *fps = read_footpaths(data, n);
+    fclose(data);
+
+    // the outer square, followed by the queries
+    square_t* square = corner_square(corners);
+    if (hilbert) *fps = hilbert_footpaths(*fps, *n, square);
+    return footpath_shard_tree(*fps, *n, square, map, shard);
+}
+
+/* the o.s of the 4 corner coordinates */
+square_t* corner_square(char** corners) {
+    point_t *bL = init_point(strtold(corners[0], NULL), strtold(corners[1], NULL));
+    point_t *tR = init_point(strtold(corners[2], NULL), strtold(corners[3], NULL));
+    return init_square(bL, tR);
+}
+
+/* free a tree made by load_tree along with its footpaths */
+void unload_tree(qtnode_t* tree, footpath_t** fps, int n, int hilbert) {
+    point_t* bL = tree->square->bottom_left;
+    point_t* tR = tree->square->top_right;
+    free_tree(tree);
+    if (hilbert) free_packed_footpaths(fps, n);
+    else free_footpaths(fps, n);
+    free(bL);
+    free(tR);
+}
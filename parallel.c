@@ -0,0 +1,165 @@
+/*
+ * Parallel range search (see parallel.h). Each task keeps the points it
+ * finds itself, in order, and notes where in that order each subtree it
+ * split off belongs; once the pool is done, the tasks are walked from the
+ * root one to lay every point out in search_range's order.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include "parallel.h"
+#include "grid.h"
+
+typedef struct range_task range_task_t;
+
+// a subtree split off by a task, whose points come before its points[at]
+typedef struct range_split {
+    int at;
+    range_task_t* task;
+} range_split_t;
+
+// a subtree searched as a task of its own
+struct range_task {
+    pool_t* pool;
+    square_t* rectangle;
+    qtnode_t* node;
+    point_t** points;
+    int length;
+    int capacity;
+    range_split_t* splits;
+    int nsplits;
+    int splits_capacity;
+};
+
+/* a task searching the subtree below node */
+range_task_t* init_range_task(pool_t* pool, square_t* rectangle, qtnode_t* node);
+
+/* pool entry searching a task's subtree */
+void range_task_run(void* arg);
+
+/* search below a node for a task, splitting off child subtrees as tasks
+ * while the worker has too few queued
+ */
+void range_task_level(range_task_t* task, qtnode_t* node);
+
+/* number of points found by a task and every task split off from it */
+int range_task_count(range_task_t* task);
+
+/* lay out the points of a task and of its split-off tasks, in order, from
+ * out[found]; the tasks are freed along the way
+ */
+void range_task_gather(range_task_t* task, point_t** out, int* found);
+
+/* the points within the rectangle, in search_range's order, searched by
+ * the pool's workers; points is set to a new array the caller frees, and
+ * the number of points is returned. The pool must not be running anything
+ * else meanwhile
+ */
+int parallel_range(pool_t* pool, qtnode_t* tree, square_t* rectangle, point_t*** points) {
+    assert(pool); assert(tree);
+    GRID_SQUARE(tree->square, rectangle);
+    range_task_t* root = init_range_task(pool, rectangle, tree);
+    pool_submit(pool, range_task_run, root);
+    pool_wait(pool);
+    int total = range_task_count(root);
+    *points = (point_t**) malloc(sizeof(point_t*) * (total ? total : 1));
+    assert(*points);
+    int found = 0;
+    range_task_gather(root, *points, &found);
+    return found;
+}
+
+/* range search all valid points in tree on the pool's workers */
+void search_range_parallel(pool_t* pool, qtnode_t* tree, square_t* rectangle) {
+    point_t** points;
+    int found = parallel_range(pool, tree, rectangle, &points);
+    for (int i=0; i < found; i++)
+        printf("Range search: (%Lf, %Lf)\n", points[i]->x, points[i]->y);
+    if (!found)
+        printf("Range search: no point found!\n");
+    free(points);
+}
+
+/* a task searching the subtree below node */
+range_task_t* init_range_task(pool_t* pool, square_t* rectangle, qtnode_t* node) {
+    range_task_t* task = (range_task_t*) malloc(sizeof(range_task_t));
+    assert(task);
+    task->pool = pool;
+    task->rectangle = rectangle;
+    task->node = node;
+    task->length = 0;
+    task->capacity = 0;
+    task->points = NULL;
+    task->nsplits = 0;
+    task->splits_capacity = 0;
+    task->splits = NULL;
+    return task;
+}
+
+/* pool entry searching a task's subtree */
+void range_task_run(void* arg) {
+    range_task_t* task = (range_task_t*) arg;
+    range_task_level(task, task->node);
+}
+
+/* search below a node for a task, splitting off child subtrees as tasks
+ * while the worker has too few queued
+ */
+void range_task_level(range_task_t* task, qtnode_t* node) {
+    if (IS_LEAF(node)) {
+        if (node->point == NULL || !IN_RANGE(task->rectangle, node->point)) return;
+        if (task->length == task->capacity) {
+            task->capacity = task->capacity ? task->capacity * 2 : PARALLEL_INIT_CAP;
+            task->points = (point_t**) realloc(task->points, sizeof(point_t*) * task->capacity);
+            assert(task->points);
+        }
+        task->points[task->length++] = node->point;
+        return;
+    }
+    qtnode_t* children[4] = {node->nw, node->ne, node->sw, node->se};
+    for (int i=0; i < 4; i++) {
+        if (children[i] == NULL || !OVERLAPS(children[i]->square, task->rectangle))
+            continue;
+        if (IS_LEAF(children[i]) ||
+            pool_local_tasks(task->pool) >= PARALLEL_SPLIT_TASKS) {
+            range_task_level(task, children[i]);
+            continue;
+        }
+        if (task->nsplits == task->splits_capacity) {
+            task->splits_capacity = task->splits_capacity ? task->splits_capacity * 2 : 4;
+            task->splits = (range_split_t*) realloc(task->splits,
+                                                    sizeof(range_split_t) * task->splits_capacity);
+            assert(task->splits);
+        }
+        range_split_t* split = &task->splits[task->nsplits++];
+        split->at = task->length;
+        split->task = init_range_task(task->pool, task->rectangle, children[i]);
+        pool_submit(task->pool, range_task_run, split->task);
+    }
+}
+
+/* number of points found by a task and every task split off from it */
+int range_task_count(range_task_t* task) {
+    int count = task->length;
+    for (int i=0; i < task->nsplits; i++)
+        count += range_task_count(task->splits[i].task);
+    return count;
+}
+
+/* lay out the points of a task and of its split-off tasks, in order, from
+ * out[found]; the tasks are freed along the way
+ */
+void range_task_gather(range_task_t* task, point_t** out, int* found) {
+    int next = 0;
+    for (int i=0; i <= task->nsplits; i++) {
+        int until = (i < task->nsplits) ? task->splits[i].at : task->length;
+        for (; next < until; next++)
+            out[(*found)++] = task->points[next];
+        if (i < task->nsplits)
+            range_task_gather(task->splits[i].task, out, found);
+    }
+    free(task->points);
+    free(task->splits);
+    free(task);
+}
@@ -0,0 +1,23 @@
+/*
+ * Parallel range search header: range search split into subtree tasks on
+ * a work-stealing pool (see pool.h). A task searches its subtree itself,
+ * handing a child subtree off as a task of its own only while its worker
+ * has no other task queued for idle workers to steal, so that the work is
+ * split as finely as the idle workers need, and no finer, however skewed
+ * the tree. The points are put back together in search_range's order.
+ */
+
+#include "qtree.h"
+#include "pool.h"
+
+#ifndef QTREE_SELF_IMPLEMENTATION_PARALLEL_H
+#define QTREE_SELF_IMPLEMENTATION_PARALLEL_H
+
+#define PARALLEL_SPLIT_TASKS 2  // queued tasks below which a task splits off more
+#define PARALLEL_INIT_CAP 64    // initial capacity of a task's point buffer
+
+// function prototypes
+int parallel_range(pool_t* pool, qtnode_t* tree, square_t* rectangle, point_t*** points);
+void search_range_parallel(pool_t* pool, qtnode_t* tree, square_t* rectangle);
+
+#endif //QTREE_SELF_IMPLEMENTATION_PARALLEL_H
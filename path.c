@@ -0,0 +1,27 @@
+/*
+ * Quadrant codes (see path.h), rendered a buffer at a time.
+ */
+
+#include <string.h>
+#include "path.h"
+
+#define PATH_TEXT_LEN 3  // length of a rendered step, e.g. " SW"
+
+// quadrant codes, (east << 1 | north), indexed by enum quadrant
+const unsigned char QUADRANT_CODE[4] = {0, 1, 3, 2};
+// rendered steps, indexed by code
+static const char CODE_STR[4][PATH_TEXT_LEN + 1] = {" SW", " NW", " SE", " NE"};
+
+/* print a sequence of codes as " SW NE ...", one table lookup per code and
+ * one write per buffer
+ */
+void print_codes(FILE* f, unsigned char* codes, int n) {
+    char text[PATH_PRINT_LEVELS * PATH_TEXT_LEN + 1];
+    for (int i = 0; i < n; i += PATH_PRINT_LEVELS) {
+        int m = (n - i < PATH_PRINT_LEVELS) ? n - i : PATH_PRINT_LEVELS;
+        for (int j = 0; j < m; j++)
+            memcpy(text + j * PATH_TEXT_LEN, CODE_STR[codes[i + j]], PATH_TEXT_LEN);
+        text[m * PATH_TEXT_LEN] = '\0';
+        fputs(text, f);
+    }
+}
@@ -0,0 +1,23 @@
+/*
+ * Path header: the quadrants a query enters, kept as one 2-bit code per
+ * quadrant. A code is (east << 1 | north), so a sequence of codes down the
+ * tree follows Morton (Z) order. Codes are only turned into text such as
+ * "SW NE" when printed.
+ */
+
+#include <stdio.h>
+#include "qtree.h"
+
+#ifndef QTREE_SELF_IMPLEMENTATION_PATH_H
+#define QTREE_SELF_IMPLEMENTATION_PATH_H
+
+#define PATH_PRINT_LEVELS 64  // codes rendered per write
+
+// 2-bit code of a quadrant
+#define PATH_CODE(q) (QUADRANT_CODE[q])
+extern const unsigned char QUADRANT_CODE[4];
+
+// function prototypes
+void print_codes(FILE* f, unsigned char* codes, int n);
+
+#endif //QTREE_SELF_IMPLEMENTATION_PATH_H
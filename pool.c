@@ -0,0 +1,226 @@
+/*
+ * A work-stealing thread pool. A worker looks for a task in its own deque
+ * first, then in the shared queue, then in the other workers' deques;
+ * only when all are empty does it sleep on has_work. pending counts tasks
+ * that are queued or running, so that pool_wait knows when all work (and
+ * all work spawned by that work) is done. A worker pushing onto its deque
+ * takes no lock unless some worker is asleep and has to be woken.
+ */
+
+#include <stdlib.h>
+#include <assert.h>
+#include <unistd.h>
+#include "pool.h"
+
+// a worker thread's pool and index, so that a task can find its deque
+typedef struct worker {
+    pool_t* pool;
+    int id;
+} worker_t;
+
+static __thread worker_t* current_worker = NULL;
+
+/* worker thread's loop: find a task, run it, repeat until stopped */
+void* pool_worker(void* arg);
+
+/* find a task for a worker: its own, a shared one, or a stolen one */
+int find_task(pool_t* pool, int id, task_t* task);
+
+/* whether any task is waiting anywhere in the pool */
+int pool_has_work(pool_t* pool);
+
+/* wake a sleeping worker, if any, after a task was pushed */
+void wake_worker(pool_t* pool);
+
+/* count a task as finished, waking pool_wait after the last one */
+void finish_task(pool_t* pool);
+
+/* initialize pool with the given number of worker threads */
+pool_t* init_pool(int nthreads) {
+    assert(nthreads > 0);
+    pool_t* pool = (pool_t*) malloc(sizeof(pool_t));
+    assert(pool);
+    pool->nthreads = nthreads;
+    pool->head = 0;
+    pool->length = 0;
+    pool->pending = 0;
+    pool->idle = 0;
+    pool->stop = 0;
+    pool->capacity = POOL_INIT_CAP;
+    pool->tasks = (task_t*) malloc(sizeof(task_t) * pool->capacity);
+    assert(pool->tasks);
+    pool->deques = (deque_t**) malloc(sizeof(deque_t*) * nthreads);
+    assert(pool->deques);
+    for (int i=0; i < nthreads; i++)
+        pool->deques[i] = init_deque();
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->has_work, NULL);
+    pthread_cond_init(&pool->all_done, NULL);
+    pool->threads = (pthread_t*) malloc(sizeof(pthread_t) * nthreads);
+    assert(pool->threads);
+    for (int i=0; i < nthreads; i++) {
+        worker_t* worker = (worker_t*) malloc(sizeof(worker_t));
+        assert(worker);
+        worker->pool = pool;
+        worker->id = i;
+        pthread_create(&pool->threads[i], NULL, pool_worker, worker);
+    }
+    return pool;
+}
+
+/* number of worker threads to use when the caller has no preference */
+int pool_default_threads() {
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return (n > 0) ? (int) n : 1;
+}
+
+/* submit a task to the pool; safe to call from within a running task,
+ * where it goes on the running worker's own deque
+ */
+void pool_submit(pool_t* pool, task_fn_t fn, void* arg) {
+    assert(pool); assert(fn);
+    __atomic_add_fetch(&pool->pending, 1, __ATOMIC_SEQ_CST);
+    if (current_worker != NULL && current_worker->pool == pool) {
+        deque_push(pool->deques[current_worker->id], fn, arg);
+        wake_worker(pool);
+        return;
+    }
+    pthread_mutex_lock(&pool->lock);
+    // grow the ring buffer, unwrapping it into the new array
+    if (pool->length == pool->capacity) {
+        task_t* tasks = (task_t*) malloc(sizeof(task_t) * pool->capacity * 2);
+        assert(tasks);
+        for (int i=0; i < pool->length; i++)
+            tasks[i] = pool->tasks[(pool->head + i) % pool->capacity];
+        free(pool->tasks);
+        pool->tasks = tasks;
+        pool->head = 0;
+        pool->capacity *= 2;
+    }
+    task_t* task = &pool->tasks[(pool->head + pool->length) % pool->capacity];
+    task->fn = fn;
+    task->arg = arg;
+    __atomic_store_n(&pool->length, pool->length + 1, __ATOMIC_SEQ_CST);
+    pthread_cond_signal(&pool->has_work);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+/* number of tasks waiting in the calling worker's own deque; 0 when not
+ * called from a task of this pool. Tasks can use it to split their work
+ * further only while there is too little queued for idle workers to steal
+ */
+int pool_local_tasks(pool_t* pool) {
+    if (current_worker == NULL || current_worker->pool != pool) return 0;
+    return (int) deque_size(pool->deques[current_worker->id]);
+}
+
+/* block until every submitted task has finished running */
+void pool_wait(pool_t* pool) {
+    assert(pool);
+    pthread_mutex_lock(&pool->lock);
+    while (__atomic_load_n(&pool->pending, __ATOMIC_SEQ_CST) > 0)
+        pthread_cond_wait(&pool->all_done, &pool->lock);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+/* worker thread's loop */
+void* pool_worker(void* arg) {
+    current_worker = (worker_t*) arg;
+    pool_t* pool = current_worker->pool;
+    int id = current_worker->id;
+    task_t task;
+    while (1) {
+        if (find_task(pool, id, &task)) {
+            task.fn(task.arg);
+            finish_task(pool);
+            continue;
+        }
+        // announce going idle before looking once more, so that a task
+        // pushed meanwhile is either seen here or wakes this worker
+        pthread_mutex_lock(&pool->lock);
+        __atomic_add_fetch(&pool->idle, 1, __ATOMIC_SEQ_CST);
+        while (!pool_has_work(pool) && !pool->stop)
+            pthread_cond_wait(&pool->has_work, &pool->lock);
+        __atomic_sub_fetch(&pool->idle, 1, __ATOMIC_SEQ_CST);
+        int done = pool->stop && !pool_has_work(pool);
+        pthread_mutex_unlock(&pool->lock);
+        if (done) break;
+    }
+    current_worker = NULL;
+    free(arg);
+    return NULL;
+}
+
+/* find a task for a worker: its own newest, the shared queue's oldest, or
+ * the oldest of another worker, trying each victim in turn
+ */
+int find_task(pool_t* pool, int id, task_t* task) {
+    if (deque_take(pool->deques[id], task) == DEQUE_TAKEN)
+        return 1;
+    if (__atomic_load_n(&pool->length, __ATOMIC_SEQ_CST) > 0) {
+        pthread_mutex_lock(&pool->lock);
+        int found = pool->length > 0;
+        if (found) {
+            *task = pool->tasks[pool->head];
+            pool->head = (pool->head + 1) % pool->capacity;
+            __atomic_store_n(&pool->length, pool->length - 1, __ATOMIC_SEQ_CST);
+        }
+        pthread_mutex_unlock(&pool->lock);
+        if (found) return 1;
+    }
+    int retry;
+    do {
+        retry = 0;
+        for (int i=1; i < pool->nthreads; i++) {
+            int result = deque_steal(pool->deques[(id + i) % pool->nthreads], task);
+            if (result == DEQUE_TAKEN) return 1;
+            if (result == DEQUE_ABORT) retry = 1;
+        }
+    } while (retry);
+    return 0;
+}
+
+/* whether any task is waiting anywhere in the pool */
+int pool_has_work(pool_t* pool) {
+    if (__atomic_load_n(&pool->length, __ATOMIC_SEQ_CST) > 0) return 1;
+    for (int i=0; i < pool->nthreads; i++)
+        if (deque_size(pool->deques[i]) > 0) return 1;
+    return 0;
+}
+
+/* wake a sleeping worker, if any, after a task was pushed */
+void wake_worker(pool_t* pool) {
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&pool->idle, __ATOMIC_SEQ_CST) == 0) return;
+    pthread_mutex_lock(&pool->lock);
+    pthread_cond_signal(&pool->has_work);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+/* count a task as finished, waking pool_wait after the last one */
+void finish_task(pool_t* pool) {
+    if (__atomic_sub_fetch(&pool->pending, 1, __ATOMIC_SEQ_CST) > 0) return;
+    pthread_mutex_lock(&pool->lock);
+    pthread_cond_broadcast(&pool->all_done);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+/* finish any remaining tasks, then stop the workers and free the pool */
+void free_pool(pool_t* pool) {
+    assert(pool);
+    pthread_mutex_lock(&pool->lock);
+    pool->stop = 1;
+    pthread_cond_broadcast(&pool->has_work);
+    pthread_mutex_unlock(&pool->lock);
+    for (int i=0; i < pool->nthreads; i++)
+        pthread_join(pool->threads[i], NULL);
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->has_work);
+    pthread_cond_destroy(&pool->all_done);
+    for (int i=0; i < pool->nthreads; i++)
+        free_deque(pool->deques[i]);
+    free(pool->deques);
+    free(pool->threads);
+    free(pool->tasks);
+    free(pool);
+}
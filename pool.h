@@ -0,0 +1,45 @@
+/*
+ * Thread pool header: a fixed set of worker threads scheduling tasks by
+ * work stealing. Each worker keeps a deque of its own (see deque.h): a
+ * task submitted from within a running task goes on the bottom of its
+ * worker's deque and is normally run by that worker, newest first, while
+ * idle workers steal the oldest tasks of the others. Tasks submitted from
+ * outside the pool wait in a shared queue. pool_wait blocks until every
+ * submitted task, including those submitted by tasks, has finished.
+ */
+
+#include <pthread.h>
+#include "deque.h"
+
+#ifndef QTREE_SELF_IMPLEMENTATION_POOL_H
+#define QTREE_SELF_IMPLEMENTATION_POOL_H
+
+#define POOL_INIT_CAP 64  // initial capacity of the pool's shared task queue
+
+// structures
+typedef struct pool pool_t;
+struct pool {
+    pthread_t* threads;
+    int nthreads;
+    deque_t** deques;
+    task_t* tasks;
+    int head;
+    int length;
+    int capacity;
+    int pending;
+    int idle;
+    int stop;
+    pthread_mutex_t lock;
+    pthread_cond_t has_work;
+    pthread_cond_t all_done;
+};
+
+// function prototypes
+pool_t* init_pool(int nthreads);
+int pool_default_threads();
+void pool_submit(pool_t* pool, task_fn_t fn, void* arg);
+int pool_local_tasks(pool_t* pool);
+void pool_wait(pool_t* pool);
+void free_pool(pool_t* pool);
+
+#endif //QTREE_SELF_IMPLEMENTATION_POOL_H
@@ -0,0 +1,228 @@
+/*
+ * Binary frames of the query server (see proto.h), and the blocking
+ * connections, reads and writes a client needs to exchange them.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include "proto.h"
+
+#define MAX_HOST_LEN 256  // maximum length of the host of a TCP address
+
+/* make room for extra more bytes at the end of a buffer */
+void bytes_reserve(bytes_t* bytes, size_t extra) {
+    if (bytes->length + extra <= bytes->capacity) return;
+    size_t capacity = bytes->capacity ? bytes->capacity : 256;
+    while (capacity < bytes->length + extra) capacity *= 2;
+    bytes->data = (unsigned char*) realloc(bytes->data, capacity);
+    assert(bytes->data);
+    bytes->capacity = capacity;
+}
+
+/* append to the end of a buffer */
+void bytes_append(bytes_t* bytes, const void* data, size_t length) {
+    if (length == 0) return;
+    bytes_reserve(bytes, length);
+    memcpy(bytes->data + bytes->length, data, length);
+    bytes->length += length;
+}
+
+/* drop the first length bytes of a buffer */
+void bytes_consume(bytes_t* bytes, size_t length) {
+    assert(length <= bytes->length);
+    memmove(bytes->data, bytes->data + length, bytes->length - length);
+    bytes->length -= length;
+}
+
+/* write a 32-bit word little-endian */
+void put_u32(unsigned char* at, uint32_t value) {
+    for (int i=0; i < 4; i++) at[i] = (unsigned char) (value >> (8 * i));
+}
+
+/* read a little-endian 32-bit word */
+uint32_t get_u32(const unsigned char* at) {
+    return (uint32_t) at[0] | (uint32_t) at[1] << 8 | (uint32_t) at[2] << 16 |
+           (uint32_t) at[3] << 24;
+}
+
+/* write a double as its 8 little-endian IEEE bytes */
+void put_f64(unsigned char* at, double value) {
+    uint64_t word;
+    memcpy(&word, &value, sizeof(word));
+    put_u32(at, (uint32_t) word);
+    put_u32(at + 4, (uint32_t) (word >> 32));
+}
+
+/* read a double from its 8 little-endian IEEE bytes */
+double get_f64(const unsigned char* at) {
+    uint64_t word = (uint64_t) get_u32(at) | (uint64_t) get_u32(at + 4) << 32;
+    double value;
+    memcpy(&value, &word, sizeof(value));
+    return value;
+}
+
+/* append a request frame to a buffer */
+void encode_request(bytes_t* out, request_t* request) {
+    unsigned char frame[4 + PROTO_REQUEST_LEN] = {0};
+    put_u32(frame, PROTO_REQUEST_LEN);
+    put_u32(frame + 4, request->id);
+    frame[8] = request->op;
+    frame[9] = request->format;
+    put_u32(frame + 12, request->k);
+    put_f64(frame + 16, request->x1);
+    put_f64(frame + 24, request->y1);
+    put_f64(frame + 32, request->x2);
+    put_f64(frame + 40, request->y2);
+    bytes_append(out, frame, sizeof(frame));
+}
+
+/* read a request from a frame past its length field; 0 if malformed */
+int decode_request(const unsigned char* frame, uint32_t length, request_t* request) {
+    if (length != PROTO_REQUEST_LEN) return 0;
+    request->id = get_u32(frame);
+    request->op = frame[4];
+    request->format = frame[5];
+    request->k = get_u32(frame + 8);
+    request->x1 = get_f64(frame + 12);
+    request->y1 = get_f64(frame + 20);
+    request->x2 = get_f64(frame + 28);
+    request->y2 = get_f64(frame + 36);
+    return 1;
+}
+
+/* append a response header, whose length and count end_response fills in
+ * once the payload follows it; returns where the frame starts
+ */
+size_t begin_response(bytes_t* out, response_t* response) {
+    size_t start = out->length;
+    unsigned char header[4 + PROTO_RESPONSE_LEN] = {0};
+    put_u32(header + 4, response->id);
+    header[8] = response->status;
+    header[9] = response->format;
+    bytes_append(out, header, sizeof(header));
+    return start;
+}
+
+/* complete the response frame starting at start with its payload's count */
+void end_response(bytes_t* out, size_t start, uint32_t count) {
+    put_u32(out->data + start, (uint32_t) (out->length - start - 4));
+    put_u32(out->data + start + 12, count);
+}
+
+/* read a response header from a frame past its length field; 0 if malformed */
+int decode_response(const unsigned char* frame, uint32_t length, response_t* response) {
+    if (length < PROTO_RESPONSE_LEN) return 0;
+    response->id = get_u32(frame);
+    response->status = frame[4];
+    response->format = frame[5];
+    response->count = get_u32(frame + 8);
+    response->payload_len = length - PROTO_RESPONSE_LEN;
+    return 1;
+}
+
+/* whether a whole frame starts the data, setting its length past the
+ * length field; 1 if so, 0 if more is to come, -1 if it is too long
+ */
+int frame_ready(const unsigned char* data, size_t available, uint32_t* length) {
+    if (available < 4) return 0;
+    *length = get_u32(data);
+    if (*length > PROTO_MAX_FRAME) return -1;
+    return available - 4 >= *length;
+}
+
+/* write all of the data to a blocking descriptor; -1 on error */
+int send_all(int fd, const void* data, size_t length) {
+    const unsigned char* next = (const unsigned char*) data;
+    while (length > 0) {
+        ssize_t sent = write(fd, next, length);
+        if (sent < 0 && errno == EINTR) continue;
+        if (sent <= 0) return -1;
+        next += sent;
+        length -= (size_t) sent;
+    }
+    return 0;
+}
+
+/* read from a blocking descriptor until a whole frame starts the buffer,
+ * returning its length past the length field; -1 on end of file or error
+ */
+int recv_frame(int fd, bytes_t* in) {
+    uint32_t length;
+    int ready;
+    while ((ready = frame_ready(in->data, in->length, &length)) == 0) {
+        bytes_reserve(in, 4096);
+        ssize_t got = read(fd, in->data + in->length, in->capacity - in->length);
+        if (got < 0 && errno == EINTR) continue;
+        if (got <= 0) return -1;
+        in->length += (size_t) got;
+    }
+    return (ready < 0) ? -1 : (int) length;
+}
+
+/* whether an address is "host:port" for TCP rather than a socket path */
+int is_tcp_address(char* address) {
+    return strchr(address, ':') != NULL && strchr(address, '/') == NULL;
+}
+
+/* the socket addresses of a TCP "host:port", any host when it is empty;
+ * flags are getaddrinfo's. Returns 0 on success, the caller then frees
+ * found with freeaddrinfo
+ */
+int resolve_address(char* address, int flags, struct addrinfo** found) {
+    char host[MAX_HOST_LEN];
+    char* port = strrchr(address, ':');
+    if (port == NULL || port - address >= MAX_HOST_LEN) return -1;
+    memcpy(host, address, port - address);
+    host[port - address] = '\0';
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = flags;
+    return getaddrinfo(host[0] ? host : NULL, port + 1, &hints, found);
+}
+
+/* open a blocking connection to an address; -1 on error */
+int connect_to(char* address) {
+    if (!is_tcp_address(address)) {
+        struct sockaddr_un unix_address;
+        if (strlen(address) >= sizeof(unix_address.sun_path)) return -1;
+        memset(&unix_address, 0, sizeof(unix_address));
+        unix_address.sun_family = AF_UNIX;
+        strcpy(unix_address.sun_path, address);
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0) return -1;
+        if (connect(fd, (struct sockaddr*) &unix_address, sizeof(unix_address)) < 0) {
+            close(fd);
+            return -1;
+        }
+        return fd;
+    }
+    struct addrinfo* found;
+    if (resolve_address(address, 0, &found) != 0) return -1;
+    int fd = -1;
+    for (struct addrinfo* at = found; at != NULL && fd < 0; at = at->ai_next) {
+        fd = socket(at->ai_family, at->ai_socktype, at->ai_protocol);
+        if (fd < 0) continue;
+        if (connect(fd, at->ai_addr, at->ai_addrlen) < 0) {
+            close(fd);
+            fd = -1;
+        }
+    }
+    freeaddrinfo(found);
+    // requests are small and pipelined, so they should not wait to coalesce
+    int one = 1;
+    if (fd >= 0) setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    return fd;
+}
@@ -0,0 +1,109 @@
+/*
+ * Protocol header: the binary frames the query server (see server.h)
+ * exchanges with its clients. Every frame starts with its length, not
+ * counting the length field itself, so that any number of requests can
+ * be written back to back and read apart again. All fields are
+ * little-endian, and coordinates travel as IEEE doubles.
+ *
+ * A request is PROTO_REQUEST_LEN bytes after its length:
+ *   u32 id       echoed in the response, to match pipelined replies
+ *   u8  op       PROTO_POINT, PROTO_RANGE, PROTO_KNN or PROTO_COUNT
+ *   u8  format   PROTO_IDS or PROTO_RECORDS
+ *   u16 reserved 0
+ *   u32 k        number of neighbours, for PROTO_KNN
+ *   f64 x1, y1   the query point, or the bottom left of the window
+ *   f64 x2, y2   the top right of the window
+ * A response is PROTO_RESPONSE_LEN bytes after its length, then a payload:
+ *   u32 id, u8 status, u8 format, u16 reserved, u32 count
+ * where count is the number of footpaths found. With PROTO_IDS the payload
+ * is their footpath ids, as count i32s; with PROTO_RECORDS it is their
+ * records, printed as stage 3 / 4 print them. PROTO_COUNT has no payload.
+ * A kNN request may add PROTO_BY_LOCATION to either format, for replies
+ * that can be merged with others (see shard.h): count is then the number
+ * of locations, each given as f64 x, f64 y, f64 dx, f64 dy, u32 n and its
+ * n footpaths by id, as i32 id alone or followed by u32 length and the
+ * record's text. dx and dy are what the location's coordinates lose as
+ * doubles, so that x + dx and y + dy are exactly the server's own. A
+ * range request may likewise add PROTO_TAGGED to PROTO_RECORDS: each record
+ * then comes as i32 id, u32 length and its text, so that records from
+ * several servers can be merged by id.
+ *
+ * Servers listen, and clients connect, at an address: a Unix domain
+ * socket path, or "host:port" for TCP when there is a colon but no slash.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef QTREE_SELF_IMPLEMENTATION_PROTO_H
+#define QTREE_SELF_IMPLEMENTATION_PROTO_H
+
+#define PROTO_REQUEST_LEN 44   // bytes of a request after its length field
+#define PROTO_RESPONSE_LEN 12  // bytes of a response header after its length field
+#define PROTO_MAX_FRAME (64 << 20)  // largest frame accepted, in bytes
+#define PROTO_LOCATION_LEN 36       // bytes of a location of a PROTO_BY_LOCATION reply
+
+// request operations, as in stage 3 / 4: a point query reports the
+// footpaths of the leaf the point falls in, a range query those with an
+// end in the window, sorted by id and without repeats
+#define PROTO_POINT 1
+#define PROTO_RANGE 2
+#define PROTO_KNN 3    // footpaths at the k nearest locations, nearest first
+#define PROTO_COUNT 4  // number of footpaths a range query reports
+
+#define PROTO_IDS 0          // reply with footpath ids
+#define PROTO_RECORDS 1      // reply with formatted records
+#define PROTO_BY_LOCATION 2  // group a kNN reply by location
+#define PROTO_TAGGED 4       // give each record of a range reply with its id and length
+
+#define PROTO_OK 0
+#define PROTO_BAD_REQUEST 1
+#define PROTO_UNAVAILABLE 2  // a server the reply depends on cannot be reached
+
+struct addrinfo;
+
+// structures
+typedef struct request {
+    uint32_t id;
+    uint8_t op;
+    uint8_t format;
+    uint32_t k;
+    double x1, y1, x2, y2;
+} request_t;
+
+typedef struct response {
+    uint32_t id;
+    uint8_t status;
+    uint8_t format;
+    uint32_t count;
+    uint32_t payload_len;
+} response_t;
+
+// a growable byte buffer
+typedef struct bytes {
+    unsigned char* data;
+    size_t length;
+    size_t capacity;
+} bytes_t;
+
+// function prototypes
+void bytes_reserve(bytes_t* bytes, size_t extra);
+void bytes_append(bytes_t* bytes, const void* data, size_t length);
+void bytes_consume(bytes_t* bytes, size_t length);
+void put_u32(unsigned char* at, uint32_t value);
+uint32_t get_u32(const unsigned char* at);
+void put_f64(unsigned char* at, double value);
+double get_f64(const unsigned char* at);
+void encode_request(bytes_t* out, request_t* request);
+int decode_request(const unsigned char* frame, uint32_t length, request_t* request);
+size_t begin_response(bytes_t* out, response_t* response);
+void end_response(bytes_t* out, size_t start, uint32_t count);
+int decode_response(const unsigned char* frame, uint32_t length, response_t* response);
+int frame_ready(const unsigned char* data, size_t available, uint32_t* length);
+int send_all(int fd, const void* data, size_t length);
+int recv_frame(int fd, bytes_t* in);
+int is_tcp_address(char* address);
+int resolve_address(char* address, int flags, struct addrinfo** found);
+int connect_to(char* address);
+
+#endif //QTREE_SELF_IMPLEMENTATION_PROTO_H
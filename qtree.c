@@ -11,28 +11,39 @@
 #include <stdlib.h>
 #include <assert.h>
 #include "queue.h"
+#include "stats.h"
+#include "grid.h"
 
 /* checking intersection onesidedly, meaning full intersection should check
  * r1 relative to r2 and r2 relative to r1
  */
 int oneside_intersect_check(square_t* r1, square_t* r2);
 
+/* prefetch what testing the children of a queued node will read, by stage:
+ * the children, then their squares and points, then their squares' corners
+ */
+void prefetch_children(qtnode_t* node, int stage);
+
 /* range search operation passing found to check whether found any points or not */
-void search_range_check(qtnode_t* tree, square_t* rectangle, int* found);
+void search_range_check(qtnode_t* tree, square_t* rectangle, int* found, int level);
+
+/* insertion below a node at the given level of the tree */
+void insert_level(qtnode_t* tree, point_t* point, int level, arena_t* arena);
 
-/* split the node into 4 branches - initializing 4 child nodes */
-void split(qtnode_t* node);
+/* point searching below a node at the given level of the tree */
+point_t* find_pt_level(qtnode_t* tree, point_t* point, int level);
 
 /* recursively check whether point to be inserted can be inserted to a quadrant
  * of the bounding square in question or not; if not then continue splitting
  */
-void split_insert(qtnode_t* root, point_t* point);
+void split_insert(qtnode_t* root, point_t* point, int level, arena_t* arena);
 
-/* insert the point into a specified quadrant of the node */
-qtnode_t* insert_quadrant(qtnode_t* node, point_t* point, enum quadrant q);
+/* whether a word is one of n category words */
+int has_record(category_t* words, int n, category_t word);
 
-/* get the midpoints of the square, where point at (xMid, yMid) is the center */
-void get_midpoints(square_t* square, long double* xMidPass, long double* yMidPass);
+/* insert the point into a specified quadrant of the node */
+qtnode_t* insert_quadrant(qtnode_t* node, point_t* point, enum quadrant q,
+                          arena_t* arena);
 
 /* helper function printing out node */
 void print_node(qtnode_t* node, int level);
@@ -48,6 +59,8 @@ point_t* init_point(long double x, long double y) {
     point_t* point = (point_t*) malloc (sizeof(point_t));
     point->x = x;
     point->y = y;
+    point->category = 0;
+    point->records = NULL;
     return point;
 }
 
@@ -56,15 +69,41 @@ square_t* init_square(point_t* bottomL, point_t* topR) {
     square_t* square = (square_t*) malloc (sizeof(square_t));
     square->bottom_left = bottomL;
     square->top_right = topR;
+#ifdef QTREE_GRID
+    square->gx0 = square->gy0 = 0;
+    square->gx1 = square->gy1 = GRID_MAX;
+#endif
     return square;
 }
 
-/* initialize a tree node from a square */
+/* initialize a tree node from a square; the node becomes the root of a
+ * tree, with an arena of its own
+ */
 qtnode_t* init_tree(square_t* square) {
     qtnode_t* node = (qtnode_t*) malloc (sizeof(qtnode_t));
     assert(node);
     node->square = square;
+    node->arena = init_arena(ARENA_BLOCK_SIZE);
+    node->point = NULL;
+    node->categories = 0;
+    node->generation = 0;
+    node->occupied = 0;
+    node->ne = NULL;
+    node->nw = NULL;
+    node->se = NULL;
+    node->sw = NULL;
+    return node;
+}
+
+/* initialize a child node within the tree's arena */
+qtnode_t* arena_node(arena_t* arena, square_t* square) {
+    qtnode_t* node = (qtnode_t*) arena_alloc(arena, sizeof(qtnode_t));
+    node->square = square;
+    node->arena = NULL;
     node->point = NULL;
+    node->categories = 0;
+    node->generation = 0;
+    node->occupied = 0;
     node->ne = NULL;
     node->nw = NULL;
     node->se = NULL;
@@ -72,90 +111,220 @@ qtnode_t* init_tree(square_t* square) {
     return node;
 }
 
+/* initialize a point within an arena */
+point_t* arena_point(arena_t* arena, long double x, long double y) {
+    point_t* point = (point_t*) arena_alloc(arena, sizeof(point_t));
+    point->x = x;
+    point->y = y;
+    point->category = 0;
+    point->records = NULL;
+    return point;
+}
+
+/* initialize a square within an arena */
+square_t* arena_square(arena_t* arena, point_t* bottomL, point_t* topR) {
+    square_t* square = (square_t*) arena_alloc(arena, sizeof(square_t));
+    square->bottom_left = bottomL;
+    square->top_right = topR;
+#ifdef QTREE_GRID
+    square->gx0 = square->gy0 = 0;
+    square->gx1 = square->gy1 = GRID_MAX;
+#endif
+    return square;
+}
+
+/* initialize a point owned by the tree */
+point_t* tree_point(qtnode_t* tree, long double x, long double y) {
+    assert(tree->arena);
+    return arena_point(tree->arena, x, y);
+}
+
 /* insert a data point to the tree */
 void insert(qtnode_t* tree, point_t* point) {
+    assert(tree->arena);
+    STAT_BEGIN();
+    GRID_POINT(tree->square, point);
+    insert_level(tree, point, 0, tree->arena);
+    STAT_ADD(hits, 1);
+    STAT_END(STATS_INSERT);
+}
+
+/* insert a data point below a node */
+void insert_level(qtnode_t* tree, point_t* point, int level, arena_t* arena) {
+    STAT_LEVEL(level);
+    tree->categories |= point->category;
+    tree->generation++;
     // base case - root node
-    if (tree->sw == NULL)
-        split_insert(tree, point);
+    if (IS_LEAF(tree))
+        split_insert(tree, point, level, arena);
     else {
-        // finding the right quadrant
-        enum quadrant q = determine_quad(tree->square, point);
-        return  (q == sw) ? insert(tree->sw, point) :
-                (q == se) ? insert(tree->se, point) :
-                (q == nw) ? insert(tree->nw, point) :
-                insert(tree->ne, point);
+        // finding the right quadrant; an empty quadrant simply takes the point
+        enum quadrant q = QUADRANT(tree->square, point);
+        qtnode_t* child = get_child(tree, q);
+        if (child == NULL) {
+            STAT_LEVEL(level+1);
+            insert_quadrant(tree, point, q, arena);
+        }
+        else insert_level(child, point, level+1, arena);
     }
 }
 
 /* split the root node until the 2 points aren't in the same quadrant
  * to then insert
  */
-void split_insert(qtnode_t* root, point_t* point) {
+void split_insert(qtnode_t* root, point_t* point, int level, arena_t* arena) {
+    root->categories |= point->category;
+    root->generation++;
+    STAT_ADD(leaf_tests, 1);
     // if root does not yet have a point, assign it with a point
     if (root->point == NULL) {
         root->point = point;
         return;
     }
-    // the 2 points must not be the same (avoiding infinite recursion)
-    if (point_cmp(root->point, point)) return;
-    // split root into 4 branches, check which quadrant
-    split(root);
-    enum quadrant qroot = determine_quad(root->square, root->point);
-    enum quadrant qpoint = determine_quad(root->square, point);
-    qtnode_t* child = insert_quadrant(root, root->point, qroot);
+    // the 2 points must not be the same (avoiding infinite recursion); the
+    // existing point then stands for both, so it takes on both categories
+    if (point_cmp(root->point, point)) {
+        root->point = merge_duplicate(root->point, point, arena);
+        return;
+    }
+    // move the existing point down into its quadrant, check which quadrant
+    point_t* existing = root->point;
+    root->point = NULL;
+    enum quadrant qroot = QUADRANT(root->square, existing);
+    enum quadrant qpoint = QUADRANT(root->square, point);
+    qtnode_t* child = insert_quadrant(root, existing, qroot, arena);
     // existing point in different quadrant or not
-    if (qroot == qpoint) split_insert(child, point);
-    else insert_quadrant(root, point, qpoint);
+    if (qroot == qpoint) {
+        STAT_LEVEL(level+1);
+        split_insert(child, point, level+1, arena);
+    }
+    else insert_quadrant(root, point, qpoint, arena);
+}
+
+/* the point standing for a stored point and a duplicate of it: the stored
+ * point itself if it already has the category word of every record of the
+ * duplicate, otherwise a copy within the arena with the records of both, so
+ * that the points the caller inserted are never changed. Each distinct word
+ * is kept, as a filter must match one record's word, not their union
+ */
+point_t* merge_duplicate(point_t* stored, point_t* point, arena_t* arena) {
+    // the words of a point's records are distinct, so only those of the
+    // duplicate that the stored point lacks are added
+    int nstored, npoint, nnew = 0;
+    category_t* kept = point_records(stored, &nstored);
+    category_t* added = point_records(point, &npoint);
+    for (int i=0; i < npoint; i++)
+        nnew += !has_record(kept, nstored, added[i]);
+    if (nnew == 0) return stored;
+    category_records_t* records = (category_records_t*)
+        arena_alloc(arena, sizeof(category_records_t) + sizeof(category_t) * (nstored + nnew));
+    records->length = nstored;
+    for (int i=0; i < nstored; i++) records->words[i] = kept[i];
+    for (int i=0; i < npoint; i++)
+        if (!has_record(kept, nstored, added[i])) records->words[records->length++] = added[i];
+    point_t* merged = (point_t*) arena_alloc(arena, sizeof(point_t));
+    *merged = *stored;
+    merged->category |= point->category;
+    merged->records = records;
+    return merged;
+}
+
+/* whether a word is one of n category words */
+int has_record(category_t* words, int n, category_t word) {
+    for (int i=0; i < n; i++)
+        if (words[i] == word) return 1;
+    return 0;
 }
 
-/* split the node, used when insertion reaches leaf node */
-void split(qtnode_t* node) {
-    // make sure node is a leaf node
-    assert(node->sw == NULL);
-    // top left and bottom right positions of node's square
-    point_t* topLeft = node->square->bottom_left;
+/* the category words of the records a point stands for, n set to their
+ * number: its own word alone unless it stands for several records
+ */
+category_t* point_records(point_t* point, int* n) {
+    if (point->records == NULL) {
+        *n = 1;
+        return &point->category;
+    }
+    *n = point->records->length;
+    return point->records->words;
+}
+
+/* materialise a single child of the node, only once a point lands in its
+ * quadrant; the other quadrants stay absent until they are needed
+ */
+qtnode_t* split(qtnode_t* node, enum quadrant q, arena_t* arena) {
+    // make sure the child does not exist yet
+    assert(!HAS_CHILD(node, q));
+    // bottom left and top right positions of node's square
+    point_t* bottomLeft = node->square->bottom_left;
     point_t* topRight = node->square->top_right;
-    long double xLeft = topLeft->x, xRight = topRight->x;
-    long double yBottom = topLeft->y, yTop = topRight->y;
     // midpoint and center positions of node's square
     long double xMid, yMid;
     get_midpoints(node->square, &xMid, &yMid);
-    point_t* midLeft = init_point(xLeft, yMid);
-    point_t* midTop = init_point(xMid, yTop);
-    point_t* midRight = init_point(xRight, yMid);
-    point_t* midBottom = init_point(xMid, yBottom);
-    point_t* center = init_point(xMid, yMid);
-    // split node to 4 child nodes
-    node->nw = init_tree(init_square(midLeft, midTop));
-    node->ne = init_tree(init_square(center, topRight));
-    node->sw = init_tree(init_square(topLeft, center));
-    node->se = init_tree(init_square(midBottom, midRight));
-}
-
-/* insert to a node based on specified quadrant */
-qtnode_t* insert_quadrant(qtnode_t* node, point_t* point, enum quadrant q) {
-    assert(node->nw); assert(point);
-    qtnode_t** child = (qtnode_t**) malloc (sizeof(qtnode_t*));
-    *child = (q == nw) ? node->nw : (q == ne) ? node->ne : (q == sw) ? node->sw : node->se;
-    (*child)->point = point;
-    return *child;
+    // the child's square, sharing the node's corner where it can
+    square_t* square =
+        (q == nw) ? arena_square(arena, arena_point(arena, bottomLeft->x, yMid),
+                                 arena_point(arena, xMid, topRight->y)) :
+        (q == ne) ? arena_square(arena, arena_point(arena, xMid, yMid), topRight) :
+        (q == sw) ? arena_square(arena, bottomLeft, arena_point(arena, xMid, yMid)) :
+        arena_square(arena, arena_point(arena, xMid, bottomLeft->y),
+                     arena_point(arena, topRight->x, yMid));
+    GRID_CHILD(node->square, square, q);
+    qtnode_t* child = arena_node(arena, square);
+    if (q == nw) node->nw = child;
+    else if (q == ne) node->ne = child;
+    else if (q == sw) node->sw = child;
+    else node->se = child;
+    node->occupied |= 1 << q;
+    return child;
+}
+
+/* insert to a node based on specified quadrant, materialising it if needed */
+qtnode_t* insert_quadrant(qtnode_t* node, point_t* point, enum quadrant q,
+                          arena_t* arena) {
+    assert(point);
+    qtnode_t* child = get_child(node, q);
+    if (child == NULL) child = split(node, q, arena);
+    child->point = point;
+    child->categories |= point->category;
+    return child;
+}
+
+/* child of a node in the given quadrant; NULL if not materialised */
+qtnode_t* get_child(qtnode_t* node, enum quadrant q) {
+    return (q == nw) ? node->nw : (q == ne) ? node->ne : (q == sw) ? node->sw : node->se;
 }
 
 /* point searching in the tree */
 void search_pt(qtnode_t* tree, point_t* point) {
+    point_t* found = find_pt(tree, point);
+    if (found != NULL)
+        printf("The point (%Lf, %Lf) has been found.\n", found->x, found->y);
+    else printf("Point not found!\n");
+}
+
+/* find the stored point at the same location as point; NULL if none */
+point_t* find_pt(qtnode_t* tree, point_t* point) {
+    STAT_BEGIN();
+    GRID_POINT(tree->square, point);
+    point_t* found = find_pt_level(tree, point, 0);
+    STAT_ADD(hits, found != NULL);
+    STAT_END(STATS_POINT);
+    return found;
+}
+
+/* find the stored point below a node */
+point_t* find_pt_level(qtnode_t* tree, point_t* point, int level) {
+    STAT_LEVEL(level);
     // base case - root node
-    if (tree->nw == NULL) {
+    if (IS_LEAF(tree)) {
+        STAT_ADD(leaf_tests, tree->point != NULL);
         if (tree->point != NULL && point_cmp(tree->point, point))
-            printf("The point (%Lf, %Lf) has been found.\n", tree->point->x, tree->point->y);
-        else printf("Point not found!\n");
-        return;
+            return tree->point;
+        return NULL;
     }
-    // otherwise, find the right quadrant
-    enum quadrant q = determine_quad(tree->square, point);
-    return (q == nw) ? search_pt(tree->nw, point) :
-           (q == ne) ? search_pt(tree->ne, point) :
-           (q == sw) ? search_pt(tree->sw, point) :
-           search_pt(tree->se, point);
+    // otherwise, find the right quadrant; an absent one holds nothing
+    qtnode_t* child = get_child(tree, QUADRANT(tree->square, point));
+    return (child == NULL) ? NULL : find_pt_level(child, point, level+1);
 }
 
 /* determine which quadrant the point belongs to */
@@ -174,34 +343,120 @@ enum quadrant determine_quad(square_t* square, point_t* point) {
 }
 
 /* range search operation + check if any point is found within range */
-void search_range_check(qtnode_t* tree, square_t* rectangle, int* found) {
+void search_range_check(qtnode_t* tree, square_t* rectangle, int* found, int level) {
+    STAT_LEVEL(level);
     // base case - root node
-    if (tree->nw == NULL) {
-        if (tree->point != NULL && in_sq(rectangle, tree->point)) {
+    if (IS_LEAF(tree)) {
+        STAT_ADD(leaf_tests, tree->point != NULL);
+        if (tree->point != NULL && IN_RANGE(rectangle, tree->point)) {
             printf("Range search: (%Lf, %Lf)\n", tree->point->x, tree->point->y);
+            STAT_ADD(hits, 1);
             *found = 1;
         }
         return;
     }
-    // otherwise, find which quadrant rectangle intersects with
-    if (rectangle_intersect(tree->nw->square, rectangle))
-        search_range_check(tree->nw, rectangle, found);
-    if (rectangle_intersect(tree->ne->square, rectangle))
-        search_range_check(tree->ne, rectangle, found);
-    if (rectangle_intersect(tree->sw->square, rectangle))
-        search_range_check(tree->sw, rectangle, found);
-    if (rectangle_intersect(tree->se->square, rectangle))
-        search_range_check(tree->se, rectangle, found);
+    // otherwise, find which present quadrant rectangle intersects with
+    qtnode_t* children[4] = {tree->nw, tree->ne, tree->sw, tree->se};
+    for (int i=0; i < 4; i++) {
+        if (children[i] == NULL) continue;
+        STAT_ADD(intersects, 1);
+        if (OVERLAPS(children[i]->square, rectangle))
+            search_range_check(children[i], rectangle, found, level+1);
+    }
 }
 
 /* range search all valid points in tree */
 void search_range(qtnode_t* tree, square_t* rectangle) {
     int found = 0;
-    search_range_check(tree, rectangle, &found);
+    STAT_BEGIN();
+    GRID_SQUARE(tree->square, rectangle);
+    search_range_check(tree, rectangle, &found, 0);
+    STAT_END(STATS_RANGE);
     if (!found)
         printf("Range search: no point found!\n");
 }
 
+/* range search level by level: the queue holds the frontier of nodes whose
+ * square overlaps the rectangle, a level at a time, and each node is
+ * prefetched in stages as it moves up the queue so that its children are
+ * in cache by the time it is tested. Points are found in breadth-first
+ * rather than search_range's order; up to max are written to out, and the
+ * number found is returned even past max
+ */
+int range_frontier(qtnode_t* tree, square_t* rectangle, point_t** out, int max) {
+    STAT_BEGIN();
+    GRID_SQUARE(tree->square, rectangle);
+    queue_t* q = init_queue(tree);
+    int found = 0;
+    while (q->length > 0) {
+        if (q->length > 3*FRONTIER_DISTANCE)
+            prefetch_children(QUEUE_PEEK(q, 3*FRONTIER_DISTANCE), 0);
+        if (q->length > 2*FRONTIER_DISTANCE)
+            prefetch_children(QUEUE_PEEK(q, 2*FRONTIER_DISTANCE), 1);
+        if (q->length > FRONTIER_DISTANCE)
+            prefetch_children(QUEUE_PEEK(q, FRONTIER_DISTANCE), 2);
+        qtnode_t* node = dequeue(q);
+        if (IS_LEAF(node)) {
+            STAT_ADD(leaf_tests, node->point != NULL);
+            if (node->point != NULL && IN_RANGE(rectangle, node->point)) {
+                if (found < max) out[found] = node->point;
+                found++;
+            }
+            continue;
+        }
+        qtnode_t* children[4] = {node->nw, node->ne, node->sw, node->se};
+        for (int i=0; i < 4; i++) {
+            if (children[i] == NULL) continue;
+            STAT_ADD(intersects, 1);
+            if (OVERLAPS(children[i]->square, rectangle))
+                enqueue(q, children[i]);
+        }
+    }
+    free_queue(q);
+    STAT_ADD(hits, found);
+    STAT_END(STATS_RANGE);
+    return found;
+}
+
+/* prefetch what testing the children of a queued node will read, by stage:
+ * the children, then their squares and points, then their squares' corners
+ */
+void prefetch_children(qtnode_t* node, int stage) {
+    qtnode_t* children[4] = {node->nw, node->ne, node->sw, node->se};
+    for (int i=0; i < 4; i++) {
+        if (children[i] == NULL) continue;
+        if (stage == 0) PREFETCH(children[i]);
+        else if (stage == 1) {
+            PREFETCH(children[i]->square);
+            if (children[i]->point != NULL) PREFETCH(children[i]->point);
+        }
+        else {
+            PREFETCH(children[i]->square->bottom_left);
+            PREFETCH(children[i]->square->top_right);
+        }
+    }
+}
+
+/* range search all valid points in tree, level by level */
+void search_range_frontier(qtnode_t* tree, square_t* rectangle) {
+    // a second search is only needed when the first buffer was too small
+    int capacity = QUEUE_INIT_CAP;
+    point_t** points = (point_t**) malloc(sizeof(point_t*) * capacity);
+    assert(points);
+    int found = range_frontier(tree, rectangle, points, capacity);
+    if (found > capacity) {
+        free(points);
+        points = (point_t**) malloc(sizeof(point_t*) * found);
+        assert(points);
+        range_frontier(tree, rectangle, points, found);
+    }
+    for (int i=0; i < found; i++)
+        printf("Range search: (%Lf, %Lf)\n", points[i]->x, points[i]->y);
+    if (!found)
+        printf("Range search: no point found!\n");
+    free(points);
+}
+
 /* rectangle intersection check; call intersect_check both ways (r1 relative
  * to r2 and, likewise the other way around); used for range search
  */
@@ -235,6 +490,36 @@ void get_midpoints(square_t* square, long double* xMidPass, long double* yMidPas
     (*yMidPass) = yMid;
 }
 
+/* squared minimum distance between 2 squares; 0 if they overlap */
+long double square_dist2(square_t* s1, square_t* s2) {
+    long double dx = 0, dy = 0;
+    if (s2->bottom_left->x > s1->top_right->x)
+        dx = s2->bottom_left->x - s1->top_right->x;
+    else if (s1->bottom_left->x > s2->top_right->x)
+        dx = s1->bottom_left->x - s2->top_right->x;
+    if (s2->bottom_left->y > s1->top_right->y)
+        dy = s2->bottom_left->y - s1->top_right->y;
+    else if (s1->bottom_left->y > s2->top_right->y)
+        dy = s1->bottom_left->y - s2->top_right->y;
+    return dx*dx + dy*dy;
+}
+
+/* squared distance between 2 points */
+long double point_dist2(point_t* p1, point_t* p2) {
+    long double dx = p1->x - p2->x, dy = p1->y - p2->y;
+    return dx*dx + dy*dy;
+}
+
+/* squared distance from a point to a square; 0 if inside */
+long double point_square_dist2(point_t* point, square_t* square) {
+    long double dx = 0, dy = 0;
+    if (point->x < square->bottom_left->x) dx = square->bottom_left->x - point->x;
+    else if (point->x > square->top_right->x) dx = point->x - square->top_right->x;
+    if (point->y < square->bottom_left->y) dy = square->bottom_left->y - point->y;
+    else if (point->y > square->top_right->y) dy = point->y - square->top_right->y;
+    return dx*dx + dy*dy;
+}
+
 /* point comparison: check if 2 points lie in the same exact location */
 int point_cmp(point_t* p1, point_t* p2) {
     return (p1->x == p2->x && p1->y == p2->y);
@@ -254,7 +539,8 @@ void print_node(qtnode_t* node, int level) {
 
 // print levels of a tree recursively
 void print_level_order(qtnode_t* tree, int level) {
-    if (tree->nw == NULL) {
+    if (tree == NULL) return;
+    if (IS_LEAF(tree)) {
         if (tree->point != NULL) {
             print_node(tree, level);
             printf("   The point in this root is:\t(%.5Lf, %.5Lf)\n",
@@ -268,13 +554,15 @@ void print_level_order(qtnode_t* tree, int level) {
     print_level_order(tree->se, level+1);
 }
 
-/* free the entire tree structure recursively */
+/* free the entire tree structure: the root's arena holds everything below
+ * the root, including its corner points and the points made by tree_point
+ */
 void free_tree(qtnode_t* tree) {
     if (tree == NULL) return;
-    free_tree(tree->nw);
-    free_tree(tree->ne);
-    free_tree(tree->sw);
-    free_tree(tree->se);
+    // every node below the root lives in the root's arena
+    assert(tree->arena);
+    free_arena(tree->arena);
+    tree->arena = NULL;
     tree->square->top_right = NULL;
     tree->square->bottom_left = NULL;
     tree->point = NULL;
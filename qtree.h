@@ -1,10 +1,16 @@
 /*
  * Header file for qtree, including:
  * Structures, archetypes and basic operations' prototypes of a quadtree.
- * To replace the data quadtree carries with, change it to a comprehensive
- * footpath that also contains a point structure.
+ * Rather than editing these structures to carry other data, instantiate
+ * qtree_generic.h with the payload, coordinate type and leaf capacity wanted.
  */
 
+#ifndef QTREE_SELF_IMPLEMENTATION_QTREE_H
+#define QTREE_SELF_IMPLEMENTATION_QTREE_H
+
+#include <stdint.h>
+#include "arena.h"
+
 /** data and structures */
 
 // quadrant
@@ -13,28 +19,75 @@ enum quadrant {sw,nw,ne,se};
 // quadtree structure
 typedef struct node qtnode_t;
 
-// point, including x,y coordinates
+// integer grid coordinate, see grid.h
+typedef uint32_t grid_coord_t;
+#define GRID_MAX UINT32_MAX          // last grid coordinate of either axis
+#define GRID_CELLS 4294967296.0L     // number of grid cells along either axis
+
+// bitmap of categorical attribute values, one bit per (column, value) pair
+typedef uint64_t category_t;
+
+// the category words of the records sharing one location, each kept apart
+// so that a filter is matched against every record on its own
+typedef struct category_records {
+    int length;
+    category_t words[];
+} category_records_t;
+
+// point, including x,y coordinates and the categories of its data; with
+// QTREE_GRID also its grid coordinates, set when inserted or searched for.
+// A stored point standing for several records with differing categories
+// (see merge_duplicate) keeps their words in records, and category is then
+// their union; records is NULL for a point of a single record
 typedef struct point {
     long double x;
     long double y;
+    category_t category;
+    category_records_t* records;
+#ifdef QTREE_GRID
+    grid_coord_t gx;
+    grid_coord_t gy;
+#endif
 } point_t;
 
-// square containing bottom left and top right points
+// square containing bottom left and top right points; with QTREE_GRID also
+// its span of grid cells, inclusive (the root covers the entire grid)
 typedef struct square {
     point_t* bottom_left;
     point_t* top_right;
+#ifdef QTREE_GRID
+    grid_coord_t gx0, gy0;
+    grid_coord_t gx1, gy1;
+#endif
 } square_t;
 
-// a qtree node, which contains point, the square and 4 children
+// a qtree node, which contains point, the square and up to 4 children;
+// categories is the union of the categories of every point below the node,
+// and generation changes whenever an insertion passes through the node.
+// Only quadrants holding points are materialised: occupied has bit (1 << q)
+// set for each child q present, and a node with no children is a leaf.
+// The root owns the arena every other node, square and corner point of the
+// tree is allocated from; arena is NULL in every other node
 struct node {
     point_t* point;
     square_t* square;
+    arena_t* arena;
+    category_t categories;
+    uint32_t generation;
+    unsigned char occupied;
     qtnode_t* nw;
     qtnode_t* ne;
     qtnode_t* sw;
     qtnode_t* se;
 };
 
+// check whether a node is a leaf, and whether it has a child in quadrant q
+#define IS_LEAF(node) ((node)->occupied == 0)
+#define HAS_CHILD(node, q) ((node)->occupied & (1 << (q)))
+
+// queued nodes between each prefetch stage of a frontier range search
+#define FRONTIER_DISTANCE 4
+
 /** function prototypes */
 
 /* initialize a point, based on x, y coordinates */
@@ -46,18 +99,58 @@ square_t* init_square(point_t* p1, point_t* p2);
 /* initialize a tree node from a square */
 qtnode_t* init_tree(square_t* square);
 
+/* initialize a point or a square within an arena, freed along with it */
+point_t* arena_point(arena_t* arena, long double x, long double y);
+square_t* arena_square(arena_t* arena, point_t* p1, point_t* p2);
+
+/* initialize a child node within the tree's arena */
+qtnode_t* arena_node(arena_t* arena, square_t* square);
+
+/* initialize a point owned by the tree, freed along with it by free_tree */
+point_t* tree_point(qtnode_t* tree, long double x, long double y);
+
 /* insert a data point to the tree */
 void insert(qtnode_t* tree, point_t* point);
 
 /* point searching in the tree */
 void search_pt(qtnode_t* tree, point_t* point);
 
+/* find the stored point at the same location as point, without printing;
+ * NULL if there is none
+ */
+point_t* find_pt(qtnode_t* tree, point_t* point);
+
 /* range search all valid points in tree */
 void search_range(qtnode_t* tree, square_t* rectangle);
 
+/* range search level by level, prefetching the nodes the next tests read;
+ * up to max points are written to out, and the number found is returned
+ */
+int range_frontier(qtnode_t* tree, square_t* rectangle, point_t** out, int max);
+
+/* range search all valid points in tree, level by level */
+void search_range_frontier(qtnode_t* tree, square_t* rectangle);
+
+/* the point standing for a stored point and a duplicate of it, with the
+ * records of both; a copy within the arena if the stored point lacks any
+ */
+point_t* merge_duplicate(point_t* stored, point_t* point, arena_t* arena);
+
+/* the category words of the records a point stands for, n set to their number */
+category_t* point_records(point_t* point, int* n);
+
+/* materialise the child of a node in the given quadrant, within the arena */
+qtnode_t* split(qtnode_t* node, enum quadrant q, arena_t* arena);
+
+/* child of a node in the given quadrant; NULL if not materialised */
+qtnode_t* get_child(qtnode_t* node, enum quadrant q);
+
 /* determine which quadrant the point belongs to */
 enum quadrant determine_quad(square_t* square, point_t* point);
 
+/* get the midpoints of the square, where point at (xMid, yMid) is the center */
+void get_midpoints(square_t* square, long double* xMidPass, long double* yMidPass);
+
 /* check if two rectangles intersect or not; used for range search */
 int rectangle_intersect(square_t* r1, square_t* r2);
 
@@ -71,8 +164,21 @@ int in_sq(square_t* square, point_t* point);
  */
 int point_cmp(point_t* p1, point_t* p2);
 
+/* squared distance between 2 points */
+long double point_dist2(point_t* p1, point_t* p2);
+
+/* squared minimum distance between 2 squares; 0 if they overlap */
+long double square_dist2(square_t* s1, square_t* s2);
+
+/* squared distance from a point to a square; 0 if inside */
+long double point_square_dist2(point_t* point, square_t* square);
+
 /* print the entire tree using level-order traversal */
 void print_tree(qtnode_t* tree);
 
-/* free the entire tree structure recursively */
+/* free the entire tree structure, along with the points made by tree_point;
+ * points made by init_point belong to the caller
+ */
 void free_tree(qtnode_t* tree);
+
+#endif //QTREE_SELF_IMPLEMENTATION_QTREE_H
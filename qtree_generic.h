@@ -0,0 +1,201 @@
+/*
+ * Generic quadtree header: a bucket quadtree whose payload, coordinate type
+ * and leaf capacity are fixed at compile time. Instantiating
+ *   QTREE_INIT(asset, asset_t*, double, 8)
+ * defines asset_tree_t, asset_entry_t and the static inline functions
+ *   asset_init, asset_insert, asset_find, asset_range, asset_free
+ * all specialised for that payload, with no void* or callbacks in between.
+ * Leaves hold up to capacity entries before splitting, and points at the
+ * same location are all kept (once the depth limit is reached, a leaf chains
+ * to overflow buckets instead of splitting). Quadrants follow determine_quad.
+ * Nodes live in the tree's arena; coordinates may also be integers, in which
+ * case midpoints round down.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "arena.h"
+#include "qtree.h"
+
+#ifndef QTREE_SELF_IMPLEMENTATION_QTREE_GENERIC_H
+#define QTREE_SELF_IMPLEMENTATION_QTREE_GENERIC_H
+
+#define QTREE_MAX_DEPTH 32  // depth past which leaves chain instead of splitting
+#define QTREE_INTERNAL (-1) // entry count marking an internal node
+
+// quadrant of (x, y) around the midpoint (xm, ym), as determine_quad decides it
+#define QTREE_QUAD(x, y, xm, ym) \
+    (((x) < (xm) && (y) >= (ym)) ? nw : \
+     ((x) >= (xm) && (y) > (ym)) ? ne : \
+     ((x) <= (xm) && (y) < (ym)) ? sw : se)
+
+// instantiate a quadtree named name, see the header comment
+#define QTREE_INIT(name, payload_t, coord_t, capacity)                                  \
+                                                                                        \
+typedef struct name##_entry {                                                           \
+    coord_t x;                                                                          \
+    coord_t y;                                                                          \
+    payload_t data;                                                                     \
+} name##_entry_t;                                                                       \
+                                                                                        \
+/* a leaf holds count entries (and maybe an overflow bucket); an internal node   */    \
+/* has count QTREE_INTERNAL and up to 4 children, absent while empty              */    \
+typedef struct name##_node name##_node_t;                                               \
+struct name##_node {                                                                    \
+    int count;                                                                          \
+    union {                                                                             \
+        struct {                                                                        \
+            name##_entry_t entries[capacity];                                           \
+            name##_node_t* overflow;                                                    \
+        } leaf;                                                                         \
+        name##_node_t* child[4];                                                        \
+    } u;                                                                                \
+};                                                                                      \
+                                                                                        \
+typedef struct name##_tree {                                                            \
+    coord_t xl, yb, xr, yt;                                                             \
+    name##_node_t* root;                                                                \
+    arena_t* arena;                                                                     \
+    size_t length;                                                                      \
+} name##_tree_t;                                                                        \
+                                                                                        \
+/* a node's bounds, carried along traversals rather than stored */                      \
+typedef struct name##_frame {                                                           \
+    name##_node_t* node;                                                                \
+    coord_t xl, yb, xr, yt;                                                             \
+} name##_frame_t;                                                                       \
+                                                                                        \
+static inline name##_node_t* name##_node(arena_t* arena) {                              \
+    name##_node_t* node = (name##_node_t*) arena_alloc(arena, sizeof(name##_node_t));   \
+    node->count = 0;                                                                    \
+    node->u.leaf.overflow = NULL;                                                       \
+    return node;                                                                        \
+}                                                                                       \
+                                                                                        \
+/* narrow the bounds of a node down to its quadrant q */                                \
+static inline void name##_narrow(name##_frame_t* f, int q) {                            \
+    coord_t xm = f->xl + (f->xr - f->xl)/2, ym = f->yb + (f->yt - f->yb)/2;             \
+    if (q == sw || q == nw) f->xr = xm; else f->xl = xm;                                \
+    if (q == sw || q == se) f->yt = ym; else f->yb = ym;                                \
+}                                                                                       \
+                                                                                        \
+static inline int name##_quad(name##_frame_t* f, coord_t x, coord_t y) {                \
+    coord_t xm = f->xl + (f->xr - f->xl)/2, ym = f->yb + (f->yt - f->yb)/2;             \
+    return QTREE_QUAD(x, y, xm, ym);                                                    \
+}                                                                                       \
+                                                                                        \
+static inline name##_tree_t* name##_init(coord_t xl, coord_t yb, coord_t xr, coord_t yt) { \
+    assert(xl <= xr && yb <= yt);                                                       \
+    name##_tree_t* tree = (name##_tree_t*) malloc(sizeof(name##_tree_t));               \
+    assert(tree);                                                                       \
+    tree->xl = xl; tree->yb = yb; tree->xr = xr; tree->yt = yt;                         \
+    tree->arena = init_arena(ARENA_BLOCK_SIZE);                                         \
+    tree->root = name##_node(tree->arena);                                              \
+    tree->length = 0;                                                                   \
+    return tree;                                                                        \
+}                                                                                       \
+                                                                                        \
+/* split a full leaf, moving its entries down to the children */                        \
+static inline void name##_split(name##_tree_t* tree, name##_frame_t* f) {               \
+    name##_entry_t moved[capacity];                                                     \
+    name##_node_t* node = f->node;                                                      \
+    int count = node->count;                                                            \
+    memcpy(moved, node->u.leaf.entries, sizeof(name##_entry_t) * count);                \
+    node->count = QTREE_INTERNAL;                                                       \
+    node->u.child[0] = node->u.child[1] = node->u.child[2] = node->u.child[3] = NULL;   \
+    for (int i = 0; i < count; i++) {                                                   \
+        int q = name##_quad(f, moved[i].x, moved[i].y);                                 \
+        name##_node_t* child = node->u.child[q];                                        \
+        if (child == NULL) child = node->u.child[q] = name##_node(tree->arena);         \
+        child->u.leaf.entries[child->count++] = moved[i];                               \
+    }                                                                                   \
+}                                                                                       \
+                                                                                        \
+/* insert a payload at (x, y); 0 if the point lies outside the tree */                  \
+static inline int name##_insert(name##_tree_t* tree, coord_t x, coord_t y, payload_t data) { \
+    if (x < tree->xl || x > tree->xr || y < tree->yb || y > tree->yt) return 0;         \
+    name##_frame_t f = {tree->root, tree->xl, tree->yb, tree->xr, tree->yt};            \
+    int depth = 0;                                                                      \
+    for (;;) {                                                                          \
+        name##_node_t* node = f.node;                                                   \
+        if (node->count == QTREE_INTERNAL) {                                            \
+            int q = name##_quad(&f, x, y);                                              \
+            if (node->u.child[q] == NULL) node->u.child[q] = name##_node(tree->arena);  \
+            f.node = node->u.child[q];                                                  \
+            name##_narrow(&f, q);                                                       \
+            depth++;                                                                    \
+        }                                                                               \
+        else if (node->count < (capacity)) {                                            \
+            name##_entry_t* e = &node->u.leaf.entries[node->count++];                   \
+            e->x = x; e->y = y; e->data = data;                                         \
+            tree->length++;                                                             \
+            return 1;                                                                   \
+        }                                                                               \
+        else if (depth >= QTREE_MAX_DEPTH) {                                            \
+            if (node->u.leaf.overflow == NULL)                                          \
+                node->u.leaf.overflow = name##_node(tree->arena);                       \
+            f.node = node->u.leaf.overflow;                                             \
+        }                                                                               \
+        else name##_split(tree, &f);                                                    \
+    }                                                                                   \
+}                                                                                       \
+                                                                                        \
+/* the payload of an entry at exactly (x, y); NULL if there is none */                  \
+static inline payload_t* name##_find(name##_tree_t* tree, coord_t x, coord_t y) {       \
+    if (x < tree->xl || x > tree->xr || y < tree->yb || y > tree->yt) return NULL;      \
+    name##_frame_t f = {tree->root, tree->xl, tree->yb, tree->xr, tree->yt};            \
+    while (f.node->count == QTREE_INTERNAL) {                                           \
+        int q = name##_quad(&f, x, y);                                                  \
+        if ((f.node = f.node->u.child[q]) == NULL) return NULL;                         \
+        name##_narrow(&f, q);                                                           \
+    }                                                                                   \
+    for (name##_node_t* leaf = f.node; leaf != NULL; leaf = leaf->u.leaf.overflow)      \
+        for (int i = 0; i < leaf->count; i++)                                           \
+            if (leaf->u.leaf.entries[i].x == x && leaf->u.leaf.entries[i].y == y)       \
+                return &leaf->u.leaf.entries[i].data;                                   \
+    return NULL;                                                                        \
+}                                                                                       \
+                                                                                        \
+/* entries within the rectangle, quadrants visited sw, nw, ne, se; up to max are   */ \
+/* written to out, and the number found is returned even past max                 */ \
+static inline size_t name##_range(name##_tree_t* tree, coord_t xl, coord_t yb,          \
+                                  coord_t xr, coord_t yt,                               \
+                                  name##_entry_t** out, size_t max) {                   \
+    name##_frame_t stack[3*QTREE_MAX_DEPTH + 4];                                        \
+    size_t found = 0;                                                                   \
+    int size = 0;                                                                       \
+    if (xr < tree->xl || xl > tree->xr || yt < tree->yb || yb > tree->yt) return 0;     \
+    name##_frame_t root = {tree->root, tree->xl, tree->yb, tree->xr, tree->yt};         \
+    stack[size++] = root;                                                               \
+    while (size > 0) {                                                                  \
+        name##_frame_t f = stack[--size];                                               \
+        if (f.node->count != QTREE_INTERNAL) {                                          \
+            for (name##_node_t* leaf = f.node; leaf; leaf = leaf->u.leaf.overflow)      \
+                for (int i = 0; i < leaf->count; i++) {                                 \
+                    name##_entry_t* e = &leaf->u.leaf.entries[i];                       \
+                    if (e->x < xl || e->x > xr || e->y < yb || e->y > yt) continue;     \
+                    if (found < max) out[found] = e;                                    \
+                    found++;                                                            \
+                }                                                                       \
+            continue;                                                                   \
+        }                                                                               \
+        /* pushed in reverse, so sw is visited first */                                 \
+        for (int q = se; q >= sw; q--) {                                                \
+            if (f.node->u.child[q] == NULL) continue;                                   \
+            name##_frame_t c = f;                                                       \
+            c.node = f.node->u.child[q];                                                \
+            name##_narrow(&c, q);                                                       \
+            if (xr < c.xl || xl > c.xr || yt < c.yb || yb > c.yt) continue;             \
+            stack[size++] = c;                                                          \
+        }                                                                               \
+    }                                                                                   \
+    return found;                                                                       \
+}                                                                                       \
+                                                                                        \
+static inline void name##_free(name##_tree_t* tree) {                                   \
+    free_arena(tree->arena);                                                            \
+    free(tree);                                                                         \
+}
+
+#endif //QTREE_SELF_IMPLEMENTATION_QTREE_GENERIC_H
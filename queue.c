@@ -8,49 +8,50 @@
 #include "queue.h"
 
 /*
- * initialize queue
+ * initialize queue, holding a first node
  */
 queue_t* init_queue(qtnode_t* treeNode) {
     assert(treeNode);
     queue_t* q = (queue_t*) malloc(sizeof(queue_t));
     assert(q);
-    q->head = init_node(treeNode);
-    q->head->next = NULL;
-    q->length = 1;
-    q->tail = q->head;
+    q->capacity = QUEUE_INIT_CAP;
+    q->nodes = (qtnode_t**) malloc(sizeof(qtnode_t*) * q->capacity);
+    assert(q->nodes);
+    q->head = 0;
+    q->length = 0;
+    enqueue(q, treeNode);
     return q;
 }
 
 /*
- * initialize node
- */
-qnode_t* init_node(qtnode_t* treeNode) {
-    assert(treeNode);
-    qnode_t* qnode = (qnode_t*) malloc(sizeof(qnode_t));
-    assert(qnode);
-    qnode->treeNode = treeNode;
-    return qnode;
-}
-
-/*
- * insert to queue - enqueue
+ * insert to queue - enqueue; a full buffer doubles, unwrapping its nodes
+ * so that the head comes first again
  */
 void enqueue(queue_t* q, qtnode_t* treeNode) {
     assert(treeNode);
     assert(q);
-    q->tail->next = init_node(treeNode);
-    q->tail = q->tail->next;
-    q->length = q->length+1;
+    if (q->length == q->capacity) {
+        qtnode_t** nodes = (qtnode_t**) malloc(sizeof(qtnode_t*) * q->capacity * 2);
+        assert(nodes);
+        for (int i=0; i < q->length; i++)
+            nodes[i] = QUEUE_PEEK(q, i);
+        free(q->nodes);
+        q->nodes = nodes;
+        q->head = 0;
+        q->capacity *= 2;
+    }
+    QUEUE_PEEK(q, q->length) = treeNode;
+    q->length++;
 }
 
 /*
  * remove from queue - dequeue
  */
 qtnode_t* dequeue(queue_t* q) {
-    assert(q->head && q->tail);
-    qtnode_t* node = q->head->treeNode;
-    q->head = q->head->next;
-    q->length = q->length-1;
+    assert(q->length > 0);
+    qtnode_t* node = q->nodes[q->head];
+    q->head = (q->head + 1) & (q->capacity - 1);
+    q->length--;
     return node;
 }
 
@@ -59,23 +60,18 @@ qtnode_t* dequeue(queue_t* q) {
  */
 void free_queue(queue_t* q) {
     assert(q);
-    qnode_t* tmp;
-    for (int i=0; i < q->length; i++) {
-        tmp = q->head;
-        q->head = q->head->next;
-        free(tmp);
-    }
+    free(q->nodes);
     free(q);
 }
 
 /*
- * print queue
+ * print queue; only the nodes holding a point print anything
  */
 void print_queue(queue_t* q) {
-    assert(q->head && q->tail);
-    qnode_t* data = q->head;
+    assert(q);
     for (int i=0; i < q->length; i++) {
-        printf("%Lf %Lf\n", data->treeNode->point->x, data->treeNode->point->y);
-        data = data->next;
+        qtnode_t* node = QUEUE_PEEK(q, i);
+        if (node->point != NULL)
+            printf("%Lf %Lf\n", node->point->x, node->point->y);
     }
 }
@@ -1,5 +1,6 @@
 /*
- * Queue header files
+ * Queue header files: a FIFO queue of tree nodes in an array-backed ring
+ * buffer, whose capacity is always a power of 2 and doubles when full.
  */
 
 #include "qtree.h"
@@ -7,25 +8,32 @@
 #ifndef QTREE_SELF_IMPLEMENTATION_QUEUE_H
 #define QTREE_SELF_IMPLEMENTATION_QUEUE_H
 
-#endif //QTREE_SELF_IMPLEMENTATION_QUEUE_H
+#define QUEUE_INIT_CAP 64  // initial capacity of a queue, a power of 2
+
+// hint that addr will be read soon; a no-op where the builtin is missing
+#if defined(__GNUC__) || defined(__clang__)
+#define PREFETCH(addr) __builtin_prefetch(addr)
+#else
+#define PREFETCH(addr) ((void) (addr))
+#endif
 
 // structures
-typedef struct qnode qnode_t;
-struct qnode {
-    qtnode_t* treeNode;
-    qnode_t* next;
-};
 typedef struct queue queue_t;
 struct queue {
-    qnode_t* head;
-    qnode_t* tail;
+    qtnode_t** nodes;
+    int head;
     int length;
+    int capacity;
 };
 
+// the i-th node from the head of a non-empty queue, without dequeuing it
+#define QUEUE_PEEK(q, i) ((q)->nodes[((q)->head + (i)) & ((q)->capacity - 1)])
+
 // function prototypes
-qnode_t* init_node(qtnode_t* treeNode);
 queue_t* init_queue(qtnode_t* treeNode);
 void enqueue(queue_t* q, qtnode_t* treeNode);
 qtnode_t* dequeue(queue_t* q);
 void print_queue(queue_t* q);
-void free_queue(queue_t* q);
\ No newline at end of file
+void free_queue(queue_t* q);
+
+#endif //QTREE_SELF_IMPLEMENTATION_QUEUE_H
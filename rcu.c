@@ -0,0 +1,326 @@
+/*
+ * RCU tree (see rcu.h). The writer works on nodes no reader can see yet -
+ * a scratch copy of the node being extended, or a fresh replacement for a
+ * leaf - and only then publishes them with a release store, which readers
+ * pair with acquire loads. A published node's square, and a leaf's point,
+ * never change afterwards, except for the one root leaf: when the root
+ * splits it keeps its square, so it gains all its children in place at
+ * once and only drops its old point once no reader can still be looking
+ * at it.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sched.h>
+#include <assert.h>
+#include "rcu.h"
+#include "grid.h"
+
+/* a node for a square, recycled if one has been reclaimed */
+qtnode_t* rcu_node(rcu_tree_t* rcu, square_t* square);
+
+/* hand a node to fn once no reader can reach it any longer */
+void rcu_retire(rcu_tree_t* rcu, qtnode_t* node, reclaim_fn_t fn);
+
+/* start a new epoch, and reclaim what no active reader can still hold */
+void rcu_reclaim(rcu_tree_t* rcu);
+
+/* reclaim a replaced leaf, for reuse by rcu_node */
+void recycle_node(rcu_tree_t* rcu, qtnode_t* node);
+
+/* drop the point the root held before it split */
+void clear_point(rcu_tree_t* rcu, qtnode_t* node);
+
+/* recursively collect points within range below a node, as a reader */
+void rcu_range_level(qtnode_t* node, square_t* rectangle, point_t** out, int max,
+                     int* found);
+
+/* initialize an empty tree over a square for one writer and many readers */
+rcu_tree_t* init_rcu_tree(square_t* square) {
+    rcu_tree_t* rcu = (rcu_tree_t*) malloc(sizeof(rcu_tree_t));
+    assert(rcu);
+    rcu->root = init_tree(square);
+    rcu->epoch = 1;
+    for (int i=0; i < RCU_MAX_READERS; i++)
+        rcu->readers[i].epoch = RCU_IDLE;
+    rcu->nreaders = 0;
+    rcu->retired_capacity = RCU_INIT_CAP;
+    rcu->retired = (retired_t*) malloc(sizeof(retired_t) * rcu->retired_capacity);
+    assert(rcu->retired);
+    rcu->nretired = 0;
+    rcu->since_reclaim = 0;
+    rcu->free_nodes = NULL;
+    return rcu;
+}
+
+/* register a reader thread, returning the reader id it searches with */
+int rcu_register(rcu_tree_t* rcu) {
+    int reader = __atomic_fetch_add(&rcu->nreaders, 1, __ATOMIC_SEQ_CST);
+    assert(reader < RCU_MAX_READERS);
+    return reader;
+}
+
+/* enter a search: announce the current epoch before reading any node */
+void rcu_read_lock(rcu_tree_t* rcu, int reader) {
+    uint64_t epoch = __atomic_load_n(&rcu->epoch, __ATOMIC_SEQ_CST);
+    __atomic_store_n(&rcu->readers[reader].epoch, epoch, __ATOMIC_SEQ_CST);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+/* leave a search; nothing read during it may be used afterwards */
+void rcu_read_unlock(rcu_tree_t* rcu, int reader) {
+    RCU_PUBLISH(&rcu->readers[reader].epoch, RCU_IDLE);
+}
+
+/* insert a data point to the tree; only one thread may insert at a time */
+void rcu_insert(rcu_tree_t* rcu, point_t* point) {
+    qtnode_t* root = rcu->root;
+    arena_t* arena = root->arena;
+    GRID_POINT(root->square, point);
+    qtnode_t* node = root;
+    qtnode_t** slot = NULL;
+    for (;;) {
+        node->categories |= point->category;
+        node->generation++;
+        if (!IS_LEAF(node)) {
+            enum quadrant q = QUADRANT(node->square, point);
+            qtnode_t** next = child_slot(node, q);
+            if (*next != NULL) {
+                slot = next;
+                node = *next;
+                continue;
+            }
+            // an empty quadrant: the leaf is made on a scratch copy of the node
+            qtnode_t scratch = *node;
+            scratch.occupied = 0;
+            scratch.nw = scratch.ne = scratch.sw = scratch.se = NULL;
+            qtnode_t* leaf = split(&scratch, q, arena);
+            leaf->point = point;
+            leaf->categories = point->category;
+            RCU_PUBLISH(next, leaf);
+            __atomic_or_fetch(&node->occupied, 1 << q, __ATOMIC_RELEASE);
+            break;
+        }
+        if (node->point == NULL) {
+            RCU_PUBLISH(&node->point, point);
+            break;
+        }
+        // the 2 points must not be the same, as in split_insert
+        if (point_cmp(node->point, point)) {
+            RCU_PUBLISH(&node->point, merge_duplicate(node->point, point, arena));
+            break;
+        }
+        if (slot == NULL) {
+            // the root keeps its square: its children are built on a scratch
+            // copy and all stored before one release store of the occupied
+            // mask, so a reader sees either the old leaf or every child
+            qtnode_t scratch = *root;
+            scratch.occupied = 0;
+            scratch.nw = scratch.ne = scratch.sw = scratch.se = NULL;
+            rcu_separate(&scratch, root->point, point, arena);
+            for (enum quadrant q = sw; q <= se; q++)
+                RCU_PUBLISH(child_slot(root, q), get_child(&scratch, q));
+            RCU_PUBLISH(&root->occupied, scratch.occupied);
+            rcu_retire(rcu, root, clear_point);
+        }
+        else {
+            // any other leaf is replaced by a copy holding both points below
+            qtnode_t* replacement = rcu_node(rcu, node->square);
+            replacement->categories = node->categories;
+            replacement->generation = node->generation;
+            rcu_separate(replacement, node->point, point, arena);
+            RCU_PUBLISH(slot, replacement);
+            rcu_retire(rcu, node, recycle_node);
+        }
+        break;
+    }
+}
+
+/* move 2 distinct points below an unpublished node, splitting until they
+ * land in different quadrants, as split_insert does
+ */
+void rcu_separate(qtnode_t* node, point_t* existing, point_t* point, arena_t* arena) {
+    for (;;) {
+        enum quadrant qexisting = QUADRANT(node->square, existing);
+        enum quadrant qpoint = QUADRANT(node->square, point);
+        if (qexisting != qpoint) {
+            qtnode_t* child = split(node, qexisting, arena);
+            child->point = existing;
+            child->categories = existing->category;
+            child = split(node, qpoint, arena);
+            child->point = point;
+            child->categories = point->category;
+            return;
+        }
+        node = split(node, qexisting, arena);
+        node->categories = existing->category | point->category;
+    }
+}
+
+/* find the stored point at the same location as point; NULL if none */
+point_t* rcu_find_pt(rcu_tree_t* rcu, int reader, point_t* point) {
+    rcu_read_lock(rcu, reader);
+    qtnode_t* node = rcu->root;
+    point_t* found = NULL;
+    GRID_POINT(node->square, point);
+    for (;;) {
+        if (RCU_LOAD(&node->occupied) == 0) {
+            point_t* stored = RCU_LOAD(&node->point);
+            if (stored != NULL && point_cmp(stored, point))
+                found = stored;
+            break;
+        }
+        qtnode_t* child = RCU_LOAD(child_slot(node, QUADRANT(node->square, point)));
+        if (child == NULL) break;
+        node = child;
+    }
+    rcu_read_unlock(rcu, reader);
+    return found;
+}
+
+/* points within the rectangle, in search_range's order; up to max are
+ * written to out, and the number found is returned even past max
+ */
+int rcu_range(rcu_tree_t* rcu, int reader, square_t* rectangle, point_t** out, int max) {
+    int found = 0;
+    rcu_read_lock(rcu, reader);
+    GRID_SQUARE(rcu->root->square, rectangle);
+    rcu_range_level(rcu->root, rectangle, out, max, &found);
+    rcu_read_unlock(rcu, reader);
+    return found;
+}
+
+/* recursively collect points within range below a node, as a reader */
+void rcu_range_level(qtnode_t* node, square_t* rectangle, point_t** out, int max,
+                     int* found) {
+    if (RCU_LOAD(&node->occupied) == 0) {
+        point_t* stored = RCU_LOAD(&node->point);
+        if (stored != NULL && IN_RANGE(rectangle, stored)) {
+            if (*found < max) out[*found] = stored;
+            (*found)++;
+        }
+        return;
+    }
+    enum quadrant order[4] = {nw, ne, sw, se};
+    for (int i=0; i < 4; i++) {
+        qtnode_t* child = RCU_LOAD(child_slot(node, order[i]));
+        if (child != NULL && OVERLAPS(child->square, rectangle))
+            rcu_range_level(child, rectangle, out, max, found);
+    }
+}
+
+/* point searching, as a reader */
+void rcu_search_pt(rcu_tree_t* rcu, int reader, point_t* point) {
+    point_t* found = rcu_find_pt(rcu, reader, point);
+    if (found != NULL)
+        printf("The point (%Lf, %Lf) has been found.\n", found->x, found->y);
+    else printf("Point not found!\n");
+}
+
+/* range search all valid points, as a reader; the points found are those
+ * of a single search, even if the writer inserts more in between
+ */
+void rcu_search_range(rcu_tree_t* rcu, int reader, square_t* rectangle) {
+    int capacity = RCU_INIT_CAP;
+    point_t** points = (point_t**) malloc(sizeof(point_t*) * capacity);
+    assert(points);
+    int found = rcu_range(rcu, reader, rectangle, points, capacity);
+    while (found > capacity) {
+        capacity = found * 2;
+        points = (point_t**) realloc(points, sizeof(point_t*) * capacity);
+        assert(points);
+        found = rcu_range(rcu, reader, rectangle, points, capacity);
+    }
+    for (int i=0; i < found; i++)
+        printf("Range search: (%Lf, %Lf)\n", points[i]->x, points[i]->y);
+    if (!found)
+        printf("Range search: no point found!\n");
+    free(points);
+}
+
+/* the field of a node holding its child in quadrant q */
+qtnode_t** child_slot(qtnode_t* node, enum quadrant q) {
+    return (q == nw) ? &node->nw : (q == ne) ? &node->ne : (q == sw) ? &node->sw : &node->se;
+}
+
+/* a node for a square, recycled if one has been reclaimed */
+qtnode_t* rcu_node(rcu_tree_t* rcu, square_t* square) {
+    qtnode_t* node = rcu->free_nodes;
+    if (node == NULL)
+        return arena_node(rcu->root->arena, square);
+    rcu->free_nodes = node->nw;
+    node->square = square;
+    node->point = NULL;
+    node->categories = 0;
+    node->generation = 0;
+    node->occupied = 0;
+    node->nw = node->ne = node->sw = node->se = NULL;
+    return node;
+}
+
+/* hand a node to fn once no reader can reach it any longer */
+void rcu_retire(rcu_tree_t* rcu, qtnode_t* node, reclaim_fn_t fn) {
+    if (rcu->nretired == rcu->retired_capacity) {
+        rcu->retired_capacity *= 2;
+        rcu->retired = (retired_t*) realloc(rcu->retired,
+                                            sizeof(retired_t) * rcu->retired_capacity);
+        assert(rcu->retired);
+    }
+    retired_t* retired = &rcu->retired[rcu->nretired++];
+    retired->fn = fn;
+    retired->node = node;
+    retired->epoch = __atomic_load_n(&rcu->epoch, __ATOMIC_RELAXED);
+    if (++rcu->since_reclaim >= RCU_RECLAIM_BATCH)
+        rcu_reclaim(rcu);
+}
+
+/* start a new epoch, and reclaim what no active reader can still hold:
+ * a reader announcing epoch e may hold anything retired in e or later
+ */
+void rcu_reclaim(rcu_tree_t* rcu) {
+    rcu->since_reclaim = 0;
+    uint64_t oldest = __atomic_add_fetch(&rcu->epoch, 1, __ATOMIC_SEQ_CST);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    int nreaders = __atomic_load_n(&rcu->nreaders, __ATOMIC_SEQ_CST);
+    for (int i=0; i < nreaders; i++) {
+        uint64_t epoch = __atomic_load_n(&rcu->readers[i].epoch, __ATOMIC_SEQ_CST);
+        if (epoch != RCU_IDLE && epoch < oldest) oldest = epoch;
+    }
+    int kept = 0;
+    for (int i=0; i < rcu->nretired; i++) {
+        retired_t retired = rcu->retired[i];
+        if (retired.epoch < oldest) retired.fn(rcu, retired.node);
+        else rcu->retired[kept++] = retired;
+    }
+    rcu->nretired = kept;
+}
+
+/* wait until everything retired so far has been reclaimed; writer only */
+void rcu_synchronize(rcu_tree_t* rcu) {
+    rcu_reclaim(rcu);
+    while (rcu->nretired > 0) {
+        sched_yield();
+        rcu_reclaim(rcu);
+    }
+}
+
+/* reclaim a replaced leaf, for reuse by rcu_node */
+void recycle_node(rcu_tree_t* rcu, qtnode_t* node) {
+    node->nw = rcu->free_nodes;
+    rcu->free_nodes = node;
+}
+
+/* drop the point the root held before it split */
+void clear_point(rcu_tree_t* rcu, qtnode_t* node) {
+    (void) rcu;
+    node->point = NULL;
+}
+
+/* free the tree once no reader is searching it any more */
+void free_rcu_tree(rcu_tree_t* rcu) {
+    assert(rcu);
+    rcu_synchronize(rcu);
+    free(rcu->retired);
+    free_tree(rcu->root);
+    free(rcu);
+}
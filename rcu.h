@@ -0,0 +1,73 @@
+/*
+ * RCU tree header: a tree that one writer inserts into while any number of
+ * readers search it without locks. The writer never changes a node readers
+ * may be looking at: a new child is built in full before one atomic pointer
+ * store publishes it, and a leaf that has to split is replaced by a copy
+ * with its children already in place. Replaced leaves are retired, and
+ * recycled once every reader that could still hold them has finished
+ * (epoch-based reclamation): readers announce the epoch they start in, and
+ * something retired in an epoch is only reclaimed once no reader announces
+ * that epoch or an earlier one.
+ */
+
+#include <stdint.h>
+#include "qtree.h"
+
+#ifndef QTREE_SELF_IMPLEMENTATION_RCU_H
+#define QTREE_SELF_IMPLEMENTATION_RCU_H
+
+#define RCU_MAX_READERS 64    // maximum number of registered reader threads
+#define RCU_RECLAIM_BATCH 64  // retirements between reclamation attempts
+#define RCU_INIT_CAP 64       // initial capacity of the retired list
+#define RCU_IDLE 0            // announced epoch of a reader outside a search
+
+// structures
+typedef struct rcu_tree rcu_tree_t;
+
+// what to do with a retired node once no reader can reach it
+typedef void (*reclaim_fn_t)(rcu_tree_t* rcu, qtnode_t* node);
+
+typedef struct retired {
+    reclaim_fn_t fn;
+    qtnode_t* node;
+    uint64_t epoch;
+} retired_t;
+
+// a reader's announced epoch, alone on its cache line
+typedef struct rcu_slot {
+    uint64_t epoch;
+    char pad[64 - sizeof(uint64_t)];
+} rcu_slot_t;
+
+struct rcu_tree {
+    qtnode_t* root;
+    uint64_t epoch;
+    rcu_slot_t readers[RCU_MAX_READERS];
+    int nreaders;
+    retired_t* retired;
+    int nretired;
+    int retired_capacity;
+    int since_reclaim;
+    qtnode_t* free_nodes;
+};
+
+// atomic loads and stores between the writer and the readers
+#define RCU_LOAD(ptr) __atomic_load_n(ptr, __ATOMIC_ACQUIRE)
+#define RCU_PUBLISH(ptr, value) __atomic_store_n(ptr, value, __ATOMIC_RELEASE)
+
+// function prototypes
+rcu_tree_t* init_rcu_tree(square_t* square);
+int rcu_register(rcu_tree_t* rcu);
+void rcu_read_lock(rcu_tree_t* rcu, int reader);
+void rcu_read_unlock(rcu_tree_t* rcu, int reader);
+void rcu_insert(rcu_tree_t* rcu, point_t* point);
+point_t* rcu_find_pt(rcu_tree_t* rcu, int reader, point_t* point);
+int rcu_range(rcu_tree_t* rcu, int reader, square_t* rectangle, point_t** out, int max);
+void rcu_search_pt(rcu_tree_t* rcu, int reader, point_t* point);
+void rcu_search_range(rcu_tree_t* rcu, int reader, square_t* rectangle);
+void rcu_synchronize(rcu_tree_t* rcu);
+void free_rcu_tree(rcu_tree_t* rcu);
+qtnode_t** child_slot(qtnode_t* node, enum quadrant q);
+void rcu_separate(qtnode_t* node, point_t* existing, point_t* point, arena_t* arena);
+
+#endif //QTREE_SELF_IMPLEMENTATION_RCU_H
@@ -9,14 +9,17 @@
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
-#include "math.h"
 #include "qtree.h"
 #include "read.h"
+#include "stats.h"
+#include "shape.h"
 
 /* switch-cases for manual queries */
 #define PRINT 0      // case print tree
 #define POINT 1      // case point search
 #define RANGE 2      // case range search
+#define STATS 3      // case print traversal statistics
+#define SHAPE 4      // case print tree shape profile
 #define ERROR (-1)   // case error input
 #define LEAVE (-2)   // case leave mode
 #define CLOSE (-10)  // case stop program
@@ -25,6 +28,8 @@
 #define PRINT_STR "print"
 #define POINT_STR "point"
 #define RANGE_STR "range"
+#define STATS_STR "stats"
+#define SHAPE_STR "shape"
 #define CLOSE_STR "close"
 #define LEAVE_STR "leave"
 
@@ -35,9 +40,11 @@ int verify_num(char* str);
 /* check which type of queries being instructed */
 int check_query(char* str);
 /* point search operation during query */
-void point_search_query(qtnode_t* tree, char* str, long double* pos);
+void point_search_query(qtnode_t* tree, char* str, long double* pos, arena_t* scratch);
 /* range search operation during query */
-void range_search_query(qtnode_t* tree, char* str, long double* pos);
+void range_search_query(qtnode_t* tree, char* str, long double* pos, arena_t* scratch);
+/* print the tree's shape and memory profile */
+void print_shape(qtnode_t* tree);
 
 /* manual input's entry; called when program runs with no arguments in terminal */
 int manual_input() {
@@ -77,6 +84,8 @@ int manual_input() {
     point_t *bL = init_point(xL, yB);
     point_t *tR = init_point(xR, yT);
     qtnode_t* tree = init_tree(init_square(bL, tR));
+    // queries allocate only from here, and it is reset after each of them
+    arena_t* scratch = init_arena(ARENA_SCRATCH_SIZE);
 
     /* insertion */
     print_header("Insertion");
@@ -86,7 +95,7 @@ int manual_input() {
     printf("(To stop insertion, input any non-digit characters.)\n");
     // not until stop condition is satisfied
     while (!stop) {
-        printf("Point %d:\n", (int) floor(i/2.0) + 1);
+        printf("Point %d:\n", i/2 + 1);
         while (!pnt_fin) {
             fgets(str, MAX_DIGIT, stdin);
             str = strtok(str, " ");
@@ -115,7 +124,7 @@ int manual_input() {
             i++;
         }
         // insert to tree
-        if (!stop) insert(tree, init_point(pos[0], pos[1]));
+        if (!stop) insert(tree, tree_point(tree, pos[0], pos[1]));
         pnt_fin = 0;
     }
 
@@ -126,6 +135,8 @@ int manual_input() {
         printf("To show the entire tree structure, enter \"print\";\n");
         printf("To initiate point search query, enter \"point\";\n");
         printf("To initiate range search query, enter \"range\";\n");
+        printf("To show traversal statistics so far, enter \"stats\";\n");
+        printf("To show the tree's shape and memory profile, enter \"shape\";\n");
         printf("To stop the program, enter \"close\";\n");
         fgets(str, MAX_DIGIT, stdin);
         query = check_query(str);
@@ -141,11 +152,19 @@ int manual_input() {
                 break;
             // point search
             case POINT:
-                point_search_query(tree, str, pos);
+                point_search_query(tree, str, pos, scratch);
                 break;
             // range search
             case RANGE:
-                range_search_query(tree, str, pos);
+                range_search_query(tree, str, pos, scratch);
+                break;
+            // traversal statistics
+            case STATS:
+                print_total_stats(stdout);
+                break;
+            // tree shape profile
+            case SHAPE:
+                print_shape(tree);
                 break;
             // stop program
             case CLOSE:
@@ -158,7 +177,10 @@ int manual_input() {
     // cleaning up
     fflush(stdin);
     free(str);
+    free_arena(scratch);
     free_tree(tree);
+    free(bL);
+    free(tR);
     return 0;
 }
 
@@ -194,8 +216,8 @@ int verify_num(char* str) {
 }
 
 /* check which type of queries is being instructed by user; depending
- * on what user enters ("point", "range", "print", "leave", "close",
- * or otherwise).
+ * on what user enters ("point", "range", "print", "stats", "shape",
+ * "leave", "close", or otherwise).
  */
 int check_query(char* str) {
     int len = (int)strlen(str);
@@ -204,7 +226,7 @@ int check_query(char* str) {
     if (len != strlen(POINT_STR)) return ERROR;
     // conditions
     int notPoint = 0, notRange = 0, notPrint = 0,
-        notClose = 0, notLeave = 0;
+        notClose = 0, notLeave = 0, notStats = 0, notShape = 0;
     // if at any point the 2 strings differ, then it isn't that mode
     for (int i=0; i < len; i++) {
         if (str[i] != POINT_STR[i])
@@ -217,18 +239,23 @@ int check_query(char* str) {
             notClose = 1;
         if (str[i] != LEAVE_STR[i])
             notLeave = 1;
+        if (str[i] != STATS_STR[i])
+            notStats = 1;
+        if (str[i] != SHAPE_STR[i])
+            notShape = 1;
     }
     // has to be either one of these modes
     return  (!notPrint) ? PRINT : (!notPoint) ? POINT :
             (!notRange) ? RANGE : (!notClose) ? CLOSE :
-            (!notLeave) ? LEAVE : ERROR;
+            (!notLeave) ? LEAVE : (!notStats) ? STATS :
+            (!notShape) ? SHAPE : ERROR;
 }
 
 /* point search query; used when user has entered "point" mode, which
  * will accept 2 number arguments at a time as x,y-coordinates of the
- * queried point
+ * queried point; the point lives in scratch until its search is done
  */
-void point_search_query(qtnode_t* tree, char* str, long double* pos) {
+void point_search_query(qtnode_t* tree, char* str, long double* pos, arena_t* scratch) {
     // square coordinates
     long double xL = tree->square->bottom_left->x;
     long double xR = tree->square->top_right->x;
@@ -259,7 +286,8 @@ void point_search_query(qtnode_t* tree, char* str, long double* pos) {
         // storing x,y coordinates accordingly
         if (i % 2) {
             pos[1] = value;
-            search_pt(tree, init_point(pos[0], pos[1]));
+            search_pt(tree, arena_point(scratch, pos[0], pos[1]));
+            arena_reset(scratch);
         }
         else pos[0] = value;
         i++;
@@ -268,9 +296,10 @@ void point_search_query(qtnode_t* tree, char* str, long double* pos) {
 
 /* range search query; used when user has entered "range" mode, which
  * accepts 4 number arguments at a time as a pair of x-y coordinates
- * of the bottom left and top right points of the queried square
+ * of the bottom left and top right points of the queried square; the
+ * square lives in scratch until its search is done
  */
-void range_search_query(qtnode_t* tree, char* str, long double* pos) {
+void range_search_query(qtnode_t* tree, char* str, long double* pos, arena_t* scratch) {
     // square coordinates
     long double xL = tree->square->bottom_left->x;
     long double xR = tree->square->top_right->x;
@@ -309,8 +338,18 @@ void range_search_query(qtnode_t* tree, char* str, long double* pos) {
         // creating the square for range search once finishes the x-y pair
         if (i == MIN_ARGS) {
             i = 0;
-            search_range(tree, init_square(init_point(pos[0], pos[1]),
-                                                   init_point(pos[2], pos[3])));
+            search_range(tree, arena_square(scratch, arena_point(scratch, pos[0], pos[1]),
+                                            arena_point(scratch, pos[2], pos[3])));
+            arena_reset(scratch);
         }
     }
 }
+
+/* print the tree's shape and memory profile; used when user has entered
+ * "shape" mode
+ */
+void print_shape(qtnode_t* tree) {
+    tree_stats_t stats;
+    tree_stats(tree, &stats);
+    print_tree_stats(stdout, &stats);
+}
@@ -0,0 +1,241 @@
+/*
+ * PMR quadtree over segments. Segments are identified by the order they
+ * were inserted in (0, 1, 2, ...), which for a footpath dataset is simply
+ * the row's index. Since a segment may sit in many leaves, range search
+ * stamps every reported segment with the query's number so that it is
+ * reported only once; the tree therefore serves one query at a time.
+ */
+
+#include <stdlib.h>
+#include <assert.h>
+#include "segment.h"
+
+/* initialize a leaf of the segment tree within its arena */
+seg_node_t* init_seg_node(arena_t* arena, square_t* square, int depth);
+
+/* insert segment id into every leaf of node it passes through */
+void seg_node_insert(seg_tree_t* tree, seg_node_t* node, int id);
+
+/* append segment id to a leaf's list */
+void seg_node_add(seg_node_t* node, int id);
+
+/* split a leaf into 4 children, redistributing its segments */
+void seg_split(seg_tree_t* tree, seg_node_t* node);
+
+/* range search below node, appending unseen intersecting segments */
+void seg_search_node(seg_tree_t* tree, seg_node_t* node, square_t* rectangle,
+                     int** result, int* n, int* capacity);
+
+/* free the segment id lists of a node and its subtree */
+void free_seg_ids(seg_node_t* node);
+
+/* clip the parametric range [t0, t1] of a segment against one boundary */
+int clip_edge(long double p, long double q, long double* t0, long double* t1);
+
+
+/* initialize a segment tree covering square, with the given split threshold */
+seg_tree_t* init_seg_tree(square_t* square, int threshold) {
+    assert(square); assert(threshold > 0);
+    seg_tree_t* tree = (seg_tree_t*) malloc(sizeof(seg_tree_t));
+    assert(tree);
+    tree->arena = init_arena(ARENA_BLOCK_SIZE);
+    tree->root = init_seg_node(tree->arena, square, 0);
+    tree->threshold = threshold;
+    tree->length = 0;
+    tree->capacity = SEG_INIT_CAP;
+    tree->segments = (segment_t*) malloc(sizeof(segment_t) * tree->capacity);
+    tree->stamps = (unsigned*) malloc(sizeof(unsigned) * tree->capacity);
+    assert(tree->segments && tree->stamps);
+    tree->stamp = 0;
+    return tree;
+}
+
+/* initialize a leaf; nodes, their squares and corner points all live in
+ * the tree's arena
+ */
+seg_node_t* init_seg_node(arena_t* arena, square_t* square, int depth) {
+    seg_node_t* node = (seg_node_t*) arena_alloc(arena, sizeof(seg_node_t));
+    node->square = square;
+    node->ids = NULL;
+    node->count = 0;
+    node->capacity = 0;
+    node->depth = depth;
+    node->nw = NULL;
+    node->ne = NULL;
+    node->sw = NULL;
+    node->se = NULL;
+    return node;
+}
+
+/* insert a segment from start to end; returns its id */
+int seg_insert(seg_tree_t* tree, point_t* start, point_t* end) {
+    assert(tree); assert(start); assert(end);
+    if (tree->length == tree->capacity) {
+        tree->capacity *= 2;
+        tree->segments = (segment_t*) realloc(tree->segments,
+                                              sizeof(segment_t) * tree->capacity);
+        tree->stamps = (unsigned*) realloc(tree->stamps,
+                                           sizeof(unsigned) * tree->capacity);
+        assert(tree->segments && tree->stamps);
+    }
+    int id = tree->length++;
+    tree->segments[id].start = start;
+    tree->segments[id].end = end;
+    tree->stamps[id] = tree->stamp;
+    seg_node_insert(tree, tree->root, id);
+    return id;
+}
+
+/* insert into every leaf the segment passes through */
+void seg_node_insert(seg_tree_t* tree, seg_node_t* node, int id) {
+    segment_t* seg = &tree->segments[id];
+    if (!segment_intersect(node->square, seg->start, seg->end)) return;
+    // base case - leaf node; PMR rule splits only once per insertion
+    if (node->nw == NULL) {
+        seg_node_add(node, id);
+        if (node->count > tree->threshold && node->depth < SEG_MAX_DEPTH)
+            seg_split(tree, node);
+        return;
+    }
+    seg_node_insert(tree, node->nw, id);
+    seg_node_insert(tree, node->ne, id);
+    seg_node_insert(tree, node->sw, id);
+    seg_node_insert(tree, node->se, id);
+}
+
+/* append id to a leaf's list, growing it if needed */
+void seg_node_add(seg_node_t* node, int id) {
+    if (node->count == node->capacity) {
+        node->capacity = (node->capacity) ? node->capacity * 2 : SEG_THRESHOLD + 1;
+        node->ids = (int*) realloc(node->ids, sizeof(int) * node->capacity);
+        assert(node->ids);
+    }
+    node->ids[node->count++] = id;
+}
+
+/* split a leaf into 4 children; the children are not split further even
+ * if they too exceed the threshold
+ */
+void seg_split(seg_tree_t* tree, seg_node_t* node) {
+    point_t* bottomLeft = node->square->bottom_left;
+    point_t* topRight = node->square->top_right;
+    long double xMid, yMid;
+    get_midpoints(node->square, &xMid, &yMid);
+    arena_t* arena = tree->arena;
+    point_t* center = arena_point(arena, xMid, yMid);
+    int depth = node->depth + 1;
+    node->nw = init_seg_node(arena, arena_square(arena, arena_point(arena, bottomLeft->x, yMid),
+                                                 arena_point(arena, xMid, topRight->y)), depth);
+    node->ne = init_seg_node(arena, arena_square(arena, center, topRight), depth);
+    node->sw = init_seg_node(arena, arena_square(arena, bottomLeft, center), depth);
+    node->se = init_seg_node(arena, arena_square(arena, arena_point(arena, xMid, bottomLeft->y),
+                                                 arena_point(arena, topRight->x, yMid)), depth);
+    seg_node_t* children[4] = {node->nw, node->ne, node->sw, node->se};
+    for (int i=0; i < node->count; i++) {
+        segment_t* seg = &tree->segments[node->ids[i]];
+        for (int c=0; c < 4; c++)
+            if (segment_intersect(children[c]->square, seg->start, seg->end))
+                seg_node_add(children[c], node->ids[i]);
+    }
+    free(node->ids);
+    node->ids = NULL;
+    node->count = 0;
+    node->capacity = 0;
+}
+
+/* range search: every segment passing through the rectangle, each reported
+ * once; *result is allocated here and must be freed by the caller
+ */
+int seg_search_range(seg_tree_t* tree, square_t* rectangle, int** result) {
+    assert(tree); assert(rectangle); assert(result);
+    int n = 0, capacity = SEG_INIT_CAP;
+    *result = (int*) malloc(sizeof(int) * capacity);
+    assert(*result);
+    // new query number; on wrap-around, reset every stamp
+    if (++tree->stamp == 0) {
+        for (int i=0; i < tree->length; i++) tree->stamps[i] = 0;
+        tree->stamp = 1;
+    }
+    seg_search_node(tree, tree->root, rectangle, result, &n, &capacity);
+    return n;
+}
+
+/* range search below node */
+void seg_search_node(seg_tree_t* tree, seg_node_t* node, square_t* rectangle,
+                     int** result, int* n, int* capacity) {
+    if (!rectangle_intersect(node->square, rectangle)) return;
+    // base case - leaf node
+    if (node->nw == NULL) {
+        for (int i=0; i < node->count; i++) {
+            int id = node->ids[i];
+            if (tree->stamps[id] == tree->stamp) continue;
+            tree->stamps[id] = tree->stamp;
+            segment_t* seg = &tree->segments[id];
+            if (!segment_intersect(rectangle, seg->start, seg->end)) continue;
+            if (*n == *capacity) {
+                *capacity *= 2;
+                *result = (int*) realloc(*result, sizeof(int) * (*capacity));
+                assert(*result);
+            }
+            (*result)[(*n)++] = id;
+        }
+        return;
+    }
+    seg_search_node(tree, node->nw, rectangle, result, n, capacity);
+    seg_search_node(tree, node->ne, rectangle, result, n, capacity);
+    seg_search_node(tree, node->sw, rectangle, result, n, capacity);
+    seg_search_node(tree, node->se, rectangle, result, n, capacity);
+}
+
+/* check whether the segment p1-p2 passes through the (closed) rectangle,
+ * by Liang-Barsky clipping
+ */
+int segment_intersect(square_t* rectangle, point_t* p1, point_t* p2) {
+    long double dx = p2->x - p1->x, dy = p2->y - p1->y;
+    long double t0 = 0, t1 = 1;
+    return clip_edge(-dx, p1->x - rectangle->bottom_left->x, &t0, &t1) &&
+           clip_edge(dx, rectangle->top_right->x - p1->x, &t0, &t1) &&
+           clip_edge(-dy, p1->y - rectangle->bottom_left->y, &t0, &t1) &&
+           clip_edge(dy, rectangle->top_right->y - p1->y, &t0, &t1);
+}
+
+/* clip [t0, t1] against the boundary p*t <= q; 0 if nothing is left */
+int clip_edge(long double p, long double q, long double* t0, long double* t1) {
+    // parallel to the boundary: inside or entirely outside
+    if (p == 0) return q >= 0;
+    long double t = q / p;
+    if (p < 0) {
+        if (t > *t1) return 0;
+        if (t > *t0) *t0 = t;
+    }
+    else {
+        if (t < *t0) return 0;
+        if (t < *t1) *t1 = t;
+    }
+    return 1;
+}
+
+/* free the segment tree, along with every node, square and corner point made
+ * by splitting; the root's square and the segments' end points belong to
+ * the caller
+ */
+void free_seg_tree(seg_tree_t* tree) {
+    assert(tree);
+    free_seg_ids(tree->root);
+    free_arena(tree->arena);
+    free(tree->segments);
+    free(tree->stamps);
+    free(tree);
+}
+
+/* free the segment id lists of a node and its subtree; the nodes
+ * themselves go with the arena
+ */
+void free_seg_ids(seg_node_t* node) {
+    if (node == NULL) return;
+    free_seg_ids(node->nw);
+    free_seg_ids(node->ne);
+    free_seg_ids(node->sw);
+    free_seg_ids(node->se);
+    free(node->ids);
+}
@@ -0,0 +1,55 @@
+/*
+ * Segment index header: a PMR quadtree over line segments (e.g. a footpath
+ * from its start to its end point). A segment is stored in every leaf it
+ * passes through, and a leaf splits once, by one level, whenever an insertion
+ * takes it past the split threshold.
+ */
+
+#include "qtree.h"
+#include "arena.h"
+
+#ifndef QTREE_SELF_IMPLEMENTATION_SEGMENT_H
+#define QTREE_SELF_IMPLEMENTATION_SEGMENT_H
+
+#define SEG_THRESHOLD 4      // default PMR split threshold of a leaf
+#define SEG_MAX_DEPTH 32     // leaves at this depth never split
+#define SEG_INIT_CAP 64      // initial capacity of the segment array
+
+// structures
+typedef struct segment {
+    point_t* start;
+    point_t* end;
+} segment_t;
+
+typedef struct seg_node seg_node_t;
+struct seg_node {
+    square_t* square;
+    int* ids;
+    int count;
+    int capacity;
+    int depth;
+    seg_node_t* nw;
+    seg_node_t* ne;
+    seg_node_t* sw;
+    seg_node_t* se;
+};
+
+typedef struct seg_tree {
+    seg_node_t* root;
+    arena_t* arena;
+    segment_t* segments;
+    unsigned* stamps;
+    unsigned stamp;
+    int length;
+    int capacity;
+    int threshold;
+} seg_tree_t;
+
+// function prototypes
+seg_tree_t* init_seg_tree(square_t* square, int threshold);
+int seg_insert(seg_tree_t* tree, point_t* start, point_t* end);
+int seg_search_range(seg_tree_t* tree, square_t* rectangle, int** result);
+int segment_intersect(square_t* rectangle, point_t* p1, point_t* p2);
+void free_seg_tree(seg_tree_t* tree);
+
+#endif //QTREE_SELF_IMPLEMENTATION_SEGMENT_H
@@ -0,0 +1,403 @@
+/*
+ * Query server (see server.h). Clients are non-blocking; whatever a client
+ * sends is buffered until whole frames can be cut from it, and replies
+ * are buffered until the socket takes them. A client whose replies pile up
+ * past SERVER_HIGH_WATER is not read from again until they drain, so a
+ * client that writes without reading cannot grow the server without
+ * bound. SIGINT and SIGTERM stop the loop after the current round.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include "server.h"
+#include "stage.h"
+#include "knn.h"
+
+static volatile sig_atomic_t server_stopping = 0;
+
+/* signal handler asking the event loop to stop */
+void server_stop(int signal);
+
+/* read what a client has sent, answering every whole request; 0 once the
+ * client is to be closed
+ */
+int client_read(client_t* client, server_handler_t handler, void* context);
+
+/* write as much of a client's pending replies as the socket takes; 0 on
+ * error
+ */
+int client_write(client_t* client);
+
+/* close a client's connection and free its buffers */
+void client_close(client_t* client);
+
+/* append the ids or records of the footpaths found to a response */
+void add_footpaths(bytes_t* out, int format, footpath_t** footpaths, int n);
+
+/* append the footpaths found to a response by id, each followed by its
+ * record's length and text with PROTO_RECORDS
+ */
+void add_tagged(bytes_t* out, int format, footpath_t** footpaths, int n);
+
+/* append the footpaths found to a response by id, each followed by its
+ * record's length and text with PROTO_RECORDS
+ */
+void add_tagged(bytes_t* out, int format, footpath_t** footpaths, int n) {
+    for (int i=0; i < n; i++) {
+        unsigned char id[4];
+        put_u32(id, (uint32_t) footpaths[i]->footpath_id);
+        bytes_append(out, id, sizeof(id));
+        if (!(format & PROTO_RECORDS)) continue;
+        // the record's length goes before it, once it is known
+        size_t at = out->length;
+        bytes_append(out, id, sizeof(id));
+        add_footpaths(out, PROTO_RECORDS, &footpaths[i], 1);
+        put_u32(out->data + at, (uint32_t) (out->length - at - 4));
+    }
+}
+
+/* append the k locations nearest to the query to a response, each with
+ * its footpaths; returns the number of locations
+ */
+int add_locations(bytes_t* out, int format, qtnode_t* tree, point_t* query, int k);
+
+/* create a TCP socket listening at "host:port"; -1 on error */
+int tcp_listen(char* address);
+
+/* whether a socket file may be created at path: nothing is there, or a
+ * stale socket no server accepts connections at any more
+ */
+int socket_path_free(char* path);
+
+/* create a socket listening at an address (see proto.h). A Unix domain
+ * socket is bound at a temporary path and only renamed to its own once
+ * listening, so its socket file never appears before connections are
+ * accepted. It replaces a stale socket file there, but neither a file that
+ * is not a socket nor one a server still listens at. -1 on error
+ */
+int server_listen(char* path) {
+    if (is_tcp_address(path))
+        return tcp_listen(path);
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    int length = snprintf(address.sun_path, sizeof(address.sun_path), "%s.%ld", path,
+                          (long) getpid());
+    if (length < 0 || (size_t) length >= sizeof(address.sun_path)) {
+        fprintf(stderr, "Socket path %s is too long!\n", path);
+        return -1;
+    }
+    if (!socket_path_free(path)) return -1;
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+    unlink(address.sun_path);
+    if (bind(fd, (struct sockaddr*) &address, sizeof(address)) < 0) {
+        close(fd);
+        return -1;
+    }
+    if (listen(fd, SERVER_BACKLOG) < 0 || rename(address.sun_path, path) < 0) {
+        unlink(address.sun_path);
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/* whether a socket file may be created at path: nothing is there, or a
+ * stale socket no server accepts connections at any more
+ */
+int socket_path_free(char* path) {
+    struct stat status;
+    if (lstat(path, &status) < 0) return errno == ENOENT;
+    if (!S_ISSOCK(status.st_mode)) {
+        fprintf(stderr, "%s exists and is not a socket!\n", path);
+        return 0;
+    }
+    int fd = connect_to(path);
+    if (fd >= 0) {
+        close(fd);
+        fprintf(stderr, "A server is already listening at %s!\n", path);
+        return 0;
+    }
+    return 1;
+}
+
+/* serve clients of a listening socket until SIGINT or SIGTERM, answering
+ * each request with the handler; returns 0 once stopped, -1 on error
+ */
+int server_run(int listen_fd, server_handler_t handler, void* context) {
+    client_t* clients = (client_t*) calloc(SERVER_MAX_CLIENTS, sizeof(client_t));
+    struct pollfd* fds = (struct pollfd*) malloc(sizeof(struct pollfd) * (SERVER_MAX_CLIENTS + 1));
+    assert(clients); assert(fds);
+    int nclients = 0, status = 0;
+    server_stopping = 0;
+    signal(SIGINT, server_stop);
+    signal(SIGTERM, server_stop);
+    signal(SIGPIPE, SIG_IGN);
+    while (!server_stopping) {
+        fds[0].fd = listen_fd;
+        fds[0].events = (nclients < SERVER_MAX_CLIENTS) ? POLLIN : 0;
+        for (int i=0; i < nclients; i++) {
+            client_t* client = &clients[i];
+            fds[i+1].fd = client->fd;
+            fds[i+1].events = 0;
+            if (!client->closing && client->out.length - client->sent < SERVER_HIGH_WATER)
+                fds[i+1].events |= POLLIN;
+            if (client->sent < client->out.length)
+                fds[i+1].events |= POLLOUT;
+        }
+        if (poll(fds, nclients + 1, -1) < 0) {
+            if (errno == EINTR) continue;
+            status = -1;
+            break;
+        }
+        // serve the clients polled, closing those that are done
+        int polled = nclients;
+        for (int i=polled-1; i >= 0; i--) {
+            client_t* client = &clients[i];
+            short revents = fds[i+1].revents;
+            int open = 1;
+            if (!client->closing && (revents & (POLLIN | POLLHUP | POLLERR)))
+                open = client_read(client, handler, context);
+            else if (revents & POLLERR)
+                open = 0;
+            if (open && client->sent < client->out.length)
+                open = client_write(client);
+            if (open && client->closing && client->sent == client->out.length)
+                open = 0;
+            if (!open) {
+                client_close(client);
+                clients[i] = clients[--nclients];
+            }
+        }
+        // then take on new ones
+        if (fds[0].revents & POLLIN) {
+            while (nclients < SERVER_MAX_CLIENTS) {
+                int fd = accept4(listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+                if (fd < 0) break;
+                // replies should not wait to coalesce; fails harmlessly off TCP
+                int one = 1;
+                setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+                memset(&clients[nclients], 0, sizeof(client_t));
+                clients[nclients++].fd = fd;
+            }
+        }
+    }
+    for (int i=0; i < nclients; i++)
+        client_close(&clients[i]);
+    free(clients);
+    free(fds);
+    return status;
+}
+
+/* read what a client has sent, answering every whole request; 0 once the
+ * client is to be closed
+ */
+int client_read(client_t* client, server_handler_t handler, void* context) {
+    // a single read per round, so that a busy client cannot hold up the rest
+    bytes_reserve(&client->in, SERVER_READ_SIZE);
+    ssize_t got = read(client->fd, client->in.data + client->in.length, SERVER_READ_SIZE);
+    if (got > 0)
+        client->in.length += (size_t) got;
+    else if (got == 0)
+        // end of file: answer what came, then close once it is sent
+        client->closing = 1;
+    else if (errno != EINTR && errno != EAGAIN && errno != EWOULDBLOCK)
+        return 0;
+    // every whole frame is answered, the rest waits for more
+    size_t offset = 0;
+    uint32_t length;
+    int ready;
+    while ((ready = frame_ready(client->in.data + offset, client->in.length - offset,
+                                &length)) == 1) {
+        request_t request;
+        if (decode_request(client->in.data + offset + 4, length, &request))
+            handler(context, &request, &client->out);
+        else {
+            response_t response = {0, PROTO_BAD_REQUEST, PROTO_IDS, 0, 0};
+            end_response(&client->out, begin_response(&client->out, &response), 0);
+        }
+        offset += 4 + length;
+    }
+    bytes_consume(&client->in, offset);
+    return ready >= 0;
+}
+
+/* write as much of a client's pending replies as the socket takes; 0 on
+ * error
+ */
+int client_write(client_t* client) {
+    while (client->sent < client->out.length) {
+        ssize_t sent = write(client->fd, client->out.data + client->sent,
+                             client->out.length - client->sent);
+        if (sent > 0) {
+            client->sent += (size_t) sent;
+            continue;
+        }
+        if (sent < 0 && errno == EINTR) continue;
+        if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+        return 0;
+    }
+    // once all is sent, the buffer starts over
+    if (client->sent == client->out.length) {
+        client->out.length = 0;
+        client->sent = 0;
+    }
+    return 1;
+}
+
+/* close a client's connection and free its buffers */
+void client_close(client_t* client) {
+    close(client->fd);
+    free(client->in.data);
+    free(client->out.data);
+}
+
+/* signal handler asking the event loop to stop */
+void server_stop(int signal) {
+    (void) signal;
+    server_stopping = 1;
+}
+
+/* answer a request over a footpath tree (see stage.h) */
+void footpath_handler(void* tree, request_t* request, bytes_t* out) {
+    response_t response = {request->id, PROTO_OK, request->format, 0, 0};
+    point_t p1 = {.x = request->x1, .y = request->y1}, p2 = {.x = request->x2, .y = request->y2};
+    square_t rectangle = {.bottom_left = &p1, .top_right = &p2};
+    footpath_t** footpaths = NULL;
+    int n = 0;
+    if (request->op == PROTO_KNN && request->k <= SERVER_MAX_K &&
+        (request->format & ~PROTO_RECORDS) == PROTO_BY_LOCATION) {
+        size_t start = begin_response(out, &response);
+        n = add_locations(out, request->format, (qtnode_t*) tree, &p1, (int) request->k);
+        end_response(out, start, (uint32_t) n);
+        return;
+    }
+    if (request->op == PROTO_RANGE && request->format == (PROTO_RECORDS | PROTO_TAGGED)) {
+        n = range_footpaths((qtnode_t*) tree, &rectangle, &footpaths);
+        size_t start = begin_response(out, &response);
+        add_tagged(out, request->format, footpaths, n);
+        end_response(out, start, (uint32_t) n);
+        free(footpaths);
+        return;
+    }
+    if (request->format != PROTO_IDS && request->format != PROTO_RECORDS)
+        response.status = PROTO_BAD_REQUEST;
+    else if (request->op == PROTO_POINT)
+        n = point_footpaths((qtnode_t*) tree, &p1, &footpaths);
+    else if (request->op == PROTO_RANGE || request->op == PROTO_COUNT)
+        n = range_footpaths((qtnode_t*) tree, &rectangle, &footpaths);
+    else if (request->op == PROTO_KNN && request->k <= SERVER_MAX_K)
+        n = knn_footpaths((qtnode_t*) tree, &p1, (int) request->k, &footpaths);
+    else response.status = PROTO_BAD_REQUEST;
+    size_t start = begin_response(out, &response);
+    if (request->op != PROTO_COUNT)
+        add_footpaths(out, request->format, footpaths, n);
+    end_response(out, start, (uint32_t) n);
+    free(footpaths);
+}
+
+/* append the ids or records of the footpaths found to a response */
+void add_footpaths(bytes_t* out, int format, footpath_t** footpaths, int n) {
+    if (format == PROTO_IDS) {
+        bytes_reserve(out, 4 * (size_t) n);
+        for (int i=0; i < n; i++) {
+            put_u32(out->data + out->length, (uint32_t) footpaths[i]->footpath_id);
+            out->length += 4;
+        }
+        return;
+    }
+    char* text = NULL;
+    size_t length = 0;
+    FILE* records = open_memstream(&text, &length);
+    assert(records);
+    for (int i=0; i < n; i++)
+        print_footpath(records, footpaths[i]);
+    fclose(records);
+    bytes_append(out, text, length);
+    free(text);
+}
+
+/* append the k locations nearest to the query to a response, each with
+ * its footpaths; returns the number of locations
+ */
+int add_locations(bytes_t* out, int format, qtnode_t* tree, point_t* query, int k) {
+    point_t** nearest = (point_t**) malloc(sizeof(point_t*) * (k > 0 ? k : 1));
+    assert(nearest);
+    int found = search_knn(tree, query, k, NULL, nearest);
+    for (int i=0; i < found; i++) {
+        footpath_t** footpaths;
+        int n = location_footpaths((location_t*) nearest[i], &footpaths);
+        unsigned char header[PROTO_LOCATION_LEN];
+        double x = (double) nearest[i]->x, y = (double) nearest[i]->y;
+        put_f64(header, x);
+        put_f64(header + 8, y);
+        put_f64(header + 16, (double) (nearest[i]->x - x));
+        put_f64(header + 24, (double) (nearest[i]->y - y));
+        put_u32(header + 32, (uint32_t) n);
+        bytes_append(out, header, sizeof(header));
+        add_tagged(out, format, footpaths, n);
+        free(footpaths);
+    }
+    free(nearest);
+    return found;
+}
+
+/* create a TCP socket listening at "host:port", on every interface when
+ * the host is empty; -1 on error
+ */
+int tcp_listen(char* address) {
+    struct addrinfo* found;
+    if (resolve_address(address, AI_PASSIVE, &found) != 0) return -1;
+    int fd = -1;
+    for (struct addrinfo* at = found; at != NULL && fd < 0; at = at->ai_next) {
+        fd = socket(at->ai_family, at->ai_socktype | SOCK_NONBLOCK | SOCK_CLOEXEC,
+                    at->ai_protocol);
+        if (fd < 0) continue;
+        int one = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        if (bind(fd, at->ai_addr, at->ai_addrlen) < 0 || listen(fd, SERVER_BACKLOG) < 0) {
+            close(fd);
+            fd = -1;
+        }
+    }
+    freeaddrinfo(found);
+    return fd;
+}
+
+/* serve the footpaths of a tree at an address until stopped; a socket
+ * file is removed afterwards. Returns 0 once stopped, -1 on error
+ */
+int serve_footpaths(char* path, qtnode_t* tree) {
+    return server_serve(path, footpath_handler, tree);
+}
+
+/* answer requests with a handler at an address until stopped; a socket
+ * file is removed afterwards. Returns 0 once stopped, -1 on error
+ */
+int server_serve(char* path, server_handler_t handler, void* context) {
+    int fd = server_listen(path);
+    if (fd < 0) {
+        fprintf(stderr, "Cannot listen at %s!\n", path);
+        return -1;
+    }
+    int status = server_run(fd, handler, context);
+    close(fd);
+    if (!is_tcp_address(path)) unlink(path);
+    return status;
+}
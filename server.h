@@ -0,0 +1,43 @@
+/*
+ * Query server header: a daemon answering the binary requests of proto.h
+ * over a Unix domain socket (or TCP), so that a dataset is loaded once and then
+ * queried by any number of processes. A single thread runs an event loop
+ * over every client with poll(); each connection may pipeline requests,
+ * which are answered in order as soon as they are complete. A handler
+ * turns each request into its response, so the same loop can serve
+ * anything that speaks the protocol.
+ */
+
+#include "proto.h"
+#include "qtree.h"
+
+#ifndef QTREE_SELF_IMPLEMENTATION_SERVER_H
+#define QTREE_SELF_IMPLEMENTATION_SERVER_H
+
+#define SERVER_MAX_CLIENTS 256       // connections served at once
+#define SERVER_BACKLOG 64            // pending connections the socket queues
+#define SERVER_READ_SIZE 65536       // bytes read from a client at a time
+#define SERVER_HIGH_WATER (4 << 20)  // unsent reply bytes past which a client is not read
+#define SERVER_MAX_K 4096            // largest k of a kNN request
+
+// structures
+
+// appends the response to a request to out
+typedef void (*server_handler_t)(void* context, request_t* request, bytes_t* out);
+
+typedef struct client {
+    int fd;
+    bytes_t in;
+    bytes_t out;
+    size_t sent;
+    int closing;
+} client_t;
+
+// function prototypes
+int server_listen(char* path);
+int server_run(int listen_fd, server_handler_t handler, void* context);
+int server_serve(char* path, server_handler_t handler, void* context);
+void footpath_handler(void* tree, request_t* request, bytes_t* out);
+int serve_footpaths(char* path, qtnode_t* tree);
+
+#endif //QTREE_SELF_IMPLEMENTATION_SERVER_H
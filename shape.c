@@ -0,0 +1,91 @@
+/*
+ * Tree shape profiling. Memory is what the tree's own structures take:
+ * every node and its square, the corner points split() creates for each
+ * child (1 or 2, as children share their parent's corner where they can;
+ * plus the o.s's own 2) and the stored points.
+ * Fragmentation compares the address range the nodes below the root are
+ * spread over with the bytes they actually need: 0 means the nodes sit back
+ * to back, values near 1 mean they are scattered thinly across memory. The
+ * root is left out, as it is allocated apart from the rest of the tree.
+ */
+
+#include <string.h>
+#include <stdint.h>
+#include <assert.h>
+#include "shape.h"
+
+/* profile the subtree below node, at the given depth */
+void shape_node(qtnode_t* node, int depth, tree_stats_t* stats,
+                uintptr_t* lowest, uintptr_t* highest);
+
+/* profile a built tree into stats */
+void tree_stats(qtnode_t* tree, tree_stats_t* stats) {
+    assert(tree); assert(stats);
+    memset(stats, 0, sizeof(tree_stats_t));
+    uintptr_t lowest = UINTPTR_MAX, highest = 0;
+    shape_node(tree, 0, stats, &lowest, &highest);
+    stats->node_bytes = stats->nodes * sizeof(qtnode_t);
+    stats->square_bytes = stats->nodes * sizeof(square_t);
+    stats->point_bytes = (stats->points + stats->corners + 2) * sizeof(point_t);
+    if (stats->nodes > 1) {
+        size_t span = highest - lowest + sizeof(qtnode_t);
+        stats->fragmentation = 1.0 - (double) (stats->node_bytes - sizeof(qtnode_t)) / span;
+    }
+}
+
+/* profile the subtree below node */
+void shape_node(qtnode_t* node, int depth, tree_stats_t* stats,
+                uintptr_t* lowest, uintptr_t* highest) {
+    if (node == NULL) return;
+    uintptr_t address = (uintptr_t) node;
+    if (depth > 0 && address < *lowest) *lowest = address;
+    if (depth > 0 && address > *highest) *highest = address;
+    stats->nodes++;
+    stats->nodes_by_depth[(depth < SHAPE_MAX_DEPTH) ? depth : SHAPE_MAX_DEPTH-1]++;
+    // base case - leaf node
+    if (IS_LEAF(node)) {
+        int points = (node->point != NULL);
+        stats->leaves++;
+        stats->empty_leaves += !points;
+        stats->points += points;
+        stats->points_per_leaf[(points < SHAPE_MAX_POINTS) ? points : SHAPE_MAX_POINTS]++;
+        stats->leaf_depth_sum += depth;
+        if (depth > stats->max_leaf_depth) stats->max_leaf_depth = depth;
+        return;
+    }
+    // nw and se children make 2 corner points of their own, ne and sw 1
+    stats->corners += 2*(node->nw != NULL) + (node->ne != NULL) +
+                      (node->sw != NULL) + 2*(node->se != NULL);
+    shape_node(node->nw, depth+1, stats, lowest, highest);
+    shape_node(node->ne, depth+1, stats, lowest, highest);
+    shape_node(node->sw, depth+1, stats, lowest, highest);
+    shape_node(node->se, depth+1, stats, lowest, highest);
+}
+
+/* print the profile as a readable report */
+void print_tree_stats(FILE* f, tree_stats_t* stats) {
+    assert(stats);
+    fprintf(f, "Nodes: %ld (%ld leaves, %ld internal)\n", stats->nodes,
+            stats->leaves, stats->nodes - stats->leaves);
+    fprintf(f, "Empty leaves: %ld (%.1f%% of leaves)\n", stats->empty_leaves,
+            stats->leaves ? 100.0 * stats->empty_leaves / stats->leaves : 0);
+    fprintf(f, "Leaf depth: average %.2f, max %d\n",
+            stats->leaves ? (double) stats->leaf_depth_sum / stats->leaves : 0,
+            stats->max_leaf_depth);
+    fprintf(f, "Nodes by depth:\n");
+    for (int d=0; d < SHAPE_MAX_DEPTH; d++)
+        if (stats->nodes_by_depth[d])
+            fprintf(f, "   %3d%s: %ld\n", d, (d == SHAPE_MAX_DEPTH-1) ? "+" : " ",
+                    stats->nodes_by_depth[d]);
+    fprintf(f, "Points per leaf:\n");
+    for (int p=0; p <= SHAPE_MAX_POINTS; p++)
+        if (stats->points_per_leaf[p])
+            fprintf(f, "   %3d%s: %ld\n", p, (p == SHAPE_MAX_POINTS) ? "+" : " ",
+                    stats->points_per_leaf[p]);
+    size_t total = stats->node_bytes + stats->square_bytes + stats->point_bytes;
+    fprintf(f, "Memory: %zu bytes (nodes %zu, squares %zu, points %zu), "
+               "%.1f bytes per point\n", total, stats->node_bytes,
+            stats->square_bytes, stats->point_bytes,
+            stats->points ? (double) total / stats->points : 0);
+    fprintf(f, "Fragmentation: %.3f\n", stats->fragmentation);
+}
@@ -0,0 +1,39 @@
+/*
+ * Tree shape header: a profile of a built tree - how many nodes sit at each
+ * depth, how many leaves are empty, how points spread over leaves and how
+ * much memory the nodes, squares and points take - to guide the choice of
+ * bucket size and memory layout, and to catch degenerate deep chains.
+ */
+
+#include <stdio.h>
+#include <stddef.h>
+#include "qtree.h"
+
+#ifndef QTREE_SELF_IMPLEMENTATION_SHAPE_H
+#define QTREE_SELF_IMPLEMENTATION_SHAPE_H
+
+#define SHAPE_MAX_DEPTH 128  // depths beyond this are counted in the last bucket
+#define SHAPE_MAX_POINTS 8   // leaves with more points are counted in the last bucket
+
+// structures
+typedef struct tree_stats {
+    long nodes;
+    long leaves;
+    long empty_leaves;
+    long nodes_by_depth[SHAPE_MAX_DEPTH];
+    long leaf_depth_sum;
+    int max_leaf_depth;
+    long points;
+    long corners;
+    long points_per_leaf[SHAPE_MAX_POINTS+1];
+    size_t node_bytes;
+    size_t square_bytes;
+    size_t point_bytes;
+    double fragmentation;
+} tree_stats_t;
+
+// function prototypes
+void tree_stats(qtnode_t* tree, tree_stats_t* stats);
+void print_tree_stats(FILE* f, tree_stats_t* stats);
+
+#endif //QTREE_SELF_IMPLEMENTATION_SHAPE_H
@@ -0,0 +1,483 @@
+/*
+ * Shards and their coordinator (see shard.h). The shard map is a tree of
+ * the o.s split evenly down to the shards' depth, built with split() so
+ * that its squares, midpoints and (with QTREE_GRID) grid spans are exactly
+ * those of every footpath tree over the same o.s.
+ *
+ * The coordinator asks its shards one at a time and waits for each reply
+ * from within the server's event loop, so it is meant to sit next to its
+ * shards, where a reply takes far less than the query it answers. Which
+ * leaf a point falls in depends on every shard above the shards' depth:
+ * the leaf is the first node down the point's path with at most one
+ * location, so the coordinator learns at start how many locations (up to
+ * 2) each shard holds, and finds that node from their sums.
+ */
+
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <unistd.h>
+#include "shard.h"
+#include "server.h"
+#include "grid.h"
+
+// a location of a kNN reply, with the coordinates the shard holds it at;
+// its footpath entries, as the shard sent them, start at offset at of the
+// reply buffer, the first with the smallest id
+typedef struct candidate {
+    long double dist2;
+    point_t point;
+    uint32_t id;
+    size_t at;
+    uint32_t n;
+} candidate_t;
+
+// a footpath of a range reply; with PROTO_RECORDS, its record is length
+// bytes at offset at of the reply buffer, as tagged by the shard
+typedef struct found {
+    int id;
+    size_t at;
+    size_t length;
+} found_t;
+
+/* split a node of the map down to the shards' depth, numbering the shards
+ * below it from index
+ */
+void split_frame(shard_map_t* map, qtnode_t* node, int depth, int index);
+
+/* send a request to a shard and wait for its reply, reconnecting once if
+ * the shard was lost; returns the reply's payload, valid until the next
+ * request, or NULL if the shard cannot be reached
+ */
+const unsigned char* ask_shard(coordinator_t* coordinator, int shard, request_t* request,
+                               response_t* reply);
+
+/* the shard holding the leaf of the full tree the point falls in; -1 if
+ * that leaf holds no location
+ */
+int leaf_shard(coordinator_t* coordinator, point_t* query);
+
+/* answer a point, range or count, or kNN request from the shards,
+ * appending the payload; returns the reply's status
+ */
+int coordinate_point(coordinator_t* coordinator, request_t* request, bytes_t* out,
+                     uint32_t* count);
+int coordinate_range(coordinator_t* coordinator, request_t* request, bytes_t* out,
+                     uint32_t* count);
+int coordinate_knn(coordinator_t* coordinator, request_t* request, bytes_t* out,
+                   uint32_t* count);
+
+/* add the footpaths of a range reply, kept from offset at of buffer; 0 if
+ * the reply ends before its last record
+ */
+int add_found(found_t** found, int* n, int* capacity, bytes_t* buffer, size_t at,
+              uint32_t count, uint32_t length, int format);
+
+/* found footpath comparison by id, then by position, for qsort */
+int found_cmp(const void* a, const void* b);
+
+/* candidate comparison by distance, then by coordinates as in search_knn,
+ * then by first footpath id, for qsort
+ */
+int candidate_cmp(const void* a, const void* b);
+
+/* the o.s split level times over, into 4^level shards; the map owns the
+ * square from then on, as a tree does
+ */
+shard_map_t* init_shard_map(square_t* square, int level) {
+    assert(level >= 0 && level <= SHARD_MAX_LEVEL);
+    shard_map_t* map = (shard_map_t*) malloc(sizeof(shard_map_t));
+    assert(map);
+    map->frame = init_tree(square);
+    map->level = level;
+    map->nshards = 1 << (2 * level);
+    map->squares = (square_t**) malloc(sizeof(square_t*) * map->nshards);
+    assert(map->squares);
+    split_frame(map, map->frame, 0, 0);
+    return map;
+}
+
+/* split a node of the map down to the shards' depth, numbering the shards
+ * below it from index
+ */
+void split_frame(shard_map_t* map, qtnode_t* node, int depth, int index) {
+    if (depth == map->level) {
+        map->squares[index] = node->square;
+        return;
+    }
+    for (enum quadrant q = sw; q <= se; q++)
+        split_frame(map, split(node, q, map->frame->arena), depth+1, index * 4 + q);
+}
+
+/* the shard a point of the o.s belongs to */
+int shard_of(shard_map_t* map, point_t* point) {
+    qtnode_t* node = map->frame;
+    GRID_POINT(node->square, point);
+    int index = 0;
+    for (int depth = 0; depth < map->level; depth++) {
+        enum quadrant q = QUADRANT(node->square, point);
+        index = index * 4 + q;
+        node = get_child(node, q);
+    }
+    return index;
+}
+
+/* free a shard map along with its square; the square's corners belong to
+ * the caller
+ */
+void free_shard_map(shard_map_t* map) {
+    assert(map);
+    free_tree(map->frame);
+    free(map->squares);
+    free(map);
+}
+
+/* connect to the shard at each address, by index, waiting for shards that
+ * are still loading; NULL if one cannot be reached
+ */
+coordinator_t* init_coordinator(shard_map_t* map, char** addresses) {
+    coordinator_t* coordinator = (coordinator_t*) malloc(sizeof(coordinator_t));
+    assert(coordinator);
+    coordinator->map = map;
+    coordinator->addresses = addresses;
+    coordinator->fds = (int*) malloc(sizeof(int) * map->nshards);
+    coordinator->locations = (int*) malloc(sizeof(int) * map->nshards);
+    assert(coordinator->fds && coordinator->locations);
+    coordinator->in = (bytes_t) {NULL, 0, 0};
+    coordinator->out = (bytes_t) {NULL, 0, 0};
+    for (int i=0; i < map->nshards; i++) {
+        coordinator->fds[i] = connect_to(addresses[i]);
+        for (int tries = 1; coordinator->fds[i] < 0 && tries < SHARD_CONNECT_TRIES; tries++) {
+            usleep(SHARD_RETRY_USEC);
+            coordinator->fds[i] = connect_to(addresses[i]);
+        }
+    }
+    // the 2 locations nearest to the middle of the o.s tell whether a
+    // shard holds none, one, or more
+    square_t* square = map->frame->square;
+    request_t probe = {0, PROTO_KNN, PROTO_IDS | PROTO_BY_LOCATION, 2,
+                       (double) ((square->bottom_left->x + square->top_right->x) / 2),
+                       (double) ((square->bottom_left->y + square->top_right->y) / 2), 0, 0};
+    for (int i=0; i < map->nshards; i++) {
+        response_t reply;
+        if (coordinator->fds[i] < 0 || ask_shard(coordinator, i, &probe, &reply) == NULL ||
+            reply.status != PROTO_OK) {
+            fprintf(stderr, "Cannot reach shard %d at %s!\n", i, addresses[i]);
+            free_coordinator(coordinator);
+            return NULL;
+        }
+        coordinator->locations[i] = (int) reply.count;
+    }
+    return coordinator;
+}
+
+/* answer a request from the shards, as a server over the whole dataset would */
+void coordinator_handler(void* context, request_t* request, bytes_t* out) {
+    coordinator_t* coordinator = (coordinator_t*) context;
+    response_t response = {request->id, PROTO_OK, request->format, 0, 0};
+    size_t start = begin_response(out, &response);
+    uint32_t count = 0;
+    int status;
+    if (request->format != PROTO_IDS && request->format != PROTO_RECORDS)
+        status = PROTO_BAD_REQUEST;
+    else if (request->op == PROTO_POINT)
+        status = coordinate_point(coordinator, request, out, &count);
+    else if (request->op == PROTO_RANGE || request->op == PROTO_COUNT)
+        status = coordinate_range(coordinator, request, out, &count);
+    else if (request->op == PROTO_KNN && request->k <= SERVER_MAX_K)
+        status = coordinate_knn(coordinator, request, out, &count);
+    else status = PROTO_BAD_REQUEST;
+    if (status != PROTO_OK) {
+        // whatever was gathered is dropped for an empty reply
+        out->length = start;
+        response.status = (uint8_t) status;
+        start = begin_response(out, &response);
+        count = 0;
+    }
+    end_response(out, start, count);
+}
+
+/* send a request to a shard and wait for its reply, reconnecting once if
+ * the shard was lost; returns the reply's payload, valid until the next
+ * request, or NULL if the shard cannot be reached
+ */
+const unsigned char* ask_shard(coordinator_t* coordinator, int shard, request_t* request,
+                               response_t* reply) {
+    int* fd = &coordinator->fds[shard];
+    if (*fd < 0) *fd = connect_to(coordinator->addresses[shard]);
+    if (*fd < 0) return NULL;
+    coordinator->out.length = 0;
+    coordinator->in.length = 0;
+    encode_request(&coordinator->out, request);
+    int length;
+    if (send_all(*fd, coordinator->out.data, coordinator->out.length) < 0 ||
+        (length = recv_frame(*fd, &coordinator->in)) < 0 ||
+        !decode_response(coordinator->in.data + 4, (uint32_t) length, reply)) {
+        close(*fd);
+        *fd = -1;
+        return NULL;
+    }
+    return coordinator->in.data + 4 + PROTO_RESPONSE_LEN;
+}
+
+/* the shard holding the leaf of the full tree the point falls in; -1 if
+ * that leaf holds no location
+ */
+int leaf_shard(coordinator_t* coordinator, point_t* query) {
+    shard_map_t* map = coordinator->map;
+    qtnode_t* node = map->frame;
+    GRID_POINT(node->square, query);
+    // the shards below a node of depth d are a run of 4^(level-d) indices
+    int prefix = 0, span = map->nshards;
+    for (int depth = 0; ; depth++) {
+        int total = 0, last = -1;
+        for (int i = prefix * span; i < (prefix + 1) * span; i++) {
+            if (coordinator->locations[i] == 0) continue;
+            total += coordinator->locations[i];
+            last = i;
+        }
+        if (total <= 1 || depth == map->level) return last;
+        enum quadrant q = QUADRANT(node->square, query);
+        prefix = prefix * 4 + q;
+        span /= 4;
+        node = get_child(node, q);
+    }
+}
+
+/* answer a point request from the shard holding the point's leaf */
+int coordinate_point(coordinator_t* coordinator, request_t* request, bytes_t* out,
+                     uint32_t* count) {
+    point_t query = {.x = request->x1, .y = request->y1};
+    if (!in_sq(coordinator->map->frame->square, &query)) return PROTO_OK;
+    int shard = leaf_shard(coordinator, &query);
+    if (shard < 0) return PROTO_OK;
+    response_t reply;
+    const unsigned char* payload = ask_shard(coordinator, shard, request, &reply);
+    if (payload == NULL) return PROTO_UNAVAILABLE;
+    bytes_append(out, payload, reply.payload_len);
+    *count = reply.count;
+    return reply.status;
+}
+
+/* answer a range or count request from every shard the window overlaps;
+ * a footpath with its ends in 2 shards is reported by both, and kept once
+ */
+int coordinate_range(coordinator_t* coordinator, request_t* request, bytes_t* out,
+                     uint32_t* count) {
+    point_t p1 = {.x = request->x1, .y = request->y1}, p2 = {.x = request->x2, .y = request->y2};
+    square_t window = {.bottom_left = &p1, .top_right = &p2};
+    request_t ask = *request;
+    if (ask.op == PROTO_COUNT) {
+        // a count is only known once repeats are dropped
+        ask.op = PROTO_RANGE;
+        ask.format = PROTO_IDS;
+    }
+    // records come with their ids, to merge on
+    if (ask.format == PROTO_RECORDS) ask.format |= PROTO_TAGGED;
+    bytes_t kept = {NULL, 0, 0};
+    found_t* found = NULL;
+    int n = 0, capacity = 0, status = PROTO_OK;
+    for (int i=0; i < coordinator->map->nshards && status == PROTO_OK; i++) {
+        if (coordinator->locations[i] == 0 ||
+            square_dist2(coordinator->map->squares[i], &window) > 0)
+            continue;
+        response_t reply;
+        const unsigned char* payload = ask_shard(coordinator, i, &ask, &reply);
+        if (payload == NULL) {
+            status = PROTO_UNAVAILABLE;
+            break;
+        }
+        status = reply.status;
+        size_t at = kept.length;
+        bytes_append(&kept, payload, reply.payload_len);
+        if (!add_found(&found, &n, &capacity, &kept, at, reply.count, reply.payload_len,
+                       ask.format))
+            status = PROTO_UNAVAILABLE;
+    }
+    if (n > 0) qsort(found, n, sizeof(found_t), found_cmp);
+    for (int i=0; i < n && status == PROTO_OK; i++) {
+        if (i > 0 && found[i].id == found[i-1].id) continue;
+        (*count)++;
+        if (request->op == PROTO_COUNT) continue;
+        if (ask.format & PROTO_RECORDS) {
+            bytes_append(out, kept.data + found[i].at, found[i].length);
+            continue;
+        }
+        unsigned char id[4];
+        put_u32(id, (uint32_t) found[i].id);
+        bytes_append(out, id, sizeof(id));
+    }
+    free(found);
+    free(kept.data);
+    return status;
+}
+
+/* add the footpaths of a range reply, kept from offset at of buffer; 0 if
+ * the reply ends before its last record
+ */
+int add_found(found_t** found, int* n, int* capacity, bytes_t* buffer, size_t at,
+              uint32_t count, uint32_t length, int format) {
+    size_t end = at + length;
+    if (format == PROTO_IDS && 4 * (size_t) count > length) return 0;
+    for (uint32_t i=0; i < count; i++) {
+        if (*n == *capacity) {
+            *capacity = *capacity ? *capacity * 2 : 64;
+            *found = (found_t*) realloc(*found, sizeof(found_t) * *capacity);
+            assert(*found);
+        }
+        found_t* footpath = &(*found)[(*n)++];
+        if (format == PROTO_IDS) {
+            footpath->id = (int) get_u32(buffer->data + at + 4 * (size_t) i);
+            footpath->at = footpath->length = 0;
+            continue;
+        }
+        // a tagged record: its id, its length, then its text
+        if (at + 8 > end) return 0;
+        footpath->id = (int) get_u32(buffer->data + at);
+        footpath->length = get_u32(buffer->data + at + 4);
+        footpath->at = at + 8;
+        if (footpath->length > end - footpath->at) return 0;
+        at = footpath->at + footpath->length;
+    }
+    return 1;
+}
+
+/* answer a kNN request from the shards nearest to the query first, asking
+ * each for its own k nearest locations, until no shard left could hold a
+ * location nearer than the k-th found
+ */
+int coordinate_knn(coordinator_t* coordinator, request_t* request, bytes_t* out,
+                   uint32_t* count) {
+    shard_map_t* map = coordinator->map;
+    point_t query = {.x = request->x1, .y = request->y1};
+    int k = (int) request->k;
+    if (k == 0) return PROTO_OK;
+    // the shards holding any location, nearest first
+    int* order = (int*) malloc(sizeof(int) * map->nshards);
+    long double* dist2 = (long double*) malloc(sizeof(long double) * map->nshards);
+    assert(order && dist2);
+    int nshards = 0;
+    for (int i=0; i < map->nshards; i++) {
+        if (coordinator->locations[i] == 0) continue;
+        long double d = point_square_dist2(&query, map->squares[i]);
+        int j = nshards++;
+        for (; j > 0 && dist2[j-1] > d; j--) {
+            order[j] = order[j-1];
+            dist2[j] = dist2[j-1];
+        }
+        order[j] = i;
+        dist2[j] = d;
+    }
+    request_t ask = *request;
+    ask.format |= PROTO_BY_LOCATION;
+    bytes_t kept = {NULL, 0, 0};
+    candidate_t* candidates = (candidate_t*) malloc(sizeof(candidate_t) * 2 * k);
+    assert(candidates);
+    int ncandidates = 0, status = PROTO_OK;
+    for (int s=0; s < nshards && status == PROTO_OK; s++) {
+        // a shard as near as the k-th may still hold a location tied with
+        // it and ordered before it
+        if (ncandidates == k && dist2[s] > candidates[k-1].dist2) break;
+        response_t reply;
+        const unsigned char* payload = ask_shard(coordinator, order[s], &ask, &reply);
+        if (payload == NULL) {
+            status = PROTO_UNAVAILABLE;
+            break;
+        }
+        status = reply.status;
+        size_t base = kept.length, at = 0;
+        bytes_append(&kept, payload, reply.payload_len);
+        for (uint32_t i=0; i < reply.count && i < (uint32_t) k; i++) {
+            // the shard's own coordinates, so distances and ties are its own
+            const unsigned char* location = kept.data + base + at;
+            candidate_t* candidate = &candidates[ncandidates++];
+            candidate->point = (point_t) {
+                .x = (long double) get_f64(location) + get_f64(location + 16),
+                .y = (long double) get_f64(location + 8) + get_f64(location + 24)};
+            candidate->dist2 = point_dist2(&query, &candidate->point);
+            candidate->n = get_u32(location + 32);
+            at += PROTO_LOCATION_LEN;
+            candidate->at = base + at;
+            candidate->id = candidate->n ? get_u32(kept.data + candidate->at) : 0;
+            for (uint32_t j=0; j < candidate->n; j++)
+                at += 4 + ((ask.format & PROTO_RECORDS) ? 4 + get_u32(kept.data + base + at + 4)
+                                                        : 0);
+        }
+        // the k nearest so far stay, in order
+        qsort(candidates, ncandidates, sizeof(candidate_t), candidate_cmp);
+        if (ncandidates > k) ncandidates = k;
+    }
+    // footpaths of each location in turn, each only the first time it is met
+    int* emitted = NULL;
+    int nemitted = 0, capacity = 0;
+    for (int i=0; i < ncandidates && status == PROTO_OK; i++) {
+        size_t at = candidates[i].at;
+        for (uint32_t j=0; j < candidates[i].n; j++) {
+            int id = (int) get_u32(kept.data + at);
+            uint32_t length = (ask.format & PROTO_RECORDS) ? get_u32(kept.data + at + 4) : 0;
+            const unsigned char* record = kept.data + at + 8;
+            at += 4 + ((ask.format & PROTO_RECORDS) ? 4 + length : 0);
+            int seen = 0;
+            for (int m=0; m < nemitted && !seen; m++)
+                seen = emitted[m] == id;
+            if (seen) continue;
+            if (nemitted == capacity) {
+                capacity = capacity ? capacity * 2 : 64;
+                emitted = (int*) realloc(emitted, sizeof(int) * capacity);
+                assert(emitted);
+            }
+            emitted[nemitted++] = id;
+            if (request->format == PROTO_RECORDS) {
+                bytes_append(out, record, length);
+                continue;
+            }
+            unsigned char bytes[4];
+            put_u32(bytes, (uint32_t) id);
+            bytes_append(out, bytes, sizeof(bytes));
+        }
+    }
+    *count = (uint32_t) nemitted;
+    free(emitted);
+    free(candidates);
+    free(kept.data);
+    free(order);
+    free(dist2);
+    return status;
+}
+
+/* found footpath comparison by id, then by position, for qsort */
+int found_cmp(const void* a, const void* b) {
+    const found_t* f1 = (const found_t*) a;
+    const found_t* f2 = (const found_t*) b;
+    if (f1->id != f2->id) return (f1->id > f2->id) - (f1->id < f2->id);
+    return (f1->at > f2->at) - (f1->at < f2->at);
+}
+
+/* candidate comparison by distance, then by coordinates as in search_knn,
+ * then by first footpath id, for qsort
+ */
+int candidate_cmp(const void* a, const void* b) {
+    const candidate_t* c1 = (const candidate_t*) a;
+    const candidate_t* c2 = (const candidate_t*) b;
+    if (c1->dist2 != c2->dist2) return (c1->dist2 > c2->dist2) - (c1->dist2 < c2->dist2);
+    const point_t *p1 = &c1->point, *p2 = &c2->point;
+    if (p1->x != p2->x) return (p1->x > p2->x) - (p1->x < p2->x);
+    if (p1->y != p2->y) return (p1->y > p2->y) - (p1->y < p2->y);
+    return (c1->id > c2->id) - (c1->id < c2->id);
+}
+
+/* close every connection and free the coordinator; the map belongs to the
+ * caller
+ */
+void free_coordinator(coordinator_t* coordinator) {
+    assert(coordinator);
+    for (int i=0; i < coordinator->map->nshards; i++)
+        if (coordinator->fds[i] >= 0) close(coordinator->fds[i]);
+    free(coordinator->fds);
+    free(coordinator->locations);
+    free(coordinator->in.data);
+    free(coordinator->out.data);
+    free(coordinator);
+}
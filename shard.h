@@ -0,0 +1,59 @@
+/*
+ * Shard header: the o.s split evenly into 4^level shards, each a quadrant
+ * of the tree at that depth, so that a dataset too large for one process
+ * is served by one query server per shard (see server.h). A shard's tree
+ * covers the whole o.s but holds only the locations falling in its own
+ * square, which keeps every node below the shard's square exactly as in
+ * the tree of the full dataset. Shard index digits are quadrants, the most
+ * significant one picked at the root.
+ *
+ * A coordinator speaks the same protocol to clients and answers each
+ * request from the shards: a point query goes to the shard holding the
+ * leaf the point falls in, range and count queries to every shard the
+ * window overlaps, and kNN queries to the nearest shards until none can
+ * hold a nearer location. Replies are merged into what a single server
+ * over the whole dataset would send: shards give each kNN location with
+ * its exact coordinates, so distances and the order of locations tied in
+ * distance (by x, then y, as search_knn orders them) are the server's own.
+ */
+
+#include "qtree.h"
+#include "proto.h"
+
+#ifndef QTREE_SELF_IMPLEMENTATION_SHARD_H
+#define QTREE_SELF_IMPLEMENTATION_SHARD_H
+
+#define SHARD_MAX_LEVEL 4            // deepest split into shards, 256 of them
+#define SHARD_CONNECT_TRIES 300      // attempts to reach a shard still loading
+#define SHARD_RETRY_USEC 100000      // wait between attempts, in microseconds
+
+// structures
+
+// the o.s split level times over; squares holds each shard's square by index
+typedef struct shard_map {
+    qtnode_t* frame;
+    int level;
+    int nshards;
+    square_t** squares;
+} shard_map_t;
+
+// a coordinator's connection to each shard (-1 when lost), and how many
+// locations each shard holds, counted up to 2
+typedef struct coordinator {
+    shard_map_t* map;
+    char** addresses;
+    int* fds;
+    int* locations;
+    bytes_t in;
+    bytes_t out;
+} coordinator_t;
+
+// function prototypes
+shard_map_t* init_shard_map(square_t* square, int level);
+int shard_of(shard_map_t* map, point_t* point);
+void free_shard_map(shard_map_t* map);
+coordinator_t* init_coordinator(shard_map_t* map, char** addresses);
+void coordinator_handler(void* coordinator, request_t* request, bytes_t* out);
+void free_coordinator(coordinator_t* coordinator);
+
+#endif //QTREE_SELF_IMPLEMENTATION_SHARD_H
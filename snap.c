@@ -0,0 +1,143 @@
+/*
+ * Nearest-segment search over a segment index. A node's square bounds the
+ * distance to every segment stored below it (segments are assumed to lie
+ * within the outer square), so nodes are visited nearest square first and
+ * any node further than the best segment so far is skipped.
+ * Consecutive fixes of a trace are close together, so each search is warm
+ * started from the leaf the previous fix's segment was found in: its
+ * segments give a tight bound, and the descent then starts from the lowest
+ * ancestor of that leaf holding every segment within the bound, rather
+ * than from the root.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <assert.h>
+#include "snap.h"
+
+// state of a nearest-segment search, carried from one fix to the next:
+// leaf is where the best segment so far was found, path the nodes from the
+// root down to it and stack those of the descent under way, by depth
+typedef struct snap_ctx {
+    seg_tree_t* tree;
+    point_t* point;
+    long double best;
+    snap_t* result;
+    seg_node_t* leaf;
+    seg_node_t* path[SEG_MAX_DEPTH+1];
+    seg_node_t* stack[SEG_MAX_DEPTH+1];
+} snap_ctx_t;
+
+/* nearest-segment search below node */
+void snap_node(snap_ctx_t* ctx, seg_node_t* node);
+
+/* the node a warm started search descends from */
+seg_node_t* snap_start(snap_ctx_t* ctx);
+
+/* check every segment of a leaf against the best so far */
+void snap_leaf(snap_ctx_t* ctx, seg_node_t* leaf);
+
+
+/* snap each of the n points to its nearest segment, in order; out must hold
+ * n results. Points that are sorted along a trace are the cheapest to snap
+ */
+void snap_batch(seg_tree_t* tree, point_t** points, int n, snap_t* out) {
+    assert(tree); assert(points || n <= 0); assert(out || n <= 0);
+    snap_ctx_t ctx;
+    ctx.tree = tree;
+    ctx.leaf = NULL;
+    for (int i=0; i < n; i++) {
+        ctx.point = points[i];
+        ctx.best = -1;
+        ctx.result = &out[i];
+        out[i].id = -1;
+        out[i].dist = -1;
+        seg_node_t* start = tree->root;
+        // warm start: bound the search with the previous fix's leaf
+        if (ctx.leaf != NULL) {
+            memcpy(ctx.stack, ctx.path, sizeof(seg_node_t*) * (ctx.leaf->depth + 1));
+            snap_leaf(&ctx, ctx.leaf);
+            start = snap_start(&ctx);
+        }
+        snap_node(&ctx, start);
+        if (out[i].id >= 0) out[i].dist = sqrtl(ctx.best);
+    }
+}
+
+/* the lowest node on the path to the warm start leaf whose square holds
+ * the whole disc of the best distance around the point: every nearer
+ * segment passes through the disc, so it is stored below that node. The
+ * root, if no lower node holds the disc
+ */
+seg_node_t* snap_start(snap_ctx_t* ctx) {
+    long double x = ctx->point->x, y = ctx->point->y;
+    for (int d = ctx->leaf->depth; d > 0; d--) {
+        square_t* square = ctx->path[d]->square;
+        long double margin = x - square->bottom_left->x;
+        if (square->top_right->x - x < margin) margin = square->top_right->x - x;
+        if (y - square->bottom_left->y < margin) margin = y - square->bottom_left->y;
+        if (square->top_right->y - y < margin) margin = square->top_right->y - y;
+        if (margin >= 0 && margin*margin >= ctx->best) return ctx->path[d];
+    }
+    return ctx->tree->root;
+}
+
+/* nearest-segment search below node, nearest child first */
+void snap_node(snap_ctx_t* ctx, seg_node_t* node) {
+    ctx->stack[node->depth] = node;
+    // base case - leaf node
+    if (node->nw == NULL) {
+        if (node != ctx->leaf) snap_leaf(ctx, node);
+        return;
+    }
+    seg_node_t* children[4] = {node->nw, node->ne, node->sw, node->se};
+    long double dist[4];
+    for (int c=0; c < 4; c++)
+        dist[c] = point_square_dist2(ctx->point, children[c]->square);
+    // sort the 4 children by distance
+    for (int c=1; c < 4; c++) {
+        for (int j=c; j > 0 && dist[j-1] > dist[j]; j--) {
+            long double d = dist[j]; dist[j] = dist[j-1]; dist[j-1] = d;
+            seg_node_t* s = children[j]; children[j] = children[j-1]; children[j-1] = s;
+        }
+    }
+    for (int c=0; c < 4; c++) {
+        if (ctx->best >= 0 && dist[c] > ctx->best) break;
+        snap_node(ctx, children[c]);
+    }
+}
+
+/* check every segment of a leaf */
+void snap_leaf(snap_ctx_t* ctx, seg_node_t* leaf) {
+    point_t at;
+    for (int i=0; i < leaf->count; i++) {
+        int id = leaf->ids[i];
+        segment_t* seg = &ctx->tree->segments[id];
+        long double dist = point_segment_dist2(ctx->point, seg->start, seg->end, &at);
+        if (ctx->best < 0 || dist < ctx->best) {
+            ctx->best = dist;
+            if (leaf != ctx->leaf)
+                memcpy(ctx->path, ctx->stack, sizeof(seg_node_t*) * (leaf->depth + 1));
+            ctx->leaf = leaf;
+            ctx->result->id = id;
+            ctx->result->at = at;
+        }
+    }
+}
+
+/* squared distance from point to the segment p1-p2; the nearest location on
+ * the segment is written to at, if not NULL
+ */
+long double point_segment_dist2(point_t* point, point_t* p1, point_t* p2, point_t* at) {
+    long double dx = p2->x - p1->x, dy = p2->y - p1->y;
+    long double len2 = dx*dx + dy*dy, t = 0;
+    // project onto the segment, clamped to its end points
+    if (len2 > 0) {
+        t = ((point->x - p1->x)*dx + (point->y - p1->y)*dy) / len2;
+        t = (t < 0) ? 0 : (t > 1) ? 1 : t;
+    }
+    point_t nearest = {.x = p1->x + t*dx, .y = p1->y + t*dy};
+    if (at != NULL) *at = nearest;
+    return point_dist2(point, &nearest);
+}
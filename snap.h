@@ -0,0 +1,23 @@
+/*
+ * Snapping header: matches each fix of a (GPS) trace to its nearest
+ * segment of a segment index (see segment.h), by perpendicular distance
+ * to the segment rather than distance to its end points.
+ */
+
+#include "segment.h"
+
+#ifndef QTREE_SELF_IMPLEMENTATION_SNAP_H
+#define QTREE_SELF_IMPLEMENTATION_SNAP_H
+
+// result of snapping a single fix
+typedef struct snap {
+    int id;            // nearest segment's id; -1 if the tree has no segment
+    long double dist;  // distance from the fix to that segment
+    point_t at;        // nearest location on that segment
+} snap_t;
+
+// function prototypes
+void snap_batch(seg_tree_t* tree, point_t** points, int n, snap_t* out);
+long double point_segment_dist2(point_t* point, point_t* p1, point_t* p2, point_t* at);
+
+#endif //QTREE_SELF_IMPLEMENTATION_SNAP_H
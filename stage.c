@@ -0,0 +1,327 @@
+/*
+ * Stage 3 and 4 queries over a footpath dataset. A point query walks
+ * down to the leaf holding the query and reports the footpaths of the
+ * location stored there; a range query reports every footpath with an
+ * end inside the rectangle, in order of footpath_id and without repeats.
+ * Both print the quadrants they enter, in the order SW, NW, NE, SE; those
+ * are kept as 2-bit codes (see path.h) and only rendered once a query ends.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "stage.h"
+#include "grid.h"
+#include "path.h"
+#include "knn.h"
+
+// footpaths found by a query, and the codes of the quadrants it entered
+typedef struct results {
+    footpath_t** footpaths;
+    int length;
+    int capacity;
+    unsigned char* codes;
+    int ncodes;
+    int code_capacity;
+} results_t;
+
+/* the location of a footpath's end point, creating it if there is none */
+location_t* find_location(qtnode_t* tree, long double x, long double y);
+
+/* the location of a footpath's end point as find_location, or NULL if it
+ * belongs to a shard other than the one the tree is built for
+ */
+location_t* shard_location(qtnode_t* tree, shard_map_t* map, int shard,
+                           long double x, long double y);
+
+/* collect every footpath stored at a location */
+void add_location(results_t* results, location_t* location);
+
+/* recursively collect footpaths within range, and every quadrant entered */
+void range_query_level(qtnode_t* tree, square_t* rectangle, results_t* results);
+
+/* record a quadrant a query enters */
+void add_code(results_t* results, enum quadrant q);
+
+/* sort the collected footpaths by id, print them once each and empty the buffer */
+void print_results(results_t* results, FILE* out);
+
+/* sort the collected footpaths by id, dropping repeats */
+void sort_results(results_t* results);
+
+/* the leaf the query falls in, recording the quadrants entered on the way;
+ * NULL if there is none
+ */
+qtnode_t* query_leaf(qtnode_t* tree, point_t* query, results_t* results);
+
+/* collect the footpaths with an end within the rectangle, and every
+ * quadrant entered
+ */
+void collect_range(qtnode_t* tree, square_t* rectangle, results_t* results);
+
+/* footpath comparison by id, for qsort */
+int footpath_cmp(const void* a, const void* b);
+
+/* build a tree from footpaths, storing each at both its start and end */
+qtnode_t* footpath_tree(footpath_t** fps, int n, square_t* square) {
+    return footpath_shard_tree(fps, n, square, NULL, 0);
+}
+
+/* build a tree from footpaths as footpath_tree, keeping only the locations
+ * of one shard of a map (see shard.h); every location when map is NULL
+ */
+qtnode_t* footpath_shard_tree(footpath_t** fps, int n, square_t* square,
+                              shard_map_t* map, int shard) {
+    qtnode_t* tree = init_tree(square);
+    for (int i = 0; i < n; i++) {
+        location_t* ends[2];
+        ends[0] = shard_location(tree, map, shard, fps[i]->start_lon, fps[i]->start_lat);
+        ends[1] = shard_location(tree, map, shard, fps[i]->end_lon, fps[i]->end_lat);
+        for (int j = 0; j < 2; j++) {
+            if (ends[j] == NULL) continue;
+            fp_list_t* node = (fp_list_t*) arena_alloc(tree->arena, sizeof(fp_list_t));
+            node->footpath = fps[i];
+            node->next = ends[j]->footpaths;
+            ends[j]->footpaths = node;
+        }
+    }
+    return tree;
+}
+
+/* the location of a footpath's end point, creating it if there is none;
+ * NULL if the point lies outside the tree
+ */
+location_t* find_location(qtnode_t* tree, long double x, long double y) {
+    point_t probe = {.x = x, .y = y};
+    if (!in_sq(tree->square, &probe))
+        return NULL;
+    location_t* location = (location_t*) find_pt(tree, &probe);
+    if (location != NULL)
+        return location;
+    location = (location_t*) arena_alloc(tree->arena, sizeof(location_t));
+    location->point = probe;
+    location->footpaths = NULL;
+    insert(tree, &location->point);
+    return location;
+}
+
+/* the location of a footpath's end point as find_location, or NULL if it
+ * belongs to a shard other than the one the tree is built for
+ */
+location_t* shard_location(qtnode_t* tree, shard_map_t* map, int shard,
+                           long double x, long double y) {
+    point_t probe = {.x = x, .y = y};
+    if (map != NULL && (!in_sq(tree->square, &probe) || shard_of(map, &probe) != shard))
+        return NULL;
+    return find_location(tree, x, y);
+}
+
+/* answer every query line of in, returning the number of queries answered */
+int stage_query(qtnode_t* tree, int stage, FILE* in, FILE* out, FILE* path) {
+    assert(stage == STAGE_POINT || stage == STAGE_RANGE);
+    char line[MAX_QUERY_LEN];
+    int count = 0;
+    while (fgets(line, MAX_QUERY_LEN, in) != NULL) {
+        line[strcspn(line, "\r\n")] = '\0';
+        point_t p1 = {.x = 0, .y = 0}, p2 = {.x = 0, .y = 0};
+        int read = sscanf(line, "%Lf %Lf %Lf %Lf", &p1.x, &p1.y, &p2.x, &p2.y);
+        if (read < 2 || (stage == STAGE_RANGE && read < 4))
+            continue;
+        fprintf(out, "%s\n", line);
+        fprintf(path, "%s -->", line);
+        if (stage == STAGE_POINT)
+            point_query(tree, &p1, out, path);
+        else {
+            square_t rectangle = {.bottom_left = &p1, .top_right = &p2};
+            range_query(tree, &rectangle, out, path);
+        }
+        fprintf(path, "\n");
+        count++;
+    }
+    return count;
+}
+
+/* print the footpaths at the leaf the query falls in */
+void point_query(qtnode_t* tree, point_t* query, FILE* out, FILE* path) {
+    if (!in_sq(tree->square, query))
+        return;
+    results_t results = {NULL, 0, 0, NULL, 0, 0};
+    tree = query_leaf(tree, query, &results);
+    print_codes(path, results.codes, results.ncodes);
+    if (tree != NULL && tree->point != NULL) {
+        add_location(&results, (location_t*) tree->point);
+        print_results(&results, out);
+    }
+    free(results.footpaths);
+    free(results.codes);
+}
+
+/* print the footpaths with an end within the rectangle */
+void range_query(qtnode_t* tree, square_t* rectangle, FILE* out, FILE* path) {
+    results_t results = {NULL, 0, 0, NULL, 0, 0};
+    collect_range(tree, rectangle, &results);
+    print_codes(path, results.codes, results.ncodes);
+    print_results(&results, out);
+    free(results.footpaths);
+    free(results.codes);
+}
+
+/* the footpaths point_query prints, sorted by id, without printing; they
+ * are set to a new array the caller frees, and their number is returned
+ */
+int point_footpaths(qtnode_t* tree, point_t* query, footpath_t*** footpaths) {
+    results_t results = {NULL, 0, 0, NULL, 0, 0};
+    if (in_sq(tree->square, query)) {
+        tree = query_leaf(tree, query, &results);
+        if (tree != NULL && tree->point != NULL)
+            add_location(&results, (location_t*) tree->point);
+    }
+    free(results.codes);
+    sort_results(&results);
+    *footpaths = results.footpaths;
+    return results.length;
+}
+
+/* the footpaths range_query prints, sorted by id, without printing; they
+ * are set to a new array the caller frees, and their number is returned
+ */
+int range_footpaths(qtnode_t* tree, square_t* rectangle, footpath_t*** footpaths) {
+    results_t results = {NULL, 0, 0, NULL, 0, 0};
+    collect_range(tree, rectangle, &results);
+    free(results.codes);
+    sort_results(&results);
+    *footpaths = results.footpaths;
+    return results.length;
+}
+
+/* the footpaths at the k locations nearest to the query, nearest first and
+ * by id within a location, each only the first time it is met; they are
+ * set to a new array the caller frees, and their number is returned
+ */
+int knn_footpaths(qtnode_t* tree, point_t* query, int k, footpath_t*** footpaths) {
+    results_t results = {NULL, 0, 0, NULL, 0, 0};
+    point_t** nearest = (point_t**) malloc(sizeof(point_t*) * (k > 0 ? k : 1));
+    assert(nearest);
+    int found = search_knn(tree, query, k, NULL, nearest);
+    for (int i=0; i < found; i++) {
+        // each location's own footpaths are sorted before joining the rest
+        footpath_t** own;
+        int nown = location_footpaths((location_t*) nearest[i], &own);
+        for (int j=0; j < nown; j++) {
+            int seen = 0;
+            for (int m=0; m < results.length && !seen; m++)
+                seen = results.footpaths[m] == own[j];
+            if (seen) continue;
+            if (results.length == results.capacity) {
+                results.capacity = (results.capacity) ? results.capacity * 2 : STAGE_INIT_CAP;
+                results.footpaths = (footpath_t**) realloc(results.footpaths,
+                                                           sizeof(footpath_t*) * results.capacity);
+                assert(results.footpaths);
+            }
+            results.footpaths[results.length++] = own[j];
+        }
+        free(own);
+    }
+    free(nearest);
+    *footpaths = results.footpaths;
+    return results.length;
+}
+
+/* the footpaths stored at a location, sorted by id; they are set to a new
+ * array the caller frees, and their number is returned
+ */
+int location_footpaths(location_t* location, footpath_t*** footpaths) {
+    results_t results = {NULL, 0, 0, NULL, 0, 0};
+    add_location(&results, location);
+    sort_results(&results);
+    *footpaths = results.footpaths;
+    return results.length;
+}
+
+/* the leaf the query falls in, recording the quadrants entered on the way;
+ * NULL if there is none
+ */
+qtnode_t* query_leaf(qtnode_t* tree, point_t* query, results_t* results) {
+    GRID_POINT(tree->square, query);
+    while (tree != NULL && !IS_LEAF(tree)) {
+        enum quadrant q = QUADRANT(tree->square, query);
+        add_code(results, q);
+        tree = get_child(tree, q);
+    }
+    return tree;
+}
+
+/* collect the footpaths with an end within the rectangle, and every
+ * quadrant entered
+ */
+void collect_range(qtnode_t* tree, square_t* rectangle, results_t* results) {
+    if (IS_LEAF(tree)) {
+        if (tree->point != NULL && in_sq(rectangle, tree->point))
+            add_location(results, (location_t*) tree->point);
+    }
+    else range_query_level(tree, rectangle, results);
+}
+
+/* recursively collect footpaths within range, and every quadrant entered */
+void range_query_level(qtnode_t* tree, square_t* rectangle, results_t* results) {
+    for (enum quadrant q = sw; q <= se; q++) {
+        qtnode_t* child = get_child(tree, q);
+        if (child == NULL || square_dist2(child->square, rectangle) > 0)
+            continue;
+        add_code(results, q);
+        if (!IS_LEAF(child))
+            range_query_level(child, rectangle, results);
+        else if (child->point != NULL && in_sq(rectangle, child->point))
+            add_location(results, (location_t*) child->point);
+    }
+}
+
+/* collect every footpath stored at a location */
+void add_location(results_t* results, location_t* location) {
+    for (fp_list_t* node = location->footpaths; node != NULL; node = node->next) {
+        if (results->length == results->capacity) {
+            results->capacity = (results->capacity) ? results->capacity * 2 : STAGE_INIT_CAP;
+            results->footpaths = (footpath_t**) realloc(results->footpaths,
+                                                        sizeof(footpath_t*) * results->capacity);
+            assert(results->footpaths);
+        }
+        results->footpaths[results->length++] = node->footpath;
+    }
+}
+
+/* record a quadrant a query enters */
+void add_code(results_t* results, enum quadrant q) {
+    if (results->ncodes == results->code_capacity) {
+        results->code_capacity = (results->code_capacity) ? results->code_capacity * 2
+                                                           : STAGE_INIT_CAP;
+        results->codes = (unsigned char*) realloc(results->codes, results->code_capacity);
+        assert(results->codes);
+    }
+    results->codes[results->ncodes++] = PATH_CODE(q);
+}
+
+/* sort the collected footpaths by id, print them once each and empty the buffer */
+void print_results(results_t* results, FILE* out) {
+    sort_results(results);
+    for (int i = 0; i < results->length; i++)
+        print_footpath(out, results->footpaths[i]);
+    results->length = 0;
+}
+
+/* sort the collected footpaths by id, dropping repeats */
+void sort_results(results_t* results) {
+    if (results->length == 0) return;
+    qsort(results->footpaths, results->length, sizeof(footpath_t*), footpath_cmp);
+    int kept = 1;
+    for (int i = 1; i < results->length; i++)
+        if (results->footpaths[i]->footpath_id != results->footpaths[kept-1]->footpath_id)
+            results->footpaths[kept++] = results->footpaths[i];
+    results->length = kept;
+}
+
+/* footpath comparison by id, for qsort */
+int footpath_cmp(const void* a, const void* b) {
+    int id1 = (*(footpath_t**) a)->footpath_id;
+    int id2 = (*(footpath_t**) b)->footpath_id;
+    return (id1 > id2) - (id1 < id2);
+}
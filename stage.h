@@ -0,0 +1,49 @@
+/*
+ * Stage header: the point (stage 3) and range (stage 4) queries over a
+ * footpath dataset. Every footpath is stored at both its start and end
+ * locations; a query writes the footpaths it finds to one stream and the
+ * quadrants it walks through (e.g. "SW NE") to another. The *_footpaths
+ * variants return the same footpaths instead, for the query server. A
+ * tree may also hold only the locations of one shard (see shard.h).
+ */
+
+#include <stdio.h>
+#include "qtree.h"
+#include "footpath.h"
+#include "shard.h"
+
+#ifndef QTREE_SELF_IMPLEMENTATION_STAGE_H
+#define QTREE_SELF_IMPLEMENTATION_STAGE_H
+
+#define STAGE_POINT 3        // stage of point queries, "x y" per line
+#define STAGE_RANGE 4        // stage of range queries, "x1 y1 x2 y2" per line
+#define MAX_QUERY_LEN 256    // maximum length of a query line
+#define STAGE_INIT_CAP 64    // initial capacity of a query's result buffer
+
+// structures
+typedef struct fp_list fp_list_t;
+struct fp_list {
+    footpath_t* footpath;
+    fp_list_t* next;
+};
+
+// a location in the tree, with every footpath starting or ending there;
+// the point comes first so the tree's stored point_t* is the location itself
+typedef struct location {
+    point_t point;
+    fp_list_t* footpaths;
+} location_t;
+
+// function prototypes
+qtnode_t* footpath_tree(footpath_t** fps, int n, square_t* square);
+qtnode_t* footpath_shard_tree(footpath_t** fps, int n, square_t* square,
+                              shard_map_t* map, int shard);
+int stage_query(qtnode_t* tree, int stage, FILE* in, FILE* out, FILE* path);
+void point_query(qtnode_t* tree, point_t* query, FILE* out, FILE* path);
+void range_query(qtnode_t* tree, square_t* rectangle, FILE* out, FILE* path);
+int point_footpaths(qtnode_t* tree, point_t* query, footpath_t*** footpaths);
+int range_footpaths(qtnode_t* tree, square_t* rectangle, footpath_t*** footpaths);
+int knn_footpaths(qtnode_t* tree, point_t* query, int k, footpath_t*** footpaths);
+int location_footpaths(location_t* location, footpath_t*** footpaths);
+
+#endif //QTREE_SELF_IMPLEMENTATION_STAGE_H
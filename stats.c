@@ -0,0 +1,56 @@
+/*
+ * Traversal statistics. query_stats holds the counters of the operation in
+ * progress; stats_end folds them into the totals of that kind and, when
+ * stats_verbose is set, prints them. Neither is safe to share between
+ * threads, so counting is meant for single-threaded diagnosis.
+ */
+
+#include "stats.h"
+
+qtree_stats_t query_stats;
+qtree_stats_t total_stats[STATS_KINDS];
+int stats_verbose = 0;
+
+static char* kind_names[STATS_KINDS] = {"insert", "point", "range"};
+
+/* reset the counters of the operation about to start */
+void stats_begin() {
+    query_stats.queries = 1;
+    query_stats.nodes = 0;
+    query_stats.intersects = 0;
+    query_stats.leaf_tests = 0;
+    query_stats.max_depth = 0;
+    query_stats.hits = 0;
+}
+
+/* fold the finished operation's counters into its kind's totals */
+void stats_end(enum stats_kind kind) {
+    qtree_stats_t* total = &total_stats[kind];
+    total->queries++;
+    total->nodes += query_stats.nodes;
+    total->intersects += query_stats.intersects;
+    total->leaf_tests += query_stats.leaf_tests;
+    total->hits += query_stats.hits;
+    if (query_stats.max_depth > total->max_depth)
+        total->max_depth = query_stats.max_depth;
+    if (stats_verbose)
+        print_stats(stderr, kind_names[kind], &query_stats);
+}
+
+/* print a set of counters on one line */
+void print_stats(FILE* f, char* label, qtree_stats_t* stats) {
+    fprintf(f, "[stats] %s: queries %ld, nodes %ld, intersects %ld, "
+               "leaf tests %ld, max depth %d, hits %ld\n",
+            label, stats->queries, stats->nodes, stats->intersects,
+            stats->leaf_tests, stats->max_depth, stats->hits);
+}
+
+/* print the totals of every kind of operation */
+void print_total_stats(FILE* f) {
+    if (!STATS_ENABLED) {
+        fprintf(f, "[stats] not available: built without QTREE_STATS\n");
+        return;
+    }
+    for (int i=0; i < STATS_KINDS; i++)
+        print_stats(f, kind_names[i], &total_stats[i]);
+}
@@ -0,0 +1,52 @@
+/*
+ * Traversal statistics header: counters of the work done by each insertion,
+ * point search and range search, and their running totals. Counting is
+ * compiled in only when QTREE_STATS is defined (cmake -DQTREE_STATS=ON);
+ * otherwise every counting macro expands to nothing.
+ */
+
+#include <stdio.h>
+
+#ifndef QTREE_SELF_IMPLEMENTATION_STATS_H
+#define QTREE_SELF_IMPLEMENTATION_STATS_H
+
+// kinds of operations, each with their own totals
+enum stats_kind {STATS_INSERT, STATS_POINT, STATS_RANGE, STATS_KINDS};
+
+// counters of a single operation, or totals over many
+typedef struct qtree_stats {
+    long queries;     // number of operations counted (totals only)
+    long nodes;       // nodes visited
+    long intersects;  // rectangle intersection tests
+    long leaf_tests;  // points tested at leaves
+    int max_depth;    // deepest level reached
+    long hits;        // points found (or stored, for insertion)
+} qtree_stats_t;
+
+extern qtree_stats_t query_stats;
+extern qtree_stats_t total_stats[STATS_KINDS];
+extern int stats_verbose;
+
+// function prototypes
+void stats_begin();
+void stats_end(enum stats_kind kind);
+void print_stats(FILE* f, char* label, qtree_stats_t* stats);
+void print_total_stats(FILE* f);
+
+#ifdef QTREE_STATS
+#define STATS_ENABLED 1
+#define STAT_BEGIN() stats_begin()
+#define STAT_END(kind) stats_end(kind)
+#define STAT_ADD(field, n) (query_stats.field += (n))
+#define STAT_LEVEL(level) \
+    (query_stats.nodes++, \
+     query_stats.max_depth = ((level) > query_stats.max_depth) ? (level) : query_stats.max_depth)
+#else
+#define STATS_ENABLED 0
+#define STAT_BEGIN() ((void) 0)
+#define STAT_END(kind) ((void) 0)
+#define STAT_ADD(field, n) ((void) 0)
+#define STAT_LEVEL(level) ((void) 0)
+#endif
+
+#endif //QTREE_SELF_IMPLEMENTATION_STATS_H
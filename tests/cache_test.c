@@ -0,0 +1,115 @@
+/*
+ * Range cache test: interleaves insertions into a random tree with range
+ * searches through a small cache, over a pool of windows and filters that
+ * repeat so that entries are hit, go stale and are evicted. Some points
+ * share a location, so a filter over 2 columns must match one of their
+ * records, not the union of their categories. Every result must be exactly
+ * what a fresh search_range over the tree would give then, filtered, in its
+ * order.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include "check.h"
+#include "cache.h"
+
+#define TEST_INITIAL 2000  // points in the tree before the first search
+#define TEST_INSERTS 3000  // points inserted between searches
+#define TEST_STEPS 8000    // searches and insertions, in random order
+#define TEST_WINDOWS 40    // windows searched, over and over
+#define TEST_FILTERS 4     // filters searched with, besides none
+#define TEST_CAPACITY 24   // entries the cache holds
+#define TEST_VALUES 4      // values of the "c" column
+
+int main() {
+    unsigned seed = CHECK_SEED;
+    point_t *bL = init_point(0, 0), *tR = init_point(100, 100);
+    square_t* square = init_square(bL, tR);
+    qtnode_t* tree = init_tree(square);
+    int npoints = TEST_INITIAL + TEST_INSERTS;
+    point_t** points = check_points(&seed, square, npoints);
+    category_dict_t* dict = init_category_dict();
+    char value[MAX_NAME_LEN];
+    for (int i=0; i < npoints; i++) {
+        // every tenth point shares an earlier one's location
+        if (i % 10 == 9) {
+            point_t* earlier = points[check_rand(&seed) % i];
+            points[i]->x = earlier->x;
+            points[i]->y = earlier->y;
+        }
+        snprintf(value, MAX_NAME_LEN, "v%u", check_rand(&seed) % TEST_VALUES);
+        points[i]->category = (category_t) 1 << category_bit(dict, "c", value, 1);
+        snprintf(value, MAX_NAME_LEN, "d%u", check_rand(&seed) % 2);
+        points[i]->category |= (category_t) 1 << category_bit(dict, "d", value, 1);
+    }
+    for (int i=0; i < TEST_INITIAL; i++)
+        insert(tree, points[i]);
+
+    square_t* windows[TEST_WINDOWS];
+    for (int w=0; w < TEST_WINDOWS; w++)
+        windows[w] = check_window(&seed, square);
+    // filter 0 is none, the others allow 1 or 2 values of "c", and half of
+    // them one value of "d" as well
+    filter_t* filters[TEST_FILTERS + 1] = {NULL};
+    for (int f=1; f <= TEST_FILTERS; f++) {
+        filters[f] = init_filter();
+        for (int v=0; v < 1 + f % 2; v++) {
+            snprintf(value, MAX_NAME_LEN, "v%d", (f + v) % TEST_VALUES);
+            filter_add(filters[f], dict, "c", value);
+        }
+        if (f > TEST_FILTERS / 2) {
+            snprintf(value, MAX_NAME_LEN, "d%d", f % 2);
+            filter_add(filters[f], dict, "d", value);
+        }
+    }
+
+    range_cache_t* cache = init_range_cache(tree, TEST_CAPACITY);
+    point_t** expected = (point_t**) malloc(sizeof(point_t*) * npoints);
+    int inserted = TEST_INITIAL;
+    for (int s=0; s < TEST_STEPS; s++) {
+        if (inserted < npoints && check_rand(&seed) % 3 == 0) {
+            insert(tree, points[inserted++]);
+            continue;
+        }
+        int w = (int) (check_rand(&seed) % TEST_WINDOWS);
+        int f = (int) (check_rand(&seed) % (TEST_FILTERS + 1));
+        int n = check_range_order(tree, windows[w], expected);
+        int kept = 0;
+        for (int i=0; i < n; i++)
+            if (filter_match_point(filters[f], expected[i])) expected[kept++] = expected[i];
+        point_t** found;
+        int nfound = cached_range(cache, windows[w], filters[f], &found);
+        CHECK(nfound == kept, "step %d, window %d, filter %d: %d points, expected %d",
+              s, w, f, nfound, kept);
+        for (int i=0; i < kept && i < nfound; i++)
+            CHECK(found[i] == expected[i], "step %d, window %d, filter %d: point %d differs",
+                  s, w, f, i);
+    }
+    CHECK(cache->hits > 0 && cache->misses > 0, "%lld hits, %lld misses",
+          cache->hits, cache->misses);
+    CHECK(cache->length <= TEST_CAPACITY, "%d entries past capacity", cache->length);
+
+    // a point inserted through a cached window's covering node shows up
+    square_t* window = windows[0];
+    point_t** found;
+    int before = cached_range(cache, window, NULL, &found);
+    point_t* inside = init_point((window->bottom_left->x + window->top_right->x) / 2,
+                                 (window->bottom_left->y + window->top_right->y) / 2);
+    qtnode_t* cover = covering_node(tree, window);
+    uint32_t generation = cover->generation;
+    insert(tree, inside);
+    CHECK(cover->generation != generation, "insertion did not pass through the cover");
+    CHECK(cached_range(cache, window, NULL, &found) == before + 1, "stale entry served");
+
+    free_range_cache(cache);
+    free(expected);
+    for (int f=1; f <= TEST_FILTERS; f++) free_filter(filters[f]);
+    for (int w=0; w < TEST_WINDOWS; w++) free_check_square(windows[w]);
+    free_category_dict(dict);
+    free_tree(tree);
+    free(inside);
+    free(bL);
+    free(tR);
+    free_check_points(points, npoints);
+    return check_done("cache");
+}
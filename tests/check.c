@@ -0,0 +1,158 @@
+/*
+ * Helpers shared by the module tests (see check.h). Random points are
+ * drawn half uniformly over the square and half around a few centres, so
+ * that trees get both shallow and deep branches.
+ */
+
+#include <stdarg.h>
+#include <stdlib.h>
+#include <assert.h>
+#include "check.h"
+#include "grid.h"
+
+#define CHECK_CLUSTERS 4  // centres the clustered half of the points gather around
+
+// failures seen so far by this test
+static int failures = 0;
+
+/* search below a node as search_range does, appending what it would print */
+void range_order_level(qtnode_t* tree, square_t* rectangle, point_t** out, int* n);
+
+/* point comparison by x then y, for qsort */
+int point_order(const void* a, const void* b);
+
+/* count a failure, reporting where it happened */
+void check_fail(const char* file, int line, const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    fprintf(stderr, "FAIL %s:%d: ", file, line);
+    vfprintf(stderr, format, args);
+    fprintf(stderr, "\n");
+    va_end(args);
+    failures++;
+}
+
+/* report the outcome of a test, returning its exit status */
+int check_done(const char* name) {
+    if (failures) printf("%s: %d checks failed\n", name, failures);
+    else printf("%s: ok\n", name);
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+/* next value of a xorshift generator */
+unsigned check_rand(unsigned* seed) {
+    unsigned x = *seed;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *seed = x;
+}
+
+/* a uniform value between lo and hi */
+long double check_uniform(unsigned* seed, long double lo, long double hi) {
+    return lo + (hi - lo) * (check_rand(seed) / 4294967296.0L);
+}
+
+/* n random points within the square, half uniform and half clustered */
+point_t** check_points(unsigned* seed, square_t* square, int n) {
+    long double x0 = square->bottom_left->x, x1 = square->top_right->x;
+    long double y0 = square->bottom_left->y, y1 = square->top_right->y;
+    long double cx[CHECK_CLUSTERS], cy[CHECK_CLUSTERS];
+    for (int i=0; i < CHECK_CLUSTERS; i++) {
+        cx[i] = check_uniform(seed, x0, x1);
+        cy[i] = check_uniform(seed, y0, y1);
+    }
+    point_t** points = (point_t**) malloc(sizeof(point_t*) * (n > 0 ? n : 1));
+    assert(points);
+    for (int i=0; i < n; i++) {
+        long double x, y;
+        if (i % 2) {
+            x = check_uniform(seed, x0, x1);
+            y = check_uniform(seed, y0, y1);
+        } else {
+            int c = (int) (check_rand(seed) % CHECK_CLUSTERS);
+            long double spread = (x1 - x0) / 1000;
+            x = cx[c] + check_uniform(seed, -spread, spread);
+            y = cy[c] + check_uniform(seed, -spread, spread);
+            x = (x < x0) ? x0 : (x > x1) ? x1 : x;
+            y = (y < y0) ? y0 : (y > y1) ? y1 : y;
+        }
+        points[i] = init_point(x, y);
+    }
+    return points;
+}
+
+/* a random window within the square, from a sliver to most of it */
+square_t* check_window(unsigned* seed, square_t* square) {
+    long double x0 = square->bottom_left->x, x1 = square->top_right->x;
+    long double y0 = square->bottom_left->y, y1 = square->top_right->y;
+    long double w = (x1 - x0) * check_uniform(seed, 0, 1) * check_uniform(seed, 0, 1);
+    long double h = (y1 - y0) * check_uniform(seed, 0, 1) * check_uniform(seed, 0, 1);
+    long double x = check_uniform(seed, x0, x1 - w), y = check_uniform(seed, y0, y1 - h);
+    return init_square(init_point(x, y), init_point(x + w, y + h));
+}
+
+/* free points made by check_points */
+void free_check_points(point_t** points, int n) {
+    for (int i=0; i < n; i++) free(points[i]);
+    free(points);
+}
+
+/* free a square made by check_window or init_square, with its corners */
+void free_check_square(square_t* square) {
+    free(square->bottom_left);
+    free(square->top_right);
+    free(square);
+}
+
+/* the points within the rectangle, by testing each one */
+int check_brute_range(point_t** points, int n, square_t* rectangle, point_t** out) {
+    int found = 0;
+    for (int i=0; i < n; i++)
+        if (in_sq(rectangle, points[i])) out[found++] = points[i];
+    return found;
+}
+
+/* the points search_range prints, in the order it prints them */
+int check_range_order(qtnode_t* tree, square_t* rectangle, point_t** out) {
+    int n = 0;
+    GRID_SQUARE(tree->square, rectangle);
+    range_order_level(tree, rectangle, out, &n);
+    return n;
+}
+
+/* search below a node as search_range does, appending what it would print */
+void range_order_level(qtnode_t* tree, square_t* rectangle, point_t** out, int* n) {
+    if (IS_LEAF(tree)) {
+        if (tree->point != NULL && IN_RANGE(rectangle, tree->point))
+            out[(*n)++] = tree->point;
+        return;
+    }
+    qtnode_t* children[4] = {tree->nw, tree->ne, tree->sw, tree->se};
+    for (int i=0; i < 4; i++)
+        if (children[i] != NULL && OVERLAPS(children[i]->square, rectangle))
+            range_order_level(children[i], rectangle, out, n);
+}
+
+/* sort points by x then y */
+void check_sort_points(point_t** points, int n) {
+    if (n > 1) qsort(points, n, sizeof(point_t*), point_order);
+}
+
+/* whether 2 sets of points have the same coordinates, once sorted */
+int check_same_points(point_t** a, int na, point_t** b, int nb) {
+    if (na != nb) return 0;
+    check_sort_points(a, na);
+    check_sort_points(b, nb);
+    for (int i=0; i < na; i++)
+        if (!point_cmp(a[i], b[i])) return 0;
+    return 1;
+}
+
+/* point comparison by x then y, for qsort */
+int point_order(const void* a, const void* b) {
+    point_t* p1 = *(point_t**) a;
+    point_t* p2 = *(point_t**) b;
+    if (p1->x != p2->x) return (p1->x > p2->x) - (p1->x < p2->x);
+    return (p1->y > p2->y) - (p1->y < p2->y);
+}
@@ -0,0 +1,34 @@
+/*
+ * Check header: the helpers shared by the module tests of tests/, each a
+ * program comparing a module with a brute-force answer over seeded random
+ * data. A failed CHECK reports where it failed and the test carries on, so
+ * that one run shows every mismatch; check_done() then sets the status.
+ */
+
+#include <stdio.h>
+#include "qtree.h"
+
+#ifndef QTREE_SELF_IMPLEMENTATION_CHECK_H
+#define QTREE_SELF_IMPLEMENTATION_CHECK_H
+
+#define CHECK_SEED 20261019u  // seed of every test's random data
+
+// count a failure, reporting it, unless cond holds
+#define CHECK(cond, ...) \
+    do { if (!(cond)) check_fail(__FILE__, __LINE__, __VA_ARGS__); } while (0)
+
+// function prototypes
+void check_fail(const char* file, int line, const char* format, ...);
+int check_done(const char* name);
+unsigned check_rand(unsigned* seed);
+long double check_uniform(unsigned* seed, long double lo, long double hi);
+point_t** check_points(unsigned* seed, square_t* square, int n);
+square_t* check_window(unsigned* seed, square_t* square);
+void free_check_points(point_t** points, int n);
+void free_check_square(square_t* square);
+int check_brute_range(point_t** points, int n, square_t* rectangle, point_t** out);
+int check_range_order(qtnode_t* tree, square_t* rectangle, point_t** out);
+void check_sort_points(point_t** points, int n);
+int check_same_points(point_t** a, int na, point_t** b, int nb);
+
+#endif //QTREE_SELF_IMPLEMENTATION_CHECK_H
@@ -0,0 +1,91 @@
+/*
+ * Compressed tree test: inserts the same random points, a few of them
+ * twice, into a compressed tree and a plain one, and checks that point and
+ * range search find the same points in the same order in both, and that
+ * below the root no compressed node has a single child.
+ */
+
+#include <stdlib.h>
+#include "check.h"
+#include "compressed.h"
+
+#define TEST_POINTS 5000   // points in each tree
+#define TEST_ABSENT 1000   // random point queries, most of them absent
+#define TEST_WINDOWS 300   // windows searched
+
+/* count the nodes below the root with a single child, and all nodes */
+void count_nodes(cqnode_t* node, int root, int* single, int* nodes);
+
+int main() {
+    unsigned seed = CHECK_SEED;
+    point_t *bL = init_point(0, 0), *tR = init_point(100, 100);
+    square_t* square = init_square(bL, tR);
+    qtnode_t* tree = init_tree(square);
+    cqnode_t* compressed = init_compressed(init_square(bL, tR));
+    point_t** points = check_points(&seed, square, TEST_POINTS);
+    for (int i=0; i < TEST_POINTS; i++) {
+        if (i % 10 == 9) {
+            point_t* earlier = points[check_rand(&seed) % i];
+            points[i]->x = earlier->x;
+            points[i]->y = earlier->y;
+        }
+        points[i]->category = (category_t) 1 << (i % 8);
+        insert(tree, points[i]);
+        compressed_insert(compressed, points[i]);
+    }
+    for (int i=0; i < TEST_POINTS; i++)
+        CHECK(points[i]->category == (category_t) 1 << (i % 8), "point %d: categories changed", i);
+
+    int single = 0, nodes = 0;
+    count_nodes(compressed, 1, &single, &nodes);
+    CHECK(single == 0, "%d nodes with a single child", single);
+    CHECK(nodes < 2 * TEST_POINTS, "%d nodes for %d points", nodes, TEST_POINTS);
+
+    for (int i=0; i < TEST_POINTS; i++) {
+        point_t query = {.x = points[i]->x, .y = points[i]->y};
+        point_t* stored = find_pt(tree, &query);
+        point_t* found = compressed_find_pt(compressed, &query);
+        CHECK(found != NULL && point_cmp(found, stored) && found->category == stored->category,
+              "point %d: other stored point", i);
+    }
+    for (int i=0; i < TEST_ABSENT; i++) {
+        point_t query = {.x = check_uniform(&seed, 0, 100), .y = check_uniform(&seed, 0, 100)};
+        CHECK((compressed_find_pt(compressed, &query) == NULL) == (find_pt(tree, &query) == NULL),
+              "query %d: found in only one tree", i);
+    }
+
+    point_t** expected = (point_t**) malloc(sizeof(point_t*) * TEST_POINTS);
+    point_t** found = (point_t**) malloc(sizeof(point_t*) * TEST_POINTS);
+    for (int w=0; w < TEST_WINDOWS; w++) {
+        square_t* window = check_window(&seed, square);
+        int n = check_range_order(tree, window, expected);
+        int nfound = compressed_range(compressed, window, found, TEST_POINTS);
+        CHECK(nfound == n, "window %d: %d points, expected %d", w, nfound, n);
+        for (int i=0; i < n && i < nfound; i++)
+            CHECK(point_cmp(found[i], expected[i]), "window %d: point %d out of order", w, i);
+        // a short buffer still counts every point
+        CHECK(compressed_range(compressed, window, found, 1) == n,
+              "window %d: count past max", w);
+        free_check_square(window);
+    }
+    free(expected);
+    free(found);
+    free_compressed(compressed);
+    free_tree(tree);
+    free(bL);
+    free(tR);
+    free_check_points(points, TEST_POINTS);
+    return check_done("compressed");
+}
+
+/* count the nodes below the root with a single child, and all nodes */
+void count_nodes(cqnode_t* node, int root, int* single, int* nodes) {
+    int children = 0;
+    (*nodes)++;
+    for (enum quadrant q = sw; q <= se; q++) {
+        if (node->child[q] == NULL) continue;
+        children++;
+        count_nodes(node->child[q], 0, single, nodes);
+    }
+    if (!root && children == 1) (*single)++;
+}
@@ -0,0 +1,60 @@
+/*
+ * Range cursor test: pages through random windows of a random tree with
+ * several page sizes, checking that the pages together hold exactly the
+ * points search_range reports, in its order, and that the cursor is done
+ * once a short page comes back.
+ */
+
+#include <stdlib.h>
+#include "check.h"
+#include "cursor.h"
+
+#define TEST_POINTS 5000   // points in the tree
+#define TEST_WINDOWS 200   // windows paged through
+
+int main() {
+    unsigned seed = CHECK_SEED;
+    point_t *bL = init_point(0, 0), *tR = init_point(100, 100);
+    square_t* square = init_square(bL, tR);
+    qtnode_t* tree = init_tree(square);
+    point_t** points = check_points(&seed, square, TEST_POINTS);
+    for (int i=0; i < TEST_POINTS; i++)
+        insert(tree, points[i]);
+
+    point_t** expected = (point_t**) malloc(sizeof(point_t*) * TEST_POINTS);
+    point_t** brute = (point_t**) malloc(sizeof(point_t*) * TEST_POINTS);
+    point_t** paged = (point_t**) malloc(sizeof(point_t*) * TEST_POINTS);
+    int pages[] = {1, 7, 64, TEST_POINTS};
+    for (int w=0; w < TEST_WINDOWS; w++) {
+        square_t* window = check_window(&seed, square);
+        int n = check_range_order(tree, window, expected);
+        int nbrute = check_brute_range(points, TEST_POINTS, window, brute);
+        for (int p=0; p < 4; p++) {
+            range_cursor_t* cursor = init_range_cursor(tree, window);
+            int found = 0, got;
+            do {
+                got = range_cursor_next(cursor, paged + found, pages[p]);
+                found += got;
+            } while (got == pages[p] && found < TEST_POINTS);
+            CHECK(found == n, "window %d, page %d: %d points, expected %d",
+                  w, pages[p], found, n);
+            for (int i=0; i < n && i < found; i++)
+                CHECK(paged[i] == expected[i], "window %d, page %d: point %d out of order",
+                      w, pages[p], i);
+            CHECK(range_cursor_next(cursor, paged, 1) == 0 && range_cursor_done(cursor),
+                  "window %d, page %d: cursor not done", w, pages[p]);
+            free_range_cursor(cursor);
+        }
+        CHECK(check_same_points(expected, n, brute, nbrute),
+              "window %d: %d points, brute force finds %d", w, n, nbrute);
+        free_check_square(window);
+    }
+    free(expected);
+    free(brute);
+    free(paged);
+    free_tree(tree);
+    free(bL);
+    free(tR);
+    free_check_points(points, TEST_POINTS);
+    return check_done("cursor");
+}
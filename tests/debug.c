@@ -6,6 +6,7 @@
 
 #include <stdio.h>
 #include "queue.h"
+#include "cursor.h"
 #include "read.h"
 #include "debug.h"
 
@@ -88,6 +89,23 @@ int debug_mode() {
            p24->x, p24->y, p25->x, p25->y);
     search_range(tree, sq2);
 
+    /**
+     * Range cursor - paging through the whole o.s, 2 points at a time
+     */
+    printf("\n+-----------------------+\n");
+    printf(  "|     Range cursor:     |");
+    printf("\n+-----------------------+\n");
+    point_t *page[2];
+    int page_num = 0, n;
+    range_cursor_t *cursor = init_range_cursor(tree, tree->square);
+    do {
+        n = range_cursor_next(cursor, page, 2);
+        for (int i=0; i < n; i++)
+            printf("Page %d: (%Lf, %Lf)\n", page_num, page[i]->x, page[i]->y);
+        page_num++;
+    } while (n == 2);
+    free_range_cursor(cursor);
+
     /**
      * Freeing memory
      */
@@ -0,0 +1,169 @@
+/*
+ * Attribute filter test: gives random points random categories over 2
+ * columns, a tenth of them inserted again at an earlier point's location
+ * with other categories, then checks filtered point, range and kNN search
+ * against testing every location, which matches when one of the points
+ * inserted there matches on its own; the union of their categories may
+ * match where none of them does. The points inserted must keep their own
+ * categories, and a stored point must carry the union.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include "check.h"
+#include "filter.h"
+#include "knn.h"
+
+#define TEST_POINTS 3000   // points inserted, duplicates included
+#define TEST_FILTERS 40    // random filters checked
+#define TEST_QUERIES 50    // windows and kNN queries per filter
+#define TEST_K 9           // neighbours asked for
+#define TEST_KINDS 6       // values of the "kind" column
+#define TEST_SIDES 3       // values of the "side" column
+
+/* a random filter of 1 or 2 clauses, each allowing 1 to 3 values */
+filter_t* random_filter(unsigned* seed, category_dict_t* dict);
+
+/* the union of the categories of every point at the location of point i */
+category_t location_categories(point_t** points, category_t* categories, int n, int i);
+
+/* whether one of the points at the location of point i matches the filter */
+int location_match(point_t** points, category_t* categories, int n, int i, filter_t* filter);
+
+int main() {
+    unsigned seed = CHECK_SEED;
+    point_t *bL = init_point(0, 0), *tR = init_point(100, 100);
+    square_t* square = init_square(bL, tR);
+    qtnode_t* tree = init_tree(square);
+    category_dict_t* dict = init_category_dict();
+    point_t** points = check_points(&seed, square, TEST_POINTS);
+    category_t* categories = (category_t*) malloc(sizeof(category_t) * TEST_POINTS);
+    char value[MAX_NAME_LEN];
+    for (int i=0; i < TEST_POINTS; i++) {
+        if (i % 10 == 9) {
+            point_t* earlier = points[check_rand(&seed) % i];
+            points[i]->x = earlier->x;
+            points[i]->y = earlier->y;
+        }
+        snprintf(value, MAX_NAME_LEN, "k%u", check_rand(&seed) % TEST_KINDS);
+        int kind = category_bit(dict, "kind", value, 1);
+        snprintf(value, MAX_NAME_LEN, "s%u", check_rand(&seed) % TEST_SIDES);
+        int side = category_bit(dict, "side", value, 1);
+        categories[i] = ((category_t) 1 << kind) | ((category_t) 1 << side);
+        points[i]->category = categories[i];
+        insert(tree, points[i]);
+    }
+    for (int i=0; i < TEST_POINTS; i++)
+        CHECK(points[i]->category == categories[i], "point %d: categories changed", i);
+
+    // the first point at each location stands for it
+    int* first = (int*) malloc(sizeof(int) * TEST_POINTS);
+    category_t* merged = (category_t*) malloc(sizeof(category_t) * TEST_POINTS);
+    int nfirst = 0;
+    for (int i=0; i < TEST_POINTS; i++) {
+        int j = 0;
+        while (j < i && !point_cmp(points[j], points[i])) j++;
+        if (j < i) continue;
+        first[nfirst] = i;
+        merged[nfirst++] = location_categories(points, categories, TEST_POINTS, i);
+    }
+
+    point_t** found = (point_t**) malloc(sizeof(point_t*) * TEST_POINTS);
+    point_t** brute = (point_t**) malloc(sizeof(point_t*) * TEST_POINTS);
+    long double* dists = (long double*) malloc(sizeof(long double) * TEST_POINTS);
+    for (int f=0; f <= TEST_FILTERS; f++) {
+        // the last filter allows a value never seen, and so matches nothing
+        filter_t* filter = random_filter(&seed, dict);
+        if (f == TEST_FILTERS) filter_add(filter, dict, "side", "unseen");
+        for (int l=0; l < nfirst; l++) {
+            point_t* location = points[first[l]];
+            point_t query = {.x = location->x, .y = location->y};
+            point_t* stored = find_pt_filter(tree, &query, filter);
+            int match = location_match(points, categories, TEST_POINTS, first[l], filter);
+            CHECK((stored != NULL) == match, "filter %d, location %d: %s, expected %s",
+                  f, l, stored ? "found" : "not found", match ? "found" : "not found");
+            CHECK(stored == NULL || stored->category == merged[l],
+                  "filter %d, location %d: wrong categories", f, l);
+        }
+        for (int q=0; q < TEST_QUERIES; q++) {
+            square_t* window = check_window(&seed, square);
+            int n = range_filter(tree, window, filter, found, TEST_POINTS);
+            int nbrute = 0;
+            for (int l=0; l < nfirst; l++)
+                if (in_sq(window, points[first[l]]) &&
+                    location_match(points, categories, TEST_POINTS, first[l], filter))
+                    brute[nbrute++] = points[first[l]];
+            CHECK(check_same_points(found, n, brute, nbrute),
+                  "filter %d, window %d: %d points, brute force finds %d", f, q, n, nbrute);
+            free_check_square(window);
+
+            point_t query = {.x = check_uniform(&seed, 0, 100),
+                             .y = check_uniform(&seed, 0, 100)};
+            n = search_knn(tree, &query, TEST_K, filter, found);
+            int ndists = 0;
+            for (int l=0; l < nfirst; l++)
+                if (location_match(points, categories, TEST_POINTS, first[l], filter))
+                    dists[ndists++] = point_dist2(&query, points[first[l]]);
+            // the k smallest distances, by selection
+            for (int i=0; i < TEST_K && i < ndists; i++)
+                for (int j=i+1; j < ndists; j++)
+                    if (dists[j] < dists[i]) {
+                        long double d = dists[i];
+                        dists[i] = dists[j];
+                        dists[j] = d;
+                    }
+            int k = (ndists < TEST_K) ? ndists : TEST_K;
+            CHECK(n == k, "filter %d, kNN %d: %d neighbours, expected %d", f, q, n, k);
+            for (int i=0; i < n && i < k; i++) {
+                CHECK(point_dist2(&query, found[i]) == dists[i],
+                      "filter %d, kNN %d: neighbour %d too far", f, q, i);
+                CHECK(filter_match_point(filter, found[i]),
+                      "filter %d, kNN %d: neighbour %d does not match", f, q, i);
+            }
+        }
+        free_filter(filter);
+    }
+    free(found);
+    free(brute);
+    free(dists);
+    free(first);
+    free(merged);
+    free(categories);
+    free_category_dict(dict);
+    free_tree(tree);
+    free(bL);
+    free(tR);
+    free_check_points(points, TEST_POINTS);
+    return check_done("filter");
+}
+
+/* a random filter of 1 or 2 clauses, each allowing 1 to 3 values */
+filter_t* random_filter(unsigned* seed, category_dict_t* dict) {
+    filter_t* filter = init_filter();
+    char value[MAX_NAME_LEN];
+    int nvalues = 1 + check_rand(seed) % 3;
+    for (int i=0; i < nvalues; i++) {
+        snprintf(value, MAX_NAME_LEN, "k%u", check_rand(seed) % TEST_KINDS);
+        filter_add(filter, dict, "kind", value);
+    }
+    if (check_rand(seed) % 2) {
+        snprintf(value, MAX_NAME_LEN, "s%u", check_rand(seed) % TEST_SIDES);
+        filter_add(filter, dict, "side", value);
+    }
+    return filter;
+}
+
+/* whether one of the points at the location of point i matches the filter */
+int location_match(point_t** points, category_t* categories, int n, int i, filter_t* filter) {
+    for (int j=0; j < n; j++)
+        if (point_cmp(points[j], points[i]) && filter_match(filter, categories[j])) return 1;
+    return 0;
+}
+
+/* the union of the categories of every point at the location of point i */
+category_t location_categories(point_t** points, category_t* categories, int n, int i) {
+    category_t category = 0;
+    for (int j=0; j < n; j++)
+        if (point_cmp(points[j], points[i])) category |= categories[j];
+    return category;
+}
@@ -0,0 +1,93 @@
+/*
+ * Footpath packing test: packs a dataset read twice, in its own order and
+ * along the Hilbert curve, checking every record against the unpacked one,
+ * and packs an empty dataset, whose packed form has no blocks to free.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <string.h>
+#include "check.h"
+#include "footpath.h"
+#include "hilbert.h"
+
+#define TEST_DATASET QTREE_DATA_DIR "/dataset_1000.csv"
+#define TEST_HEADER "footpath_id,address,clue_sa,asset_type,deltaz,distance,grade1in," \
+                    "mcc_id,mccid_int,rlmax,rlmin,segside,statusid,streetid,"         \
+                    "street_group,start_lat,start_lon,end_lat,end_lon\n"
+
+/* read the test dataset; NULL if it cannot be opened */
+footpath_t** read_dataset(int* n);
+
+/* whether 2 footpaths hold the same record */
+int same_footpath(footpath_t* a, footpath_t* b);
+
+int main() {
+    int n, npacked;
+    footpath_t** fps = read_dataset(&n);
+    footpath_t** packed = read_dataset(&npacked);
+    if (fps == NULL || packed == NULL) {
+        fprintf(stderr, "Cannot open %s!\n", TEST_DATASET);
+        return EXIT_FAILURE;
+    }
+    CHECK(n > 0 && npacked == n, "dataset read as %d and %d footpaths", n, npacked);
+
+    // packed in the dataset's order, record by record
+    packed = pack_footpaths(packed, npacked);
+    for (int i=0; i < n; i++)
+        CHECK(same_footpath(fps[i], packed[i]), "footpath %d changed once packed", i);
+    free_packed_footpaths(packed, npacked);
+
+    // packed along the curve: the same records, each exactly once
+    point_t bL = {.x = 144, .y = -38}, tR = {.x = 145, .y = -37};
+    square_t square = {.bottom_left = &bL, .top_right = &tR};
+    packed = read_dataset(&npacked);
+    packed = hilbert_footpaths(packed, npacked, &square);
+    char* matched = (char*) calloc(n, 1);
+    for (int i=0; i < npacked; i++) {
+        int j = 0;
+        while (j < n && (matched[j] || !same_footpath(fps[j], packed[i]))) j++;
+        CHECK(j < n, "footpath %d not in the dataset once packed", i);
+        if (j < n) matched[j] = 1;
+    }
+    free(matched);
+    free_packed_footpaths(packed, npacked);
+    free_footpaths(fps, n);
+
+    // an empty dataset packs into no blocks, either way
+    FILE* empty = fmemopen(TEST_HEADER, strlen(TEST_HEADER), "r");
+    fps = read_footpaths(empty, &n);
+    fclose(empty);
+    CHECK(n == 0, "empty dataset read as %d footpaths", n);
+    fps = pack_footpaths(fps, n);
+    free_packed_footpaths(fps, n);
+    empty = fmemopen(TEST_HEADER, strlen(TEST_HEADER), "r");
+    fps = read_footpaths(empty, &n);
+    fclose(empty);
+    fps = hilbert_footpaths(fps, n, &square);
+    free_packed_footpaths(fps, n);
+    return check_done("footpath");
+}
+
+/* read the test dataset; NULL if it cannot be opened */
+footpath_t** read_dataset(int* n) {
+    FILE* data = fopen(TEST_DATASET, "r");
+    if (data == NULL) return NULL;
+    footpath_t** fps = read_footpaths(data, n);
+    fclose(data);
+    return fps;
+}
+
+/* whether 2 footpaths hold the same record */
+int same_footpath(footpath_t* a, footpath_t* b) {
+    return a->footpath_id == b->footpath_id && strcmp(a->address, b->address) == 0 &&
+           strcmp(a->clue_sa, b->clue_sa) == 0 && strcmp(a->asset_type, b->asset_type) == 0 &&
+           a->deltaz == b->deltaz && a->distance == b->distance &&
+           a->grade1in == b->grade1in && a->mcc_id == b->mcc_id &&
+           a->mccid_int == b->mccid_int && a->rlmax == b->rlmax && a->rlmin == b->rlmin &&
+           strcmp(a->segside, b->segside) == 0 && a->statusid == b->statusid &&
+           a->streetid == b->streetid && a->street_group == b->street_group &&
+           a->start_lat == b->start_lat && a->start_lon == b->start_lon &&
+           a->end_lat == b->end_lat && a->end_lon == b->end_lon;
+}
@@ -0,0 +1,193 @@
+/*
+ * Frontier range search test: searches random windows of a tree large
+ * enough that a level of the frontier outgrows the queue's first buffer,
+ * checking that range_frontier finds the points search_range reports and a
+ * brute force finds, in the breadth-first order of a plain level by level
+ * search. With room for fewer points than it finds, it must still count
+ * them all, write only the first ones and nothing past them, and
+ * search_range_frontier must print every point in that order.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "check.h"
+#include "grid.h"
+#include "queue.h"
+
+#define TEST_POINTS 50000  // points in the tree
+#define TEST_WINDOWS 200   // windows searched
+#define TEST_MAX_DEPTH 256 // deepest level counted in the frontier
+
+/* the most nodes overlapping the rectangle at any one depth below a node,
+ * which the frontier's queue holds at once
+ */
+int widest_level(qtnode_t* tree, square_t* rectangle);
+
+/* count the nodes overlapping the rectangle at each depth below a node */
+void count_level(qtnode_t* tree, square_t* rectangle, int depth, int* widths);
+
+/* the points within the rectangle level by level, each level's nodes
+ * holding the children of the last, in the order nw, ne, sw, se
+ */
+int level_order(qtnode_t* tree, square_t* rectangle, point_t** out);
+
+/* what search_range_frontier prints, in a new string the caller frees */
+char* printed_points(qtnode_t* tree, square_t* rectangle);
+
+/* what search_range_frontier should print for the points found */
+char* expected_print(point_t** points, int n);
+
+int main() {
+    unsigned seed = CHECK_SEED;
+    point_t *bL = init_point(0, 0), *tR = init_point(100, 100);
+    square_t* square = init_square(bL, tR);
+    qtnode_t* tree = init_tree(square);
+    point_t** points = check_points(&seed, square, TEST_POINTS);
+    for (int i=0; i < TEST_POINTS; i++)
+        insert(tree, points[i]);
+
+    point_t** expected = (point_t**) malloc(sizeof(point_t*) * TEST_POINTS);
+    point_t** brute = (point_t**) malloc(sizeof(point_t*) * TEST_POINTS);
+    point_t** ordered = (point_t**) malloc(sizeof(point_t*) * TEST_POINTS);
+    point_t** found = (point_t**) malloc(sizeof(point_t*) * TEST_POINTS);
+    point_t** capped = (point_t**) malloc(sizeof(point_t*) * (TEST_POINTS + 1));
+    int grown = 0, overflowed = 0;
+    for (int w=0; w < TEST_WINDOWS; w++) {
+        square_t* window = check_window(&seed, square);
+        int n = check_range_order(tree, window, expected);
+        int nbrute = check_brute_range(points, TEST_POINTS, window, brute);
+        int nfound = range_frontier(tree, window, found, TEST_POINTS);
+        CHECK(nfound == n, "window %d: %d points, expected %d", w, nfound, n);
+        int nordered = level_order(tree, window, ordered);
+        for (int i=0; i < nordered && i < nfound; i++)
+            CHECK(found[i] == ordered[i], "window %d: point %d out of order", w, i);
+        grown += widest_level(tree, window) > QUEUE_INIT_CAP;
+
+        // room for half of them: every point counted, only the first written
+        int max = n / 2;
+        capped[max] = NULL;
+        int ncapped = range_frontier(tree, window, capped, max);
+        CHECK(ncapped == n, "window %d, room for %d: %d points, expected %d", w, max,
+              ncapped, n);
+        CHECK(capped[max] == NULL, "window %d, room for %d: written past the end", w, max);
+        for (int i=0; i < max && i < nfound; i++)
+            CHECK(capped[i] == found[i], "window %d, room for %d: point %d differs", w, max, i);
+        overflowed += n > QUEUE_INIT_CAP;
+
+        if (w % 10 == 0) {
+            char* printed = printed_points(tree, window);
+            char* listed = expected_print(ordered, nordered);
+            CHECK(printed != NULL && strcmp(printed, listed) == 0,
+                  "window %d: not the %d points printed", w, nordered);
+            free(printed);
+            free(listed);
+        }
+        CHECK(check_same_points(found, nfound, expected, n),
+              "window %d: not search_range's points", w);
+        CHECK(check_same_points(found, nfound, brute, nbrute),
+              "window %d: %d points, brute force finds %d", w, nfound, nbrute);
+        free_check_square(window);
+    }
+    CHECK(grown > 0, "no window's frontier outgrew the queue's first buffer");
+    CHECK(overflowed > 0, "no window found more than %d points", QUEUE_INIT_CAP);
+
+    free(expected);
+    free(brute);
+    free(ordered);
+    free(found);
+    free(capped);
+    free_tree(tree);
+    free(bL);
+    free(tR);
+    free_check_points(points, TEST_POINTS);
+    return check_done("frontier");
+}
+
+/* the most nodes overlapping the rectangle at any one depth below a node,
+ * which the frontier's queue holds at once
+ */
+int widest_level(qtnode_t* tree, square_t* rectangle) {
+    int widths[TEST_MAX_DEPTH] = {0};
+    count_level(tree, rectangle, 0, widths);
+    int widest = 0;
+    for (int d=0; d < TEST_MAX_DEPTH; d++)
+        if (widths[d] > widest) widest = widths[d];
+    return widest;
+}
+
+/* count the nodes overlapping the rectangle at each depth below a node */
+void count_level(qtnode_t* tree, square_t* rectangle, int depth, int* widths) {
+    if (depth >= TEST_MAX_DEPTH) return;
+    widths[depth]++;
+    qtnode_t* children[4] = {tree->nw, tree->ne, tree->sw, tree->se};
+    for (int i=0; i < 4; i++)
+        if (children[i] != NULL && OVERLAPS(children[i]->square, rectangle))
+            count_level(children[i], rectangle, depth + 1, widths);
+}
+
+/* the points within the rectangle level by level, each level's nodes
+ * holding the children of the last, in the order nw, ne, sw, se
+ */
+int level_order(qtnode_t* tree, square_t* rectangle, point_t** out) {
+    qtnode_t** level = (qtnode_t**) malloc(sizeof(qtnode_t*) * 4 * TEST_POINTS);
+    qtnode_t** next = (qtnode_t**) malloc(sizeof(qtnode_t*) * 4 * TEST_POINTS);
+    int width = 1, found = 0;
+    level[0] = tree;
+    while (width > 0) {
+        int nnext = 0;
+        for (int i=0; i < width; i++) {
+            qtnode_t* node = level[i];
+            if (IS_LEAF(node)) {
+                if (node->point != NULL && IN_RANGE(rectangle, node->point))
+                    out[found++] = node->point;
+                continue;
+            }
+            qtnode_t* children[4] = {node->nw, node->ne, node->sw, node->se};
+            for (int c=0; c < 4; c++)
+                if (children[c] != NULL && OVERLAPS(children[c]->square, rectangle))
+                    next[nnext++] = children[c];
+        }
+        qtnode_t** swap = level;
+        level = next;
+        next = swap;
+        width = nnext;
+    }
+    free(level);
+    free(next);
+    return found;
+}
+
+/* what search_range_frontier prints, in a new string the caller frees */
+char* printed_points(qtnode_t* tree, square_t* rectangle) {
+    FILE* captured = tmpfile();
+    if (captured == NULL) return NULL;
+    fflush(stdout);
+    int saved = dup(STDOUT_FILENO);
+    dup2(fileno(captured), STDOUT_FILENO);
+    search_range_frontier(tree, rectangle);
+    fflush(stdout);
+    dup2(saved, STDOUT_FILENO);
+    close(saved);
+    long length = ftell(captured);
+    char* text = (char*) calloc(length + 1, 1);
+    rewind(captured);
+    if (fread(text, 1, length, captured) != (size_t) length) text[0] = '\0';
+    fclose(captured);
+    return text;
+}
+
+/* what search_range_frontier should print for the points found */
+char* expected_print(point_t** points, int n) {
+    char* text;
+    size_t length;
+    FILE* f = open_memstream(&text, &length);
+    for (int i=0; i < n; i++)
+        fprintf(f, "Range search: (%Lf, %Lf)\n", points[i]->x, points[i]->y);
+    if (!n)
+        fprintf(f, "Range search: no point found!\n");
+    fclose(f);
+    return text;
+}
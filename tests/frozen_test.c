@@ -0,0 +1,65 @@
+/*
+ * Frozen tree test: freezes a random tree, a few of its points inserted
+ * twice, and checks point and range search over the frozen copy against
+ * the tree it was frozen from: the same stored point for every point and
+ * for random absent ones, and the same points in search_range's order for
+ * random windows.
+ */
+
+#include <stdlib.h>
+#include "check.h"
+#include "frozen.h"
+
+#define TEST_POINTS 5000   // points in the tree
+#define TEST_ABSENT 1000   // random point queries, most of them absent
+#define TEST_WINDOWS 300   // windows searched
+
+int main() {
+    unsigned seed = CHECK_SEED;
+    point_t *bL = init_point(0, 0), *tR = init_point(100, 100);
+    square_t* square = init_square(bL, tR);
+    qtnode_t* tree = init_tree(square);
+    point_t** points = check_points(&seed, square, TEST_POINTS);
+    for (int i=0; i < TEST_POINTS; i++) {
+        if (i % 10 == 9) {
+            point_t* earlier = points[check_rand(&seed) % i];
+            points[i]->x = earlier->x;
+            points[i]->y = earlier->y;
+        }
+        insert(tree, points[i]);
+    }
+    frozen_t* frozen = freeze(tree);
+
+    for (int i=0; i < TEST_POINTS; i++) {
+        point_t query = {.x = points[i]->x, .y = points[i]->y};
+        point_t* found = frozen_find_pt(frozen, &query);
+        CHECK(found != NULL && found == find_pt(tree, &query), "point %d: other stored point", i);
+    }
+    for (int i=0; i < TEST_ABSENT; i++) {
+        point_t query = {.x = check_uniform(&seed, 0, 100), .y = check_uniform(&seed, 0, 100)};
+        CHECK(frozen_find_pt(frozen, &query) == find_pt(tree, &query),
+              "query %d: other stored point", i);
+    }
+
+    point_t** expected = (point_t**) malloc(sizeof(point_t*) * TEST_POINTS);
+    point_t** found = (point_t**) malloc(sizeof(point_t*) * TEST_POINTS);
+    for (int w=0; w < TEST_WINDOWS; w++) {
+        square_t* window = check_window(&seed, square);
+        int n = check_range_order(tree, window, expected);
+        int nfound = frozen_range(frozen, window, found, TEST_POINTS);
+        CHECK(nfound == n, "window %d: %d points, expected %d", w, nfound, n);
+        for (int i=0; i < n && i < nfound; i++)
+            CHECK(found[i] == expected[i], "window %d: point %d out of order", w, i);
+        // a short buffer still counts every point
+        CHECK(frozen_range(frozen, window, found, 1) == n, "window %d: count past max", w);
+        free_check_square(window);
+    }
+    free(expected);
+    free(found);
+    free_frozen(frozen);
+    free_tree(tree);
+    free(bL);
+    free(tR);
+    free_check_points(points, TEST_POINTS);
+    return check_done("frozen");
+}
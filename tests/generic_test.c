@@ -0,0 +1,150 @@
+/*
+ * Generic quadtree test: instantiates qtree_generic.h over long double and
+ * over int coordinates, inserts random points (the int tree with many at a
+ * few hot spots, so that leaves at the depth limit chain overflow buckets)
+ * and checks find and range against testing every point inserted.
+ */
+
+#include <stdlib.h>
+#include "check.h"
+#include "qtree_generic.h"
+
+#define TEST_POINTS 4000    // points inserted into each tree
+#define TEST_WINDOWS 300    // windows searched in each tree
+#define TEST_HOT 3          // hot spots of the int tree
+#define TEST_SIDE 1000      // side of the int tree
+
+QTREE_INIT(real, int, long double, 4)
+QTREE_INIT(grid, int, int, 3)
+
+/* whether a found payload is one of the ids inserted at (x, y) */
+int check_found(int* found, long double* xs, long double* ys, long double x, long double y);
+
+/* sort ids, for qsort */
+int id_order(const void* a, const void* b);
+
+/* whether 2 lists of ids hold the same ids, once sorted */
+int same_ids(int* a, int* b, int n);
+
+int main() {
+    unsigned seed = CHECK_SEED;
+    point_t *bL = init_point(0, 0), *tR = init_point(100, 100);
+    square_t* square = init_square(bL, tR);
+    point_t** points = check_points(&seed, square, TEST_POINTS);
+    long double* xs = (long double*) malloc(sizeof(long double) * TEST_POINTS);
+    long double* ys = (long double*) malloc(sizeof(long double) * TEST_POINTS);
+    int* got = (int*) malloc(sizeof(int) * TEST_POINTS);
+    int* brute = (int*) malloc(sizeof(int) * TEST_POINTS);
+
+    // long double coordinates, every tenth point a repeat of an earlier one
+    real_tree_t* real = real_init(0, 0, 100, 100);
+    for (int i=0; i < TEST_POINTS; i++) {
+        point_t* p = (i % 10 == 9) ? points[check_rand(&seed) % i] : points[i];
+        xs[i] = p->x;
+        ys[i] = p->y;
+        CHECK(real_insert(real, xs[i], ys[i], i), "real: point %d not inserted", i);
+    }
+    CHECK(!real_insert(real, 100.5L, 50, -1) && !real_insert(real, 50, -0.5L, -1),
+          "real: point outside inserted");
+    CHECK(real->length == TEST_POINTS, "real: length %zu", real->length);
+    for (int i=0; i < TEST_POINTS; i++) {
+        int* found = real_find(real, xs[i], ys[i]);
+        CHECK(found != NULL && check_found(found, xs, ys, xs[i], ys[i]),
+              "real: point %d not found", i);
+    }
+    CHECK(real_find(real, 100.5L, 50) == NULL, "real: point outside found");
+    real_entry_t** entries = (real_entry_t**) malloc(sizeof(real_entry_t*) * TEST_POINTS);
+    for (int w=0; w < TEST_WINDOWS; w++) {
+        square_t* window = check_window(&seed, square);
+        long double xl = window->bottom_left->x, yb = window->bottom_left->y;
+        long double xr = window->top_right->x, yt = window->top_right->y;
+        size_t n = real_range(real, xl, yb, xr, yt, entries, TEST_POINTS);
+        int nbrute = 0;
+        for (int i=0; i < TEST_POINTS; i++)
+            if (xs[i] >= xl && xs[i] <= xr && ys[i] >= yb && ys[i] <= yt) brute[nbrute++] = i;
+        CHECK(n == (size_t) nbrute, "real, window %d: %zu entries, brute force finds %d",
+              w, n, nbrute);
+        for (size_t i=0; i < n && i < TEST_POINTS; i++) got[i] = entries[i]->data;
+        CHECK(n != (size_t) nbrute || same_ids(got, brute, nbrute),
+              "real, window %d: other entries than brute force", w);
+        // a short buffer still counts every entry
+        CHECK(real_range(real, xl, yb, xr, yt, entries, 1) == n,
+              "real, window %d: count past max", w);
+        free_check_square(window);
+    }
+    free(entries);
+    real_free(real);
+
+    // int coordinates, a quarter of the points at a few hot spots
+    grid_tree_t* grid = grid_init(0, 0, TEST_SIDE, TEST_SIDE);
+    int hot[TEST_HOT][2];
+    for (int h=0; h < TEST_HOT; h++) {
+        hot[h][0] = (int) (check_rand(&seed) % (TEST_SIDE + 1));
+        hot[h][1] = (int) (check_rand(&seed) % (TEST_SIDE + 1));
+    }
+    for (int i=0; i < TEST_POINTS; i++) {
+        int h = (int) (check_rand(&seed) % (4 * TEST_HOT));
+        int x = (h < TEST_HOT) ? hot[h][0] : (int) (check_rand(&seed) % (TEST_SIDE + 1));
+        int y = (h < TEST_HOT) ? hot[h][1] : (int) (check_rand(&seed) % (TEST_SIDE + 1));
+        xs[i] = x;
+        ys[i] = y;
+        CHECK(grid_insert(grid, x, y, i), "grid: point %d not inserted", i);
+    }
+    CHECK(grid->length == TEST_POINTS, "grid: length %zu", grid->length);
+    for (int i=0; i < TEST_POINTS; i++) {
+        int* found = grid_find(grid, (int) xs[i], (int) ys[i]);
+        CHECK(found != NULL && check_found(found, xs, ys, xs[i], ys[i]),
+              "grid: point %d not found", i);
+    }
+    grid_entry_t** cells = (grid_entry_t**) malloc(sizeof(grid_entry_t*) * TEST_POINTS);
+    for (int w=0; w < TEST_WINDOWS; w++) {
+        int xl = (int) (check_rand(&seed) % (TEST_SIDE + 1));
+        int yb = (int) (check_rand(&seed) % (TEST_SIDE + 1));
+        int xr = xl + (int) (check_rand(&seed) % (TEST_SIDE + 1 - xl));
+        int yt = yb + (int) (check_rand(&seed) % (TEST_SIDE + 1 - yb));
+        // every few windows is a single cell, a hot spot's when w is small
+        if (w % 5 == 0) {
+            xl = xr = (w < 5 * TEST_HOT) ? hot[w / 5][0] : xl;
+            yb = yt = (w < 5 * TEST_HOT) ? hot[w / 5][1] : yb;
+        }
+        size_t n = grid_range(grid, xl, yb, xr, yt, cells, TEST_POINTS);
+        int nbrute = 0;
+        for (int i=0; i < TEST_POINTS; i++)
+            if (xs[i] >= xl && xs[i] <= xr && ys[i] >= yb && ys[i] <= yt) brute[nbrute++] = i;
+        CHECK(n == (size_t) nbrute, "grid, window %d: %zu entries, brute force finds %d",
+              w, n, nbrute);
+        for (size_t i=0; i < n && i < TEST_POINTS; i++) got[i] = cells[i]->data;
+        CHECK(n != (size_t) nbrute || same_ids(got, brute, nbrute),
+              "grid, window %d: other entries than brute force", w);
+    }
+    free(cells);
+    grid_free(grid);
+
+    free(xs);
+    free(ys);
+    free(got);
+    free(brute);
+    free_check_points(points, TEST_POINTS);
+    free_check_square(square);
+    return check_done("generic");
+}
+
+/* whether a found payload is one of the ids inserted at (x, y) */
+int check_found(int* found, long double* xs, long double* ys, long double x, long double y) {
+    int id = *found;
+    return id >= 0 && id < TEST_POINTS && xs[id] == x && ys[id] == y;
+}
+
+/* sort ids, for qsort */
+int id_order(const void* a, const void* b) {
+    return *(int*) a - *(int*) b;
+}
+
+/* whether 2 lists of ids hold the same ids, once sorted */
+int same_ids(int* a, int* b, int n) {
+    qsort(a, n, sizeof(int), id_order);
+    qsort(b, n, sizeof(int), id_order);
+    for (int i=0; i < n; i++)
+        if (a[i] != b[i]) return 0;
+    return 1;
+}
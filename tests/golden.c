@@ -0,0 +1,289 @@
+/*
+ * Golden-output regression runner for the stage 3 / 4 fixtures:
+ *   ./qtree_golden [-t] [-r] [-H] [-b budget] fixture_dir manifest baseline
+ * Every fixture of the manifest builds the tree from its dataset, replays
+ * its .in queries and has both streams diffed against .out (footpaths) and
+ * .stdout.out (quadrants); any diff fails. With -t, the best wall time over
+ * repeated runs is then compared with the baseline, failing past budget
+ * percent slower (plus a small noise floor). Timings only mean something
+ * on the machine that recorded them, so fixtures without a baseline have
+ * theirs recorded by that first timed run. With -r, the measured times
+ * become the new baseline; with -H, footpaths are stored in Hilbert curve
+ * order before each build.
+ * Manifest lines read "name stage dataset x1 y1 x2 y2", '#' starts a comment.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "qtree.h"
+#include "footpath.h"
+#include "stage.h"
+#include "hilbert.h"
+
+#define GOLDEN_BUDGET 25          // default allowed slowdown, in percent
+#define GOLDEN_SLACK_NS 20000LL   // noise floor added to every budget
+#define GOLDEN_MIN_NS 50000000LL  // minimum time spent timing a fixture
+#define GOLDEN_MIN_RUNS 5         // minimum number of timed runs
+#define GOLDEN_MAX_RUNS 2000      // maximum number of timed runs
+#define MAX_FIXTURES 64           // maximum number of fixtures in a manifest
+#define MAX_NAME_LEN 64           // maximum length of a fixture's name
+#define MAX_PATH_LEN 512          // maximum length of a fixture path
+
+// a fixture of the manifest, along with its measured and baseline time
+typedef struct fixture {
+    char name[MAX_NAME_LEN];
+    int stage;
+    int dataset;
+    long double pos[4];
+    long long best_ns;
+    long long baseline_ns;
+} fixture_t;
+
+/* read the fixtures of a manifest, returning how many there are */
+int read_manifest(char* path, fixture_t* fixtures);
+
+/* read the baseline times of the fixtures, -1 for those without one */
+void read_baseline(char* path, fixture_t* fixtures, int n);
+
+/* write the baseline times of the fixtures */
+void write_baseline(char* path, fixture_t* fixtures, int n);
+
+/* run a fixture, checking its output and, if timed, timing it; 0 on any diff */
+int run_fixture(char* dir, fixture_t* fixture, int hilbert, int timed);
+
+/* read an entire file into memory, setting its size; NULL if unreadable */
+char* read_file(char* path, size_t* size);
+
+/* compare an output with its golden file, reporting the first difference */
+int diff_output(char* name, char* expected, size_t esize, char* actual, size_t asize);
+
+/* build the tree and answer the queries once, into memory buffers */
+void replay(fixture_t* fixture, footpath_t** fps, int n, char* in, size_t isize,
+            char** out, size_t* osize, char** path, size_t* psize);
+
+/* monotonic wall clock, in nanoseconds */
+long long now_ns();
+
+int main(int argc, char** argv) {
+    int timed = 0, record = 0, hilbert = 0, budget = GOLDEN_BUDGET, i = 1;
+    for (; i < argc && argv[i][0] == '-'; i++) {
+        if (strcmp(argv[i], "-t") == 0) timed = 1;
+        else if (strcmp(argv[i], "-r") == 0) record = timed = 1;
+        else if (strcmp(argv[i], "-H") == 0) hilbert = 1;
+        else if (strcmp(argv[i], "-b") == 0 && i+1 < argc) budget = atoi(argv[++i]);
+        else break;
+    }
+    if (argc - i != 3) {
+        fprintf(stderr, "usage: %s [-t] [-r] [-H] [-b budget] fixture_dir manifest baseline\n",
+                argv[0]);
+        return EXIT_FAILURE;
+    }
+    char *dir = argv[i], *manifest = argv[i+1], *baseline = argv[i+2];
+
+    fixture_t fixtures[MAX_FIXTURES];
+    int n = read_manifest(manifest, fixtures);
+    if (n == 0) {
+        fprintf(stderr, "ERROR: no fixtures in %s\n", manifest);
+        return EXIT_FAILURE;
+    }
+    read_baseline(baseline, fixtures, n);
+
+    int failures = 0, recorded = 0;
+    for (int j=0; j < n; j++) {
+        fixture_t* f = &fixtures[j];
+        if (!run_fixture(dir, f, hilbert, timed)) {
+            failures++;
+            continue;
+        }
+        if (!timed) {
+            printf("%-8s ok\n", f->name);
+            continue;
+        }
+        if (record || f->baseline_ns < 0) {
+            printf("%-8s ok   %10.1fus%s\n", f->name, f->best_ns / 1e3,
+                   record ? "" : "  (baseline recorded)");
+            f->baseline_ns = f->best_ns;
+            recorded++;
+            continue;
+        }
+        long long limit = f->baseline_ns + f->baseline_ns * budget / 100 + GOLDEN_SLACK_NS;
+        int slow = f->best_ns > limit;
+        printf("%-8s %s %10.1fus  baseline %10.1fus  %+6.1f%%\n", f->name,
+               slow ? "SLOW" : "ok  ", f->best_ns / 1e3, f->baseline_ns / 1e3,
+               100.0 * (f->best_ns - f->baseline_ns) / f->baseline_ns);
+        failures += slow;
+    }
+    if (recorded && failures == 0)
+        write_baseline(baseline, fixtures, n);
+    if (failures)
+        printf("%d of %d fixtures failed (budget %d%%)\n", failures, n, budget);
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+/* run a fixture, checking its output and, if timed, timing it; 0 on any diff */
+int run_fixture(char* dir, fixture_t* fixture, int hilbert, int timed) {
+    char path[MAX_PATH_LEN];
+    size_t isize = 0, esize = 0, psize_expected = 0;
+    char* ext = (fixture->stage == STAGE_POINT) ? "s3" : "s4";
+
+    // dataset, queries and golden outputs
+    snprintf(path, MAX_PATH_LEN, "%s/dataset_%d.csv", dir, fixture->dataset);
+    FILE* data = fopen(path, "r");
+    snprintf(path, MAX_PATH_LEN, "%s/%s.%s.in", dir, fixture->name, ext);
+    char* in = read_file(path, &isize);
+    snprintf(path, MAX_PATH_LEN, "%s/%s.%s.out", dir, fixture->name, ext);
+    char* expected = read_file(path, &esize);
+    snprintf(path, MAX_PATH_LEN, "%s/%s.%s.stdout.out", dir, fixture->name, ext);
+    char* path_expected = read_file(path, &psize_expected);
+    if (data == NULL || in == NULL || expected == NULL || path_expected == NULL) {
+        printf("%-8s FAIL missing dataset or fixture files\n", fixture->name);
+        if (data) fclose(data);
+        free(in); free(expected); free(path_expected);
+        return 0;
+    }
+    int n;
+    footpath_t** fps = read_footpaths(data, &n);
+    fclose(data);
+    if (hilbert) {
+        point_t bL = {.x = fixture->pos[0], .y = fixture->pos[1]};
+        point_t tR = {.x = fixture->pos[2], .y = fixture->pos[3]};
+        square_t square = {.bottom_left = &bL, .top_right = &tR};
+        fps = hilbert_footpaths(fps, n, &square);
+    }
+
+    // first run checks the output, the rest (if timed) only time it
+    char *out, *path_out;
+    size_t osize, psize;
+    int ok = 1, runs = 0;
+    long long total = 0;
+    fixture->best_ns = -1;
+    do {
+        long long start = now_ns();
+        replay(fixture, fps, n, in, isize, &out, &osize, &path_out, &psize);
+        long long elapsed = now_ns() - start;
+        if (runs == 0) {
+            ok = diff_output(fixture->name, expected, esize, out, osize) &&
+                 diff_output(fixture->name, path_expected, psize_expected, path_out, psize);
+        }
+        free(out);
+        free(path_out);
+        if (fixture->best_ns < 0 || elapsed < fixture->best_ns)
+            fixture->best_ns = elapsed;
+        total += elapsed;
+        runs++;
+    } while (ok && timed && runs < GOLDEN_MAX_RUNS &&
+             (runs < GOLDEN_MIN_RUNS || total < GOLDEN_MIN_NS));
+
+    if (hilbert) free_packed_footpaths(fps, n);
+    else free_footpaths(fps, n);
+    free(in); free(expected); free(path_expected);
+    return ok;
+}
+
+/* build the tree and answer the queries once, into memory buffers */
+void replay(fixture_t* fixture, footpath_t** fps, int n, char* in, size_t isize,
+            char** out, size_t* osize, char** path, size_t* psize) {
+    point_t bL = {.x = fixture->pos[0], .y = fixture->pos[1]};
+    point_t tR = {.x = fixture->pos[2], .y = fixture->pos[3]};
+    FILE* fin = fmemopen(in, isize, "r");
+    FILE* fout = open_memstream(out, osize);
+    FILE* fpath = open_memstream(path, psize);
+    qtnode_t* tree = footpath_tree(fps, n, init_square(&bL, &tR));
+    stage_query(tree, fixture->stage, fin, fout, fpath);
+    free_tree(tree);
+    fclose(fin);
+    fclose(fout);
+    fclose(fpath);
+}
+
+/* compare an output with its golden file, reporting the first difference */
+int diff_output(char* name, char* expected, size_t esize, char* actual, size_t asize) {
+    if (esize == asize && memcmp(expected, actual, esize) == 0)
+        return 1;
+    size_t i = 0, line = 1, start = 0;
+    while (i < esize && i < asize && expected[i] == actual[i]) {
+        if (expected[i++] == '\n') {
+            line++;
+            start = i;
+        }
+    }
+    int elen = (int) strcspn(expected + start, "\n");
+    int alen = (int) strcspn(actual + start, "\n");
+    printf("%-8s FAIL line %zu differs\n  expected: %.*s\n  actual:   %.*s\n",
+           name, line, elen, expected + start, alen, actual + start);
+    return 0;
+}
+
+/* read the fixtures of a manifest, returning how many there are */
+int read_manifest(char* path, fixture_t* fixtures) {
+    FILE* f = fopen(path, "r");
+    if (f == NULL) return 0;
+    char line[MAX_PATH_LEN];
+    int n = 0;
+    while (n < MAX_FIXTURES && fgets(line, MAX_PATH_LEN, f) != NULL) {
+        fixture_t* fx = &fixtures[n];
+        if (line[0] == '#') continue;
+        if (sscanf(line, "%63s %d %d %Lf %Lf %Lf %Lf", fx->name, &fx->stage, &fx->dataset,
+                   &fx->pos[0], &fx->pos[1], &fx->pos[2], &fx->pos[3]) != 7)
+            continue;
+        fx->baseline_ns = -1;
+        n++;
+    }
+    fclose(f);
+    return n;
+}
+
+/* read the baseline times of the fixtures, -1 for those without one */
+void read_baseline(char* path, fixture_t* fixtures, int n) {
+    FILE* f = fopen(path, "r");
+    if (f == NULL) return;
+    char line[MAX_PATH_LEN], name[MAX_NAME_LEN];
+    long long ns;
+    while (fgets(line, MAX_PATH_LEN, f) != NULL) {
+        if (line[0] == '#' || sscanf(line, "%63s %lld", name, &ns) != 2)
+            continue;
+        for (int i=0; i < n; i++)
+            if (strcmp(fixtures[i].name, name) == 0) fixtures[i].baseline_ns = ns;
+    }
+    fclose(f);
+}
+
+/* write the baseline times of the fixtures */
+void write_baseline(char* path, fixture_t* fixtures, int n) {
+    FILE* f = fopen(path, "w");
+    if (f == NULL) {
+        fprintf(stderr, "ERROR: cannot write %s\n", path);
+        exit(EXIT_FAILURE);
+    }
+    fprintf(f, "# best wall time of each fixture in ns, written by qtree_golden\n");
+    for (int i=0; i < n; i++)
+        if (fixtures[i].baseline_ns >= 0)
+            fprintf(f, "%s %lld\n", fixtures[i].name, fixtures[i].baseline_ns);
+    fclose(f);
+    printf("baseline written to %s\n", path);
+}
+
+/* read an entire file into memory, setting its size; NULL if unreadable */
+char* read_file(char* path, size_t* size) {
+    FILE* f = fopen(path, "rb");
+    if (f == NULL) return NULL;
+    fseek(f, 0, SEEK_END);
+    long length = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    char* buf = (char*) malloc(length + 1);
+    *size = fread(buf, 1, length, f);
+    buf[*size] = '\0';
+    fclose(f);
+    return buf;
+}
+
+/* monotonic wall clock, in nanoseconds */
+long long now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
@@ -0,0 +1,97 @@
+/*
+ * Spatial join test: joins 2 random trees, over overlapping squares, at
+ * several distances, checking the pairs reported against a nested loop
+ * over every pair of points. The callback runs on the pool's workers, so
+ * pairs are collected under a lock.
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <pthread.h>
+#include "check.h"
+#include "join.h"
+
+#define TEST_POINTS 1500  // points in each tree
+
+// pairs reported by the join
+typedef struct pairs {
+    pthread_mutex_t lock;
+    point_t** pairs;
+    int length;
+    int capacity;
+} pairs_t;
+
+/* join callback collecting a pair */
+void collect_pair(point_t* a, point_t* b, void* data);
+
+/* add a pair to the collection */
+void add_pair(pairs_t* pairs, point_t* a, point_t* b);
+
+/* pair comparison by the address of a, then of b, for qsort */
+int pair_cmp(const void* p1, const void* p2);
+
+int main() {
+    unsigned seed = CHECK_SEED;
+    point_t *bLA = init_point(0, 0), *tRA = init_point(100, 100);
+    point_t *bLB = init_point(40, 30), *tRB = init_point(140, 130);
+    square_t *squareA = init_square(bLA, tRA), *squareB = init_square(bLB, tRB);
+    qtnode_t *treeA = init_tree(squareA), *treeB = init_tree(squareB);
+    point_t** pointsA = check_points(&seed, squareA, TEST_POINTS);
+    point_t** pointsB = check_points(&seed, squareB, TEST_POINTS);
+    for (int i=0; i < TEST_POINTS; i++) {
+        insert(treeA, pointsA[i]);
+        insert(treeB, pointsB[i]);
+    }
+
+    long double distances[] = {0, 0.5, 3, 25};
+    for (int t=0; t < 4; t++) {
+        long double d = distances[t];
+        pairs_t joined = {PTHREAD_MUTEX_INITIALIZER, NULL, 0, 0};
+        pairs_t brute = {PTHREAD_MUTEX_INITIALIZER, NULL, 0, 0};
+        spatial_join(treeA, treeB, d, collect_pair, &joined);
+        for (int i=0; i < TEST_POINTS; i++)
+            for (int j=0; j < TEST_POINTS; j++)
+                if (point_dist2(pointsA[i], pointsB[j]) <= d * d)
+                    add_pair(&brute, pointsA[i], pointsB[j]);
+        if (joined.length) qsort(joined.pairs, joined.length / 2, 2 * sizeof(point_t*), pair_cmp);
+        if (brute.length) qsort(brute.pairs, brute.length / 2, 2 * sizeof(point_t*), pair_cmp);
+        CHECK(joined.length == brute.length, "d = %Lf: %d pairs, nested loop finds %d",
+              d, joined.length / 2, brute.length / 2);
+        for (int i=0; i < joined.length && joined.length == brute.length; i++)
+            CHECK(joined.pairs[i] == brute.pairs[i], "d = %Lf: pair %d differs", d, i / 2);
+        free(joined.pairs);
+        free(brute.pairs);
+    }
+    free_tree(treeA);
+    free_tree(treeB);
+    free(bLA); free(tRA); free(bLB); free(tRB);
+    free_check_points(pointsA, TEST_POINTS);
+    free_check_points(pointsB, TEST_POINTS);
+    return check_done("join");
+}
+
+/* join callback collecting a pair */
+void collect_pair(point_t* a, point_t* b, void* data) {
+    pairs_t* pairs = (pairs_t*) data;
+    pthread_mutex_lock(&pairs->lock);
+    add_pair(pairs, a, b);
+    pthread_mutex_unlock(&pairs->lock);
+}
+
+/* add a pair to the collection */
+void add_pair(pairs_t* pairs, point_t* a, point_t* b) {
+    if (pairs->length + 2 > pairs->capacity) {
+        pairs->capacity = pairs->capacity ? pairs->capacity * 2 : 256;
+        pairs->pairs = (point_t**) realloc(pairs->pairs, sizeof(point_t*) * pairs->capacity);
+    }
+    pairs->pairs[pairs->length++] = a;
+    pairs->pairs[pairs->length++] = b;
+}
+
+/* pair comparison by the address of a, then of b, for qsort */
+int pair_cmp(const void* p1, const void* p2) {
+    uintptr_t a1 = (uintptr_t) ((point_t**) p1)[0], b1 = (uintptr_t) ((point_t**) p1)[1];
+    uintptr_t a2 = (uintptr_t) ((point_t**) p2)[0], b2 = (uintptr_t) ((point_t**) p2)[1];
+    if (a1 != a2) return (a1 > a2) - (a1 < a2);
+    return (b1 > b2) - (b1 < b2);
+}
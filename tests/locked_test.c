@@ -0,0 +1,112 @@
+/*
+ * Locked tree test: builds a tree from random points, a few of them
+ * inserted twice and a half clustered so that writers meet, with
+ * parallel_insert over several thread counts, and checks it against a
+ * serial build of the same points. As a point's place in the tree does not
+ * depend on insertion order, both trees must have the same shape, the same
+ * points with the same categories, and the same range results in
+ * search_range's order. A tree built by many calls of parallel_insert with
+ * many threads, more writers in all than one tree may register, must be
+ * the same again.
+ */
+
+#include <stdlib.h>
+#include "check.h"
+#include "locked.h"
+
+#define TEST_POINTS 20000  // points in each tree
+#define TEST_WINDOWS 200   // windows searched in each tree
+#define TEST_BUILDS 4      // parallel builds, with 1, 2, 4 and 8 threads
+#define TEST_CALLS 5       // parallel_insert calls building one tree
+#define TEST_THREADS 64    // threads of each of those calls
+
+/* count the nodes of a that differ from b in children, point or categories */
+int count_differences(qtnode_t* a, qtnode_t* b);
+
+int main() {
+    unsigned seed = CHECK_SEED;
+    point_t *bL = init_point(0, 0), *tR = init_point(100, 100);
+    square_t* square = init_square(bL, tR);
+    point_t** points = check_points(&seed, square, TEST_POINTS);
+    for (int i=0; i < TEST_POINTS; i++) {
+        if (i % 10 == 9) {
+            point_t* earlier = points[check_rand(&seed) % i];
+            points[i]->x = earlier->x;
+            points[i]->y = earlier->y;
+        }
+        points[i]->category = (category_t) 1 << (i % 8);
+    }
+    qtnode_t* serial = init_tree(square);
+    for (int i=0; i < TEST_POINTS; i++)
+        insert(serial, points[i]);
+
+    point_t** expected = (point_t**) malloc(sizeof(point_t*) * TEST_POINTS);
+    point_t** found = (point_t**) malloc(sizeof(point_t*) * TEST_POINTS);
+    for (int b=0; b < TEST_BUILDS; b++) {
+        int nthreads = 1 << b;
+        locked_tree_t* locked = init_locked_tree(init_square(bL, tR));
+        parallel_insert(locked, points, TEST_POINTS, nthreads);
+        qtnode_t* tree = locked->root;
+        for (int i=0; i < TEST_POINTS; i++)
+            CHECK(points[i]->category == (category_t) 1 << (i % 8),
+                  "%d threads, point %d: categories changed", nthreads, i);
+        CHECK(tree->categories == serial->categories, "%d threads: root categories %llx",
+              nthreads, (unsigned long long) tree->categories);
+        int differences = count_differences(tree, serial);
+        CHECK(differences == 0, "%d threads: %d nodes differ", nthreads, differences);
+
+        for (int i=0; i < TEST_POINTS; i++) {
+            point_t query = {.x = points[i]->x, .y = points[i]->y};
+            point_t* stored = find_pt(tree, &query);
+            CHECK(stored != NULL && point_cmp(stored, &query) &&
+                  stored->category == find_pt(serial, &query)->category,
+                  "%d threads, point %d: not found", nthreads, i);
+        }
+        for (int w=0; w < TEST_WINDOWS; w++) {
+            square_t* window = check_window(&seed, square);
+            int n = check_range_order(serial, window, expected);
+            int nfound = check_range_order(tree, window, found);
+            CHECK(nfound == n, "%d threads, window %d: %d points, expected %d",
+                  nthreads, w, nfound, n);
+            for (int i=0; i < n && i < nfound; i++)
+                CHECK(point_cmp(found[i], expected[i]), "%d threads, window %d: point %d differs",
+                      nthreads, w, i);
+            free_check_square(window);
+        }
+        free_locked_tree(locked);
+    }
+
+    // many calls, each inserting a slice with many threads
+    locked_tree_t* locked = init_locked_tree(init_square(bL, tR));
+    for (int c=0; c < TEST_CALLS; c++) {
+        int from = TEST_POINTS * c / TEST_CALLS, to = TEST_POINTS * (c+1) / TEST_CALLS;
+        parallel_insert(locked, points + from, to - from, TEST_THREADS);
+    }
+    CHECK(locked->nwriters == TEST_THREADS, "%d calls: %d writers registered", TEST_CALLS,
+          locked->nwriters);
+    int differences = count_differences(locked->root, serial);
+    CHECK(differences == 0, "%d calls: %d nodes differ", TEST_CALLS, differences);
+    free_locked_tree(locked);
+
+    free(expected);
+    free(found);
+    free_tree(serial);
+    free(bL);
+    free(tR);
+    free_check_points(points, TEST_POINTS);
+    return check_done("locked");
+}
+
+/* count the nodes of a that differ from b in children, point or categories */
+int count_differences(qtnode_t* a, qtnode_t* b) {
+    if (a->occupied != b->occupied || a->categories != b->categories) return 1;
+    if (IS_LEAF(a))
+        return (a->point == NULL) != (b->point == NULL) ||
+               (a->point != NULL && (!point_cmp(a->point, b->point) ||
+                                     a->point->category != b->point->category));
+    int differences = 0;
+    for (enum quadrant q = sw; q <= se; q++)
+        if (HAS_CHILD(a, q))
+            differences += count_differences(get_child(a, q), get_child(b, q));
+    return differences;
+}
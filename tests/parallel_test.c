@@ -0,0 +1,193 @@
+/*
+ * Work-stealing test: checks the deque alone, then with thieves stealing
+ * while its owner pushes and takes, every task coming out exactly once;
+ * the pool running tasks that submit tasks of their own; and parallel
+ * range search on pools of several sizes over a tree with most of its
+ * points in one corner, whose results must be search_range's, in its
+ * order.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include "check.h"
+#include "deque.h"
+#include "pool.h"
+#include "parallel.h"
+
+#define TEST_TASKS 20000   // tasks pushed through the deque, past its first buffer
+#define TEST_THIEVES 3     // threads stealing from the deque
+#define TEST_FANOUT 4      // tasks each pool task submits, down to TEST_DEPTH
+#define TEST_DEPTH 5       // levels of tasks submitted by tasks
+#define TEST_POINTS 50000  // points in the searched tree
+#define TEST_WINDOWS 100   // windows searched on each pool
+#define TEST_POOLS 3       // pools, of 1, 2 and 4 threads
+
+// a deque to steal from, until its owner stops
+typedef struct thief {
+    deque_t* deque;
+    int* stop;
+} thief_t;
+
+// a task of the pool test, at index in a complete tree of ntasks tasks
+typedef struct nested {
+    pool_t* pool;
+    int index;
+    int ntasks;
+    int* runs;
+    struct nested* all;
+} nested_t;
+
+// how many times each task pushed to the deque ran, for mark_task, as a
+// task's only argument is its index
+static int* taken;
+
+/* steal from the deque until the owner is done and it is empty */
+void* steal_tasks(void* arg);
+
+/* the i-th task pushed to the deque, counting its run in taken[i] */
+void mark_task(void* arg);
+
+/* pool entry counting its run and submitting its children */
+void nested_run(void* arg);
+
+int main() {
+    unsigned seed = CHECK_SEED;
+
+    // alone, the owner takes newest first and a thief steals oldest first
+    deque_t* deque = init_deque();
+    task_t task;
+    CHECK(deque_take(deque, &task) == DEQUE_EMPTY, "task taken from an empty deque");
+    for (intptr_t i=0; i < 3 * DEQUE_INIT_CAP; i++)
+        deque_push(deque, mark_task, (void*) i);
+    CHECK(deque_size(deque) == 3 * DEQUE_INIT_CAP, "%lld tasks in the deque",
+          (long long) deque_size(deque));
+    for (intptr_t i=0; i < DEQUE_INIT_CAP; i++)
+        CHECK(deque_steal(deque, &task) == DEQUE_TAKEN && (intptr_t) task.arg == i,
+              "steal %d: other task", (int) i);
+    for (intptr_t i=3 * DEQUE_INIT_CAP - 1; i >= DEQUE_INIT_CAP; i--)
+        CHECK(deque_take(deque, &task) == DEQUE_TAKEN && (intptr_t) task.arg == i,
+              "take %d: other task", (int) i);
+    CHECK(deque_steal(deque, &task) == DEQUE_EMPTY, "task stolen from an empty deque");
+    free_deque(deque);
+
+    // with thieves, every task comes out once, to the owner or to a thief
+    deque = init_deque();
+    taken = (int*) calloc(TEST_TASKS, sizeof(int));
+    int stop = 0;
+    thief_t thief = {.deque = deque, .stop = &stop};
+    pthread_t thieves[TEST_THIEVES];
+    for (int t=0; t < TEST_THIEVES; t++)
+        pthread_create(&thieves[t], NULL, steal_tasks, &thief);
+    for (intptr_t i=0; i < TEST_TASKS; i++) {
+        deque_push(deque, mark_task, (void*) i);
+        if (i % 3 == 0 && deque_take(deque, &task) == DEQUE_TAKEN)
+            task.fn(task.arg);
+    }
+    while (deque_take(deque, &task) == DEQUE_TAKEN)
+        task.fn(task.arg);
+    __atomic_store_n(&stop, 1, __ATOMIC_RELEASE);
+    for (int t=0; t < TEST_THIEVES; t++)
+        pthread_join(thieves[t], NULL);
+    for (int i=0; i < TEST_TASKS; i++)
+        CHECK(taken[i] == 1, "task %d came out %d times", i, taken[i]);
+    free(taken);
+    free_deque(deque);
+
+    // tasks submitted by tasks all run once, on every pool size
+    int ntasks = 0;
+    for (int d=0, level=1; d <= TEST_DEPTH; d++, level *= TEST_FANOUT) ntasks += level;
+    nested_t* nested = (nested_t*) malloc(sizeof(nested_t) * ntasks);
+    int* runs = (int*) malloc(sizeof(int) * ntasks);
+    for (int p=0; p < TEST_POOLS; p++) {
+        pool_t* pool = init_pool(1 << p);
+        for (int round=0; round < 2; round++) {
+            for (int i=0; i < ntasks; i++) {
+                nested[i] = (nested_t) {.pool = pool, .index = i, .ntasks = ntasks,
+                                        .runs = runs, .all = nested};
+                runs[i] = 0;
+            }
+            pool_submit(pool, nested_run, &nested[0]);
+            pool_wait(pool);
+            for (int i=0; i < ntasks; i++)
+                CHECK(runs[i] == 1, "%d threads, round %d: task %d ran %d times",
+                      1 << p, round, i, runs[i]);
+        }
+        free_pool(pool);
+    }
+    free(nested);
+    free(runs);
+
+    // parallel range search over a skewed tree, in search_range's order
+    point_t *bL = init_point(0, 0), *tR = init_point(100, 100);
+    square_t* square = init_square(bL, tR);
+    qtnode_t* tree = init_tree(square);
+    point_t** points = check_points(&seed, square, TEST_POINTS);
+    for (int i=0; i < TEST_POINTS; i++) {
+        // 3 points in 4 in the bottom left corner
+        if (i % 4 != 0) {
+            points[i]->x /= 16;
+            points[i]->y /= 16;
+        }
+        insert(tree, points[i]);
+    }
+    point_t** expected = (point_t**) malloc(sizeof(point_t*) * TEST_POINTS);
+    for (int p=0; p < TEST_POOLS; p++) {
+        pool_t* pool = init_pool(1 << p);
+        for (int w=0; w < TEST_WINDOWS; w++) {
+            // every other window is within the corner
+            square_t* window = check_window(&seed, square);
+            if (w % 2 == 0) {
+                window->bottom_left->x /= 16;
+                window->bottom_left->y /= 16;
+                window->top_right->x /= 16;
+                window->top_right->y /= 16;
+            }
+            int n = check_range_order(tree, window, expected);
+            point_t** found;
+            int nfound = parallel_range(pool, tree, window, &found);
+            CHECK(nfound == n, "%d threads, window %d: %d points, expected %d",
+                  1 << p, w, nfound, n);
+            for (int i=0; i < n && i < nfound; i++)
+                CHECK(found[i] == expected[i], "%d threads, window %d: point %d out of order",
+                      1 << p, w, i);
+            free(found);
+            free_check_square(window);
+        }
+        free_pool(pool);
+    }
+    free(expected);
+    free_tree(tree);
+    free(bL);
+    free(tR);
+    free_check_points(points, TEST_POINTS);
+    return check_done("parallel");
+}
+
+/* steal from the deque until the owner is done and it is empty */
+void* steal_tasks(void* arg) {
+    thief_t* thief = (thief_t*) arg;
+    task_t task;
+    for (;;) {
+        int stop = __atomic_load_n(thief->stop, __ATOMIC_ACQUIRE);
+        int result = deque_steal(thief->deque, &task);
+        if (result == DEQUE_TAKEN) task.fn(task.arg);
+        else if (result == DEQUE_EMPTY && stop) break;
+    }
+    return NULL;
+}
+
+/* the i-th task pushed to the deque, counting its run in taken[i] */
+void mark_task(void* arg) {
+    __atomic_add_fetch(&taken[(intptr_t) arg], 1, __ATOMIC_RELAXED);
+}
+
+/* pool entry counting its run and submitting its children */
+void nested_run(void* arg) {
+    nested_t* task = (nested_t*) arg;
+    __atomic_add_fetch(&task->runs[task->index], 1, __ATOMIC_RELAXED);
+    for (int c=1; c <= TEST_FANOUT; c++) {
+        int child = task->index * TEST_FANOUT + c;
+        if (child < task->ntasks) pool_submit(task->pool, nested_run, &task->all[child]);
+    }
+}
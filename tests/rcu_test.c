@@ -0,0 +1,147 @@
+/*
+ * RCU tree test: over many rounds, starts reader threads on an empty tree
+ * and only then has the writer insert random points, a few of them twice,
+ * so that readers are already searching when the root leaf splits. Every
+ * point published before a search must be found by it, and a window's
+ * range count must never drop. Once the readers are done, point and range
+ * search must match a plain tree built from the same points.
+ */
+
+#include <stdlib.h>
+#include <sched.h>
+#include <pthread.h>
+#include "check.h"
+#include "rcu.h"
+
+#define TEST_ROUNDS 100    // fresh trees, each built while readers search
+#define TEST_POINTS 2000   // points inserted in each round
+#define TEST_READERS 4     // reader threads
+#define TEST_EARLY 16      // first insertions after which the writer yields
+#define TEST_WINDOWS 20    // windows the readers count over and over
+
+// what a reader thread shares with the writer, and what it saw
+typedef struct reader {
+    rcu_tree_t* rcu;
+    point_t** points;
+    square_t** windows;
+    int* published;
+    int* started;
+    int* done;
+    unsigned seed;
+    long searches;
+    long missing;
+    long shrunk;
+} reader_t;
+
+/* search for published points and count windows until the writer is done */
+void* read_tree(void* arg);
+
+int main() {
+    unsigned seed = CHECK_SEED;
+    point_t *bL = init_point(0, 0), *tR = init_point(100, 100);
+    square_t* square = init_square(bL, tR);
+    square_t* windows[TEST_WINDOWS];
+    for (int w=0; w < TEST_WINDOWS; w++)
+        windows[w] = check_window(&seed, square);
+    point_t** expected = (point_t**) malloc(sizeof(point_t*) * TEST_POINTS);
+    point_t** found = (point_t**) malloc(sizeof(point_t*) * TEST_POINTS);
+
+    for (int r=0; r < TEST_ROUNDS; r++) {
+        point_t** points = check_points(&seed, square, TEST_POINTS);
+        for (int i=0; i < TEST_POINTS; i++) {
+            if (i % 10 == 9) {
+                point_t* earlier = points[check_rand(&seed) % i];
+                points[i]->x = earlier->x;
+                points[i]->y = earlier->y;
+            }
+            points[i]->category = (category_t) 1 << (i % 8);
+        }
+        rcu_tree_t* rcu = init_rcu_tree(init_square(bL, tR));
+        int published = 0, started = 0, done = 0;
+        pthread_t threads[TEST_READERS];
+        reader_t readers[TEST_READERS];
+        for (int t=0; t < TEST_READERS; t++) {
+            readers[t] = (reader_t) {.rcu = rcu, .points = points, .windows = windows,
+                                     .published = &published, .started = &started,
+                                     .done = &done, .seed = check_rand(&seed)};
+            pthread_create(&threads[t], NULL, read_tree, &readers[t]);
+        }
+        // the writer starts once every reader is running
+        while (__atomic_load_n(&started, __ATOMIC_ACQUIRE) < TEST_READERS)
+            sched_yield();
+        for (int i=0; i < TEST_POINTS; i++) {
+            rcu_insert(rcu, points[i]);
+            __atomic_store_n(&published, i + 1, __ATOMIC_RELEASE);
+            if (i < TEST_EARLY) sched_yield();
+        }
+        __atomic_store_n(&done, 1, __ATOMIC_RELEASE);
+        for (int t=0; t < TEST_READERS; t++) {
+            pthread_join(threads[t], NULL);
+            CHECK(readers[t].searches > 0, "round %d, reader %d: no search", r, t);
+            CHECK(readers[t].missing == 0, "round %d, reader %d: %ld published points missed",
+                  r, t, readers[t].missing);
+            CHECK(readers[t].shrunk == 0, "round %d, reader %d: %ld range counts dropped",
+                  r, t, readers[t].shrunk);
+        }
+
+        // once quiet, the tree holds what a plain tree does, in its order
+        qtnode_t* tree = init_tree(init_square(bL, tR));
+        for (int i=0; i < TEST_POINTS; i++)
+            insert(tree, points[i]);
+        int reader = rcu_register(rcu);
+        for (int i=0; i < TEST_POINTS; i++) {
+            point_t query = {.x = points[i]->x, .y = points[i]->y};
+            point_t* stored = rcu_find_pt(rcu, reader, &query);
+            CHECK(stored != NULL && point_cmp(stored, &query) &&
+                  stored->category == find_pt(tree, &query)->category,
+                  "round %d: point %d not found", r, i);
+        }
+        for (int w=0; w < TEST_WINDOWS; w++) {
+            int n = check_range_order(tree, windows[w], expected);
+            int nfound = rcu_range(rcu, reader, windows[w], found, TEST_POINTS);
+            CHECK(nfound == n, "round %d, window %d: %d points, expected %d", r, w, nfound, n);
+            for (int i=0; i < n && i < nfound; i++)
+                CHECK(point_cmp(found[i], expected[i]), "round %d, window %d: point %d differs",
+                      r, w, i);
+        }
+        free_tree(tree);
+        free_rcu_tree(rcu);
+        free_check_points(points, TEST_POINTS);
+    }
+    free(expected);
+    free(found);
+    for (int w=0; w < TEST_WINDOWS; w++) free_check_square(windows[w]);
+    free_check_square(square);
+    return check_done("rcu");
+}
+
+/* search for published points and count windows until the writer is done */
+void* read_tree(void* arg) {
+    reader_t* r = (reader_t*) arg;
+    int reader = rcu_register(r->rcu);
+    int last[TEST_WINDOWS] = {0};
+    point_t** out = (point_t**) malloc(sizeof(point_t*) * TEST_POINTS);
+    __atomic_add_fetch(r->started, 1, __ATOMIC_RELEASE);
+    while (!__atomic_load_n(r->done, __ATOMIC_ACQUIRE)) {
+        int published = __atomic_load_n(r->published, __ATOMIC_ACQUIRE);
+        if (published == 0) {
+            sched_yield();
+            continue;
+        }
+        r->searches++;
+        // the point is copied, as the search may snap it to the grid
+        point_t* point = r->points[check_rand(&r->seed) % published];
+        point_t query = {.x = point->x, .y = point->y};
+        point_t* stored = rcu_find_pt(r->rcu, reader, &query);
+        if (stored == NULL || !point_cmp(stored, &query)) r->missing++;
+        if (r->searches % 8 != 0) continue;
+        int w = (int) (check_rand(&r->seed) % TEST_WINDOWS);
+        point_t bottom_left = *r->windows[w]->bottom_left, top_right = *r->windows[w]->top_right;
+        square_t window = {.bottom_left = &bottom_left, .top_right = &top_right};
+        int n = rcu_range(r->rcu, reader, &window, out, TEST_POINTS);
+        if (n < last[w]) r->shrunk++;
+        last[w] = n;
+    }
+    free(out);
+    return NULL;
+}
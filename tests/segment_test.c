@@ -0,0 +1,143 @@
+/*
+ * Segment index test: indexes the start-end lines of a footpath dataset,
+ * then random segments, and checks seg_search_range over random windows
+ * against testing every segment with orientation tests, independently of
+ * the index's Liang-Barsky clipping. Each segment must be reported once.
+ */
+
+#include <stdlib.h>
+#include "check.h"
+#include "segment.h"
+#include "footpath.h"
+
+#define TEST_DATASET QTREE_DATA_DIR "/dataset_1000.csv"
+#define TEST_SEGMENTS 3000  // random segments added after the footpaths
+#define TEST_WINDOWS 300    // windows searched
+
+/* whether a segment meets a rectangle: an end inside, or crossing an edge */
+int brute_intersect(square_t* rectangle, point_t* a, point_t* b);
+
+/* whether segments ab and cd share a point */
+int segments_cross(point_t* a, point_t* b, point_t* c, point_t* d);
+
+/* sign of the turn from ab to ac */
+int orientation(point_t* a, point_t* b, point_t* c);
+
+int main() {
+    unsigned seed = CHECK_SEED;
+    FILE* data = fopen(TEST_DATASET, "r");
+    if (data == NULL) {
+        fprintf(stderr, "Cannot open %s!\n", TEST_DATASET);
+        return EXIT_FAILURE;
+    }
+    int nfps;
+    footpath_t** fps = read_footpaths(data, &nfps);
+    fclose(data);
+
+    // the bounding square of every footpath
+    long double x0 = fps[0]->start_lon, x1 = x0, y0 = fps[0]->start_lat, y1 = y0;
+    for (int i=0; i < nfps; i++) {
+        long double xs[2] = {fps[i]->start_lon, fps[i]->end_lon};
+        long double ys[2] = {fps[i]->start_lat, fps[i]->end_lat};
+        for (int j=0; j < 2; j++) {
+            x0 = (xs[j] < x0) ? xs[j] : x0; x1 = (xs[j] > x1) ? xs[j] : x1;
+            y0 = (ys[j] < y0) ? ys[j] : y0; y1 = (ys[j] > y1) ? ys[j] : y1;
+        }
+    }
+    long double side = (x1 - x0 > y1 - y0) ? x1 - x0 : y1 - y0;
+    point_t *bL = init_point(x0, y0), *tR = init_point(x0 + side, y0 + side);
+    square_t* square = init_square(bL, tR);
+
+    int n = nfps + TEST_SEGMENTS;
+    point_t** starts = (point_t**) malloc(sizeof(point_t*) * n);
+    point_t** ends = (point_t**) malloc(sizeof(point_t*) * n);
+    for (int i=0; i < nfps; i++) {
+        starts[i] = init_point(fps[i]->start_lon, fps[i]->start_lat);
+        ends[i] = init_point(fps[i]->end_lon, fps[i]->end_lat);
+    }
+    // random segments from a point to a nearby one, a few of them points
+    point_t** from = check_points(&seed, square, TEST_SEGMENTS);
+    for (int i=0; i < TEST_SEGMENTS; i++) {
+        long double reach = side * check_uniform(&seed, 0, 0.2L) * (i % 10 != 0);
+        starts[nfps + i] = from[i];
+        ends[nfps + i] = init_point(from[i]->x + check_uniform(&seed, -reach, reach),
+                                    from[i]->y + check_uniform(&seed, -reach, reach));
+    }
+    free(from);
+
+    seg_tree_t* tree = init_seg_tree(square, SEG_THRESHOLD);
+    for (int i=0; i < n; i++)
+        CHECK(seg_insert(tree, starts[i], ends[i]) == i, "segment %d got another id", i);
+
+    char* seen = (char*) malloc(n);
+    for (int w=0; w < TEST_WINDOWS; w++) {
+        square_t* window = check_window(&seed, square);
+        int* found;
+        int nfound = seg_search_range(tree, window, &found);
+        for (int i=0; i < n; i++) seen[i] = 0;
+        for (int i=0; i < nfound; i++) {
+            CHECK(found[i] >= 0 && found[i] < n, "window %d: bad id %d", w, found[i]);
+            if (found[i] < 0 || found[i] >= n) continue;
+            CHECK(!seen[found[i]], "window %d: segment %d reported twice", w, found[i]);
+            seen[found[i]] = 1;
+        }
+        for (int i=0; i < n; i++) {
+            int expected = brute_intersect(window, starts[i], ends[i]);
+            CHECK(seen[i] == expected, "window %d: segment %d %s", w, i,
+                  expected ? "missed" : "reported outside");
+        }
+        free(found);
+        free_check_square(window);
+    }
+    free(seen);
+    free_seg_tree(tree);
+    for (int i=0; i < n; i++) {
+        free(starts[i]);
+        free(ends[i]);
+    }
+    free(starts);
+    free(ends);
+    free(square);
+    free(bL);
+    free(tR);
+    free_footpaths(fps, nfps);
+    return check_done("segment");
+}
+
+/* whether a segment meets a rectangle: an end inside, or crossing an edge */
+int brute_intersect(square_t* rectangle, point_t* a, point_t* b) {
+    if (in_sq(rectangle, a) || in_sq(rectangle, b)) return 1;
+    long double xs[4] = {rectangle->bottom_left->x, rectangle->top_right->x,
+                         rectangle->top_right->x, rectangle->bottom_left->x};
+    long double ys[4] = {rectangle->bottom_left->y, rectangle->bottom_left->y,
+                         rectangle->top_right->y, rectangle->top_right->y};
+    for (int i=0; i < 4; i++) {
+        point_t c = {.x = xs[i], .y = ys[i]}, d = {.x = xs[(i+1) % 4], .y = ys[(i+1) % 4]};
+        if (segments_cross(a, b, &c, &d)) return 1;
+    }
+    return 0;
+}
+
+/* whether segments ab and cd share a point */
+int segments_cross(point_t* a, point_t* b, point_t* c, point_t* d) {
+    int o1 = orientation(a, b, c), o2 = orientation(a, b, d);
+    int o3 = orientation(c, d, a), o4 = orientation(c, d, b);
+    if (o1 * o2 < 0 && o3 * o4 < 0) return 1;
+    // touching or collinear: some end lies on the other segment
+    point_t* ends[4][3] = {{a, b, c}, {a, b, d}, {c, d, a}, {c, d, b}};
+    int turns[4] = {o1, o2, o3, o4};
+    for (int i=0; i < 4; i++) {
+        point_t *p = ends[i][0], *q = ends[i][1], *r = ends[i][2];
+        if (turns[i] == 0 &&
+            r->x >= (p->x < q->x ? p->x : q->x) && r->x <= (p->x > q->x ? p->x : q->x) &&
+            r->y >= (p->y < q->y ? p->y : q->y) && r->y <= (p->y > q->y ? p->y : q->y))
+            return 1;
+    }
+    return 0;
+}
+
+/* sign of the turn from ab to ac */
+int orientation(point_t* a, point_t* b, point_t* c) {
+    long double cross = (b->x - a->x) * (c->y - a->y) - (b->y - a->y) * (c->x - a->x);
+    return (cross > 0) - (cross < 0);
+}
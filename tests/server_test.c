@@ -0,0 +1,291 @@
+/*
+ * Query server test: serves a footpath dataset from a child process and
+ * has many clients connected at once pipeline point, range and count
+ * requests, interleaved, checking every reply against the same queries
+ * made directly on the tree. Range records tagged with their ids and
+ * lengths must be those footpaths' records. A malformed frame must be
+ * answered as a bad request, with the connection still served afterwards,
+ * and the socket file must be gone once the server is stopped. A server
+ * must not listen in place of a file that is not a socket, nor of a
+ * server still listening, but must replace a stale socket file.
+ */
+
+#define _DEFAULT_SOURCE
+
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include "check.h"
+#include "footpath.h"
+#include "stage.h"
+#include "proto.h"
+#include "server.h"
+
+#define TEST_DATASET QTREE_DATA_DIR "/dataset_1000.csv"
+#define TEST_CLIENTS 20    // clients connected at once
+#define TEST_ROUNDS 20     // rounds in which every client pipelines requests
+#define TEST_PIPELINE 4    // requests a client sends per round before reading
+#define TEST_TRIES 300     // 10ms waits for the server to listen
+
+/* a random request over the square, its op picked by id */
+void random_request(unsigned* seed, square_t* square, uint32_t id, request_t* request);
+
+/* the footpath ids a request should be answered with; their number is returned */
+int expected_ids(qtnode_t* tree, request_t* request, uint32_t* ids);
+
+/* receive a response, checking it answers the request with the ids; n is
+ * -1 for a request to be answered as a bad one
+ */
+void check_response(int fd, bytes_t* in, request_t* request, uint32_t* ids, int n,
+                    const char* what);
+
+/* leave a stale socket file at path, as a server that died would */
+void stale_socket(char* path);
+
+/* receive a reply of tagged records, checking they are the records of the
+ * footpaths found, in order
+ */
+void check_tagged(int fd, bytes_t* in, request_t* request, footpath_t** footpaths, int n);
+
+int main() {
+    FILE* data = fopen(TEST_DATASET, "r");
+    if (data == NULL) {
+        fprintf(stderr, "Cannot open %s!\n", TEST_DATASET);
+        return EXIT_FAILURE;
+    }
+    int n;
+    footpath_t** fps = read_footpaths(data, &n);
+    fclose(data);
+    // the square of the fixtures over the dataset
+    point_t *bL = init_point(144.9375, -37.875), *tR = init_point(145, -37.6875);
+    square_t* square = init_square(bL, tR);
+    qtnode_t* tree = footpath_tree(fps, n, square);
+
+    char directory[] = "/tmp/qtree_server_XXXXXX";
+    CHECK(mkdtemp(directory) != NULL, "no temporary directory");
+    char path[sizeof(directory) + 2];
+    snprintf(path, sizeof(path), "%s/s", directory);
+
+    // a file that is not a socket is left alone
+    FILE* file = fopen(path, "w");
+    CHECK(file != NULL, "cannot create %s", path);
+    if (file != NULL) fclose(file);
+    struct stat file_status;
+    CHECK(server_listen(path) < 0, "listening in place of a regular file");
+    CHECK(lstat(path, &file_status) == 0 && S_ISREG(file_status.st_mode), "regular file replaced");
+    unlink(path);
+
+    pid_t server = fork();
+    if (server == 0) _exit(serve_footpaths(path, tree) == 0 ? EXIT_SUCCESS : EXIT_FAILURE);
+
+    // connect every client, waiting for the server to listen
+    int fds[TEST_CLIENTS];
+    for (int c=0; c < TEST_CLIENTS; c++) {
+        fds[c] = connect_to(path);
+        for (int tries=0; fds[c] < 0 && tries < TEST_TRIES; tries++) {
+            usleep(10000);
+            fds[c] = connect_to(path);
+        }
+        CHECK(fds[c] >= 0, "client %d cannot connect", c);
+    }
+
+    // a socket a server listens at is not taken over
+    CHECK(server_listen(path) < 0, "listening in place of a running server");
+    int probe = connect_to(path);
+    CHECK(probe >= 0, "running server replaced");
+    if (probe >= 0) close(probe);
+
+    unsigned seed = CHECK_SEED;
+    bytes_t out = {0}, in[TEST_CLIENTS];
+    memset(in, 0, sizeof(in));
+    request_t requests[TEST_CLIENTS][TEST_PIPELINE];
+    uint32_t* ids = (uint32_t*) malloc(sizeof(uint32_t) * 2 * n);
+    int nonempty = 0;
+    for (int r=0; r < TEST_ROUNDS && fds[TEST_CLIENTS-1] >= 0; r++) {
+        // every client sends its requests before any reply is read
+        for (int c=0; c < TEST_CLIENTS; c++) {
+            out.length = 0;
+            for (int i=0; i < TEST_PIPELINE; i++) {
+                uint32_t id = (uint32_t) ((r * TEST_CLIENTS + c) * TEST_PIPELINE + i);
+                random_request(&seed, square, id, &requests[c][i]);
+                encode_request(&out, &requests[c][i]);
+            }
+            CHECK(send_all(fds[c], out.data, out.length) == 0, "client %d: send failed", c);
+        }
+        for (int c=TEST_CLIENTS-1; c >= 0; c--)
+            for (int i=0; i < TEST_PIPELINE; i++) {
+                int nids = expected_ids(tree, &requests[c][i], ids);
+                check_response(fds[c], &in[c], &requests[c][i], ids, nids, "pipelined");
+                nonempty += nids > 0;
+            }
+    }
+    CHECK(nonempty > TEST_ROUNDS, "only %d requests found footpaths", nonempty);
+
+    // range records tagged with their ids, as a coordinator asks for them
+    for (int i=0; i < TEST_ROUNDS && fds[1] >= 0; i++) {
+        request_t tagged;
+        random_request(&seed, square, (uint32_t) (3 * i + 1), &tagged);
+        tagged.format = PROTO_RECORDS | PROTO_TAGGED;
+        out.length = 0;
+        encode_request(&out, &tagged);
+        CHECK(send_all(fds[1], out.data, out.length) == 0, "tagged request %d: send failed", i);
+        point_t p1 = {.x = tagged.x1, .y = tagged.y1}, p2 = {.x = tagged.x2, .y = tagged.y2};
+        square_t rectangle = {.bottom_left = &p1, .top_right = &p2};
+        footpath_t** footpaths;
+        int nfootpaths = range_footpaths(tree, &rectangle, &footpaths);
+        check_tagged(fds[1], &in[1], &tagged, footpaths, nfootpaths);
+        free(footpaths);
+    }
+
+    // a malformed frame is a bad request, and the connection goes on
+    unsigned char bad[7] = {3, 0, 0, 0, 1, 2, 3};
+    request_t unknown = {.id = 7, .op = 9, .format = PROTO_IDS};
+    request_t after;
+    random_request(&seed, square, 8, &after);
+    out.length = 0;
+    bytes_append(&out, bad, sizeof(bad));
+    encode_request(&out, &unknown);
+    encode_request(&out, &after);
+    if (fds[0] >= 0 && send_all(fds[0], out.data, out.length) == 0) {
+        request_t none = {.id = 0};
+        check_response(fds[0], &in[0], &none, NULL, -1, "malformed frame");
+        check_response(fds[0], &in[0], &unknown, NULL, -1, "unknown op");
+        int nids = expected_ids(tree, &after, ids);
+        check_response(fds[0], &in[0], &after, ids, nids, "after a bad request");
+    }
+
+    for (int c=0; c < TEST_CLIENTS; c++) {
+        if (fds[c] >= 0) close(fds[c]);
+        free(in[c].data);
+    }
+    int status;
+    kill(server, SIGTERM);
+    waitpid(server, &status, 0);
+    CHECK(WIFEXITED(status) && WEXITSTATUS(status) == EXIT_SUCCESS, "server failed");
+    CHECK(access(path, F_OK) != 0, "socket file left behind");
+
+    // a stale socket file is replaced
+    stale_socket(path);
+    int fd = server_listen(path);
+    CHECK(fd >= 0, "not listening in place of a stale socket");
+    if (fd >= 0) {
+        probe = connect_to(path);
+        CHECK(probe >= 0, "cannot connect in place of a stale socket");
+        if (probe >= 0) close(probe);
+        close(fd);
+    }
+    unlink(path);
+    rmdir(directory);
+    free(out.data);
+    free(ids);
+    free_tree(tree);
+    free_footpaths(fps, n);
+    free(bL);
+    free(tR);
+    return check_done("server");
+}
+
+/* a random request over the square, its op picked by id */
+void random_request(unsigned* seed, square_t* square, uint32_t id, request_t* request) {
+    square_t* window = check_window(seed, square);
+    uint8_t ops[3] = {PROTO_POINT, PROTO_RANGE, PROTO_COUNT};
+    *request = (request_t) {.id = id, .op = ops[id % 3], .format = PROTO_IDS,
+                            .x1 = (double) window->bottom_left->x,
+                            .y1 = (double) window->bottom_left->y,
+                            .x2 = (double) window->top_right->x,
+                            .y2 = (double) window->top_right->y};
+    free_check_square(window);
+}
+
+/* the footpath ids a request should be answered with; their number is returned */
+int expected_ids(qtnode_t* tree, request_t* request, uint32_t* ids) {
+    point_t p1 = {.x = request->x1, .y = request->y1}, p2 = {.x = request->x2, .y = request->y2};
+    square_t rectangle = {.bottom_left = &p1, .top_right = &p2};
+    footpath_t** footpaths = NULL;
+    int n = (request->op == PROTO_POINT) ? point_footpaths(tree, &p1, &footpaths)
+                                         : range_footpaths(tree, &rectangle, &footpaths);
+    for (int i=0; i < n; i++)
+        ids[i] = (uint32_t) footpaths[i]->footpath_id;
+    free(footpaths);
+    return n;
+}
+
+/* receive a response, checking it answers the request with the ids; n is
+ * -1 for a request to be answered as a bad one
+ */
+void check_response(int fd, bytes_t* in, request_t* request, uint32_t* ids, int n,
+                    const char* what) {
+    response_t response;
+    int length = recv_frame(fd, in);
+    CHECK(length >= 0 && decode_response(in->data + 4, (uint32_t) length, &response),
+          "%s, request %u: no response", what, request->id);
+    if (length < 0) return;
+    unsigned char* payload = in->data + 4 + PROTO_RESPONSE_LEN;
+    CHECK(response.id == request->id, "%s, request %u: answer to %u", what, request->id,
+          response.id);
+    if (n < 0)
+        CHECK(response.status == PROTO_BAD_REQUEST, "%s, request %u: status %d", what,
+              request->id, response.status);
+    else {
+        CHECK(response.status == PROTO_OK && response.count == (uint32_t) n,
+              "%s, request %u: status %d, %u footpaths, expected %d", what, request->id,
+              response.status, response.count, n);
+        uint32_t sent = (request->op == PROTO_COUNT) ? 0 : (uint32_t) n;
+        CHECK(response.payload_len == 4 * sent, "%s, request %u: %u payload bytes", what,
+              request->id, response.payload_len);
+        for (uint32_t i=0; i < sent && 4 * i < response.payload_len; i++)
+            CHECK(get_u32(payload + 4 * i) == ids[i], "%s, request %u: footpath %u differs",
+                  what, request->id, i);
+    }
+    bytes_consume(in, 4 + (size_t) length);
+}
+
+/* leave a stale socket file at path, as a server that died would */
+void stale_socket(char* path) {
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    snprintf(address.sun_path, sizeof(address.sun_path), "%s", path);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    CHECK(fd >= 0 && bind(fd, (struct sockaddr*) &address, sizeof(address)) == 0,
+          "cannot bind %s", path);
+    if (fd >= 0) close(fd);
+}
+
+/* receive a reply of tagged records, checking they are the records of the
+ * footpaths found, in order
+ */
+void check_tagged(int fd, bytes_t* in, request_t* request, footpath_t** footpaths, int n) {
+    response_t response;
+    int length = recv_frame(fd, in);
+    CHECK(length >= 0 && decode_response(in->data + 4, (uint32_t) length, &response),
+          "tagged request %u: no response", request->id);
+    if (length < 0) return;
+    CHECK(response.status == PROTO_OK && response.count == (uint32_t) n,
+          "tagged request %u: status %d, %u footpaths, expected %d", request->id,
+          response.status, response.count, n);
+    unsigned char* payload = in->data + 4 + PROTO_RESPONSE_LEN;
+    size_t at = 0;
+    for (int i=0; i < n && at + 8 <= response.payload_len; i++) {
+        uint32_t id = get_u32(payload + at), record_len = get_u32(payload + at + 4);
+        char* record;
+        size_t expected_len;
+        FILE* f = open_memstream(&record, &expected_len);
+        print_footpath(f, footpaths[i]);
+        fclose(f);
+        CHECK(id == (uint32_t) footpaths[i]->footpath_id && record_len == expected_len &&
+              at + 8 + record_len <= response.payload_len &&
+              memcmp(payload + at + 8, record, expected_len) == 0,
+              "tagged request %u: record %d differs", request->id, i);
+        free(record);
+        at += 8 + record_len;
+    }
+    CHECK(at == response.payload_len, "tagged request %u: %zu of %u payload bytes read",
+          request->id, at, response.payload_len);
+    bytes_consume(in, 4 + (size_t) length);
+}
@@ -0,0 +1,199 @@
+/*
+ * Shard test: serves a dataset whose locations sit on a lattice, so that
+ * many of them lie at the same distance from a query, from 4 shard servers
+ * in child processes, and has a coordinator answer point, range and kNN
+ * requests over them. Every reply must be byte for byte the one a single
+ * server over the whole dataset sends, ties at the k-th location included.
+ * That server's kNN order must be a brute force's: nearest first, then by
+ * x, then by y.
+ */
+
+#define _DEFAULT_SOURCE
+
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "check.h"
+#include "stage.h"
+#include "knn.h"
+#include "proto.h"
+#include "server.h"
+#include "shard.h"
+
+#define TEST_SIDE 16       // side of the square, with lattice points at odd coordinates
+#define TEST_FOOTPATHS 60  // footpaths, each from one lattice point to another
+#define TEST_LEVEL 1       // shard level, for 4 shards
+#define TEST_REQUESTS 600  // requests sent to both the coordinator and the server
+#define TEST_MAX_K 12      // largest k of a kNN request
+#define TEST_HEADER "footpath_id,address,clue_sa,asset_type,deltaz,distance,grade1in," \
+                    "mcc_id,mccid_int,rlmax,rlmin,segside,statusid,streetid,"         \
+                    "street_group,start_lat,start_lon,end_lat,end_lon\n"
+
+/* the test's footpaths, between random lattice points */
+footpath_t** lattice_footpaths(unsigned* seed, int* n);
+
+/* a random request over the square, its op picked by id */
+void random_request(unsigned* seed, uint32_t id, request_t* request);
+
+/* check search_knn's order over the tree against the locations, sorted by
+ * distance to the query, then x, then y
+ */
+void check_knn_order(qtnode_t* tree, point_t** locations, int n, point_t* query, int k);
+
+/* comparison of locations by distance to the query set for it, then x, then y */
+int location_cmp(const void* a, const void* b);
+
+// the query location_cmp measures distances from
+static point_t* order_query;
+
+int main() {
+    unsigned seed = CHECK_SEED;
+    int n;
+    footpath_t** fps = lattice_footpaths(&seed, &n);
+    qtnode_t* tree = footpath_tree(fps, n, init_square(init_point(0, 0),
+                                                       init_point(TEST_SIDE, TEST_SIDE)));
+    shard_map_t* map = init_shard_map(init_square(init_point(0, 0),
+                                                  init_point(TEST_SIDE, TEST_SIDE)), TEST_LEVEL);
+
+    // every location once, for the brute force
+    point_t** locations = (point_t**) malloc(sizeof(point_t*) * 2 * n);
+    int nlocations = 0;
+    for (int i=0; i < 2 * n; i++) {
+        point_t end = {.x = (i % 2) ? fps[i/2]->end_lon : fps[i/2]->start_lon,
+                       .y = (i % 2) ? fps[i/2]->end_lat : fps[i/2]->start_lat};
+        point_t* stored = find_pt(tree, &end);
+        int seen = 0;
+        for (int j=0; j < nlocations && !seen; j++) seen = locations[j] == stored;
+        if (!seen) locations[nlocations++] = stored;
+    }
+
+    // a server per shard, each in a child process
+    char directory[] = "/tmp/qtree_shard_XXXXXX";
+    CHECK(mkdtemp(directory) != NULL, "no temporary directory");
+    char paths[1 << (2 * TEST_LEVEL)][sizeof(directory) + 4];
+    char* addresses[1 << (2 * TEST_LEVEL)];
+    pid_t shards[1 << (2 * TEST_LEVEL)];
+    for (int s=0; s < map->nshards; s++) {
+        snprintf(paths[s], sizeof(paths[s]), "%s/s%d", directory, s);
+        addresses[s] = paths[s];
+        shards[s] = fork();
+        if (shards[s] == 0) {
+            qtnode_t* own = footpath_shard_tree(fps, n, init_square(init_point(0, 0),
+                                                init_point(TEST_SIDE, TEST_SIDE)), map, s);
+            _exit(serve_footpaths(paths[s], own) == 0 ? EXIT_SUCCESS : EXIT_FAILURE);
+        }
+    }
+    coordinator_t* coordinator = init_coordinator(map, addresses);
+    CHECK(coordinator != NULL, "no coordinator");
+
+    bytes_t expected = {NULL, 0, 0}, merged = {NULL, 0, 0};
+    int ties = 0;
+    for (uint32_t r=0; r < TEST_REQUESTS && coordinator != NULL; r++) {
+        request_t request;
+        random_request(&seed, r, &request);
+        expected.length = merged.length = 0;
+        request_t copy = request;
+        footpath_handler(tree, &copy, &expected);
+        copy = request;
+        coordinator_handler(coordinator, &copy, &merged);
+        CHECK(merged.length == expected.length &&
+              memcmp(merged.data, expected.data, expected.length) == 0,
+              "request %u, op %d, format %d: %zu bytes, expected %zu", r, request.op,
+              request.format, merged.length, expected.length);
+        if (request.op != PROTO_KNN) continue;
+        point_t query = {.x = request.x1, .y = request.y1};
+        check_knn_order(tree, locations, nlocations, &query, (int) request.k);
+        // a tie at the k-th location makes the order matter
+        if ((int) request.k < nlocations) {
+            order_query = &query;
+            qsort(locations, nlocations, sizeof(point_t*), location_cmp);
+            ties += point_dist2(&query, locations[request.k - 1]) ==
+                    point_dist2(&query, locations[request.k]);
+        }
+    }
+    CHECK(ties > TEST_REQUESTS / 20, "only %d kNN requests tied at the k-th location", ties);
+
+    for (int s=0; s < map->nshards; s++) {
+        int status;
+        kill(shards[s], SIGTERM);
+        waitpid(shards[s], &status, 0);
+        CHECK(WIFEXITED(status) && WEXITSTATUS(status) == EXIT_SUCCESS, "shard %d failed", s);
+    }
+    rmdir(directory);
+    if (coordinator != NULL) free_coordinator(coordinator);
+    free(expected.data);
+    free(merged.data);
+    free(locations);
+    point_t *bL = map->frame->square->bottom_left, *tR = map->frame->square->top_right;
+    free_shard_map(map);
+    free(bL);
+    free(tR);
+    bL = tree->square->bottom_left;
+    tR = tree->square->top_right;
+    free_tree(tree);
+    free(bL);
+    free(tR);
+    free_footpaths(fps, n);
+    return check_done("shard");
+}
+
+/* the test's footpaths, between random lattice points */
+footpath_t** lattice_footpaths(unsigned* seed, int* n) {
+    char* text;
+    size_t length;
+    FILE* csv = open_memstream(&text, &length);
+    fputs(TEST_HEADER, csv);
+    for (int i=0; i < TEST_FOOTPATHS; i++) {
+        int ends[4];
+        for (int j=0; j < 4; j++)
+            ends[j] = 1 + 2 * (int) (check_rand(seed) % (TEST_SIDE / 2));
+        fprintf(csv, "%d,street %d,b,c,0,0,0,0,0,0,0,0,0,0,0,%d,%d,%d,%d\n", i + 1, i,
+                ends[0], ends[1], ends[2], ends[3]);
+    }
+    fclose(csv);
+    FILE* data = fmemopen(text, length, "r");
+    footpath_t** fps = read_footpaths(data, n);
+    fclose(data);
+    free(text);
+    return fps;
+}
+
+/* a random request over the square, its op picked by id */
+void random_request(unsigned* seed, uint32_t id, request_t* request) {
+    uint8_t ops[3] = {PROTO_POINT, PROTO_RANGE, PROTO_KNN};
+    double c[4];
+    for (int i=0; i < 4; i++) c[i] = (double) (check_rand(seed) % (TEST_SIDE + 1));
+    *request = (request_t) {.id = id, .op = ops[id % 3],
+                            .format = (id / 3 % 2) ? PROTO_RECORDS : PROTO_IDS,
+                            .k = 1 + check_rand(seed) % TEST_MAX_K,
+                            .x1 = (c[0] < c[2]) ? c[0] : c[2], .y1 = (c[1] < c[3]) ? c[1] : c[3],
+                            .x2 = (c[0] < c[2]) ? c[2] : c[0], .y2 = (c[1] < c[3]) ? c[3] : c[1]};
+}
+
+/* check search_knn's order over the tree against the locations, sorted by
+ * distance to the query, then x, then y
+ */
+void check_knn_order(qtnode_t* tree, point_t** locations, int n, point_t* query, int k) {
+    order_query = query;
+    qsort(locations, n, sizeof(point_t*), location_cmp);
+    point_t** found = (point_t**) malloc(sizeof(point_t*) * k);
+    int nfound = search_knn(tree, query, k, NULL, found);
+    CHECK(nfound == (k < n ? k : n), "kNN at (%Lf, %Lf): %d of %d locations", query->x,
+          query->y, nfound, k);
+    for (int i=0; i < nfound && i < n; i++)
+        CHECK(found[i] == locations[i], "kNN at (%Lf, %Lf), k %d: location %d out of order",
+              query->x, query->y, k, i);
+    free(found);
+}
+
+/* comparison of locations by distance to the query set for it, then x, then y */
+int location_cmp(const void* a, const void* b) {
+    point_t* p1 = *(point_t**) a;
+    point_t* p2 = *(point_t**) b;
+    long double d1 = point_dist2(order_query, p1), d2 = point_dist2(order_query, p2);
+    if (d1 != d2) return (d1 > d2) - (d1 < d2);
+    if (p1->x != p2->x) return (p1->x > p2->x) - (p1->x < p2->x);
+    return (p1->y > p2->y) - (p1->y < p2->y);
+}
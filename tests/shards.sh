@@ -0,0 +1,84 @@
+#!/bin/sh
+# Sharded deployment check over the stage 3 / 4 fixtures:
+#   tests/shards.sh build_dir fixture_dir manifest
+# Every fixture's dataset is split into 4 and then 16 shards, each served
+# by its own process behind a coordinator (see shard.h); the fixture's .in
+# queries are sent to the coordinator, and the records it replies with are
+# diffed against .out. kNN and count replies are diffed against a single
+# server over the whole dataset.
+
+set -u
+build=$1
+fixtures=$2
+manifest=$3
+sockets=$(mktemp -d)
+pids=""
+failed=0
+
+stop() {
+    [ -n "$pids" ] && kill $pids 2>/dev/null
+    wait 2>/dev/null
+    pids=""
+}
+trap 'stop; rm -rf "$sockets"' EXIT
+
+# wait for a server's socket to appear: it is only renamed into place once
+# the server is listening, so a client can connect as soon as it is there
+ready() {
+    tries=0
+    while [ ! -S "$1" ] && [ $tries -lt 300 ]; do
+        sleep 0.1
+        tries=$((tries + 1))
+    done
+    [ -S "$1" ]
+}
+
+check() {
+    if ! cmp -s "$1" "$2"; then
+        echo "FAIL $3"
+        failed=1
+    fi
+}
+
+grep -v '^#' "$manifest" > "$sockets/manifest"
+while read -r name stage dataset x1 y1 x2 y2; do
+    [ -n "$name" ] || continue
+    data="$fixtures/dataset_$dataset.csv"
+    in="$fixtures/$name.s$stage.in"
+    query=$( [ "$stage" = 3 ] && echo point || echo range )
+    "$build/quadtree-in-c" --serve "$sockets/one" "$data" $x1 $y1 $x2 $y2 &
+    pids="$pids $!"
+    ready "$sockets/one" || { echo "FAIL $name: no server"; exit 1; }
+    awk '{print $1, $2}' "$in" > "$sockets/points"
+    "$build/qtree_client" "$sockets/one" knn -k 7 < "$sockets/points" > "$sockets/knn"
+    [ "$stage" = 4 ] && "$build/qtree_client" "$sockets/one" count < "$in" > "$sockets/count"
+    for level in 1 2; do
+        shards=""
+        i=0
+        while [ $i -lt $((1 << (2 * level))) ]; do
+            "$build/quadtree-in-c" --shard "$sockets/s$i" "$data" $x1 $y1 $x2 $y2 $level $i &
+            pids="$pids $!"
+            shards="$shards $sockets/s$i"
+            i=$((i + 1))
+        done
+        "$build/quadtree-in-c" --coordinate "$sockets/c" $x1 $y1 $x2 $y2 $level $shards &
+        pids="$pids $!"
+        ready "$sockets/c" || { echo "FAIL $name: no coordinator"; exit 1; }
+        client="$build/qtree_client $sockets/c"
+        $client $query --records < "$in" > "$sockets/out"
+        check "$sockets/out" "$fixtures/$name.s$stage.out" "$name, $level: $query"
+        $client knn -k 7 < "$sockets/points" > "$sockets/out"
+        check "$sockets/out" "$sockets/knn" "$name, $level: knn"
+        if [ "$stage" = 4 ]; then
+            $client count < "$in" > "$sockets/out"
+            check "$sockets/out" "$sockets/count" "$name, $level: count"
+        fi
+        # every server but the single one goes, along with its socket
+        kill $(echo $pids | cut -d' ' -f2-) 2>/dev/null
+        wait $(echo $pids | cut -d' ' -f2-) 2>/dev/null
+        pids=$(echo $pids | cut -d' ' -f1)
+    done
+    stop
+    echo "done $name"
+done < "$sockets/manifest"
+exit $failed
@@ -0,0 +1,92 @@
+/*
+ * Snapping test: indexes random segments, some of them points, then snaps
+ * a random walk (fixes close together, as along a trace) and scattered
+ * fixes (far apart) in one batch, checking each against the nearest
+ * segment found by measuring the distance to every segment.
+ */
+
+#include <stdlib.h>
+#include <math.h>
+#include "check.h"
+#include "snap.h"
+
+#define TEST_SEGMENTS 4000  // segments indexed
+#define TEST_WALK 3000      // fixes of the random walk
+#define TEST_SCATTER 500    // scattered fixes after the walk
+#define TEST_STEP 0.4L      // longest step of the walk, either way
+
+/* clamp a coordinate to [lo, hi] */
+long double clamp(long double v, long double lo, long double hi);
+
+int main() {
+    unsigned seed = CHECK_SEED;
+    point_t *bL = init_point(0, 0), *tR = init_point(100, 100);
+    square_t* square = init_square(bL, tR);
+
+    // segments from a point to a nearby one within the square, a few of
+    // them points
+    point_t** starts = check_points(&seed, square, TEST_SEGMENTS);
+    point_t** ends = (point_t**) malloc(sizeof(point_t*) * TEST_SEGMENTS);
+    seg_tree_t* tree = init_seg_tree(square, SEG_THRESHOLD);
+    for (int i=0; i < TEST_SEGMENTS; i++) {
+        long double reach = check_uniform(&seed, 0, 8) * (i % 10 != 0);
+        ends[i] = init_point(clamp(starts[i]->x + check_uniform(&seed, -reach, reach), 0, 100),
+                             clamp(starts[i]->y + check_uniform(&seed, -reach, reach), 0, 100));
+        seg_insert(tree, starts[i], ends[i]);
+    }
+
+    int n = TEST_WALK + TEST_SCATTER;
+    point_t* fixes = (point_t*) malloc(sizeof(point_t) * n);
+    point_t** batch = (point_t**) malloc(sizeof(point_t*) * n);
+    long double x = 50, y = 50;
+    for (int i=0; i < n; i++) {
+        if (i < TEST_WALK) {
+            x = clamp(x + check_uniform(&seed, -TEST_STEP, TEST_STEP), 0, 100);
+            y = clamp(y + check_uniform(&seed, -TEST_STEP, TEST_STEP), 0, 100);
+        } else {
+            x = check_uniform(&seed, 0, 100);
+            y = check_uniform(&seed, 0, 100);
+        }
+        fixes[i] = (point_t) {.x = x, .y = y};
+        batch[i] = &fixes[i];
+    }
+    snap_t* out = (snap_t*) malloc(sizeof(snap_t) * n);
+    snap_batch(tree, batch, n, out);
+
+    for (int i=0; i < n; i++) {
+        long double best = -1;
+        for (int s=0; s < TEST_SEGMENTS; s++) {
+            long double dist = point_segment_dist2(batch[i], starts[s], ends[s], NULL);
+            if (best < 0 || dist < best) best = dist;
+        }
+        CHECK(out[i].id >= 0 && out[i].id < TEST_SEGMENTS, "fix %d: bad id %d", i, out[i].id);
+        if (out[i].id < 0 || out[i].id >= TEST_SEGMENTS) continue;
+        point_t at;
+        long double dist = point_segment_dist2(batch[i], starts[out[i].id], ends[out[i].id], &at);
+        CHECK(dist == best, "fix %d: segment %d at %Lg, nearest at %Lg",
+              i, out[i].id, sqrtl(dist), sqrtl(best));
+        CHECK(out[i].dist == sqrtl(dist), "fix %d: distance %Lg, segment at %Lg",
+              i, out[i].dist, sqrtl(dist));
+        CHECK(point_cmp(&out[i].at, &at), "fix %d: wrong location on the segment", i);
+    }
+
+    // with no segment, every fix is left unsnapped
+    seg_tree_t* empty = init_seg_tree(square, SEG_THRESHOLD);
+    snap_batch(empty, batch, 2, out);
+    CHECK(out[0].id == -1 && out[1].id == -1, "empty index: fixes snapped");
+    free_seg_tree(empty);
+
+    free(out);
+    free(batch);
+    free(fixes);
+    free_seg_tree(tree);
+    free_check_points(starts, TEST_SEGMENTS);
+    free_check_points(ends, TEST_SEGMENTS);
+    free_check_square(square);
+    return check_done("snap");
+}
+
+/* clamp a coordinate to [lo, hi] */
+long double clamp(long double v, long double lo, long double hi) {
+    return (v < lo) ? lo : (v > hi) ? hi : v;
+}
@@ -0,0 +1,103 @@
+/*
+ * Stage query test: builds a tree from footpaths whose starts lie so close
+ * together that the leaves holding them are over 64 levels deep, and point
+ * queries every location. The printed path must name every quadrant walked
+ * from the root to the leaf, and the footpaths printed and returned must be
+ * those stored there.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <string.h>
+#include "check.h"
+#include "grid.h"
+#include "stage.h"
+
+#define TEST_DEPTH 64  // levels the deepest leaf must go past, without a grid
+#define TEST_DATASET                                                                 \
+    "footpath_id,address,clue_sa,asset_type,deltaz,distance,grade1in,mcc_id,"        \
+    "mccid_int,rlmax,rlmin,segside,statusid,streetid,street_group,start_lat,"        \
+    "start_lon,end_lat,end_lon\n"                                                    \
+    "1,a,b,c,0,0,0,0,0,0,0,0,0,0,0,1e-30,1e-30,0.5,0.5\n"                           \
+    "2,a,b,c,0,0,0,0,0,0,0,0,0,0,0,2e-30,2e-30,0.25,0.75\n"
+
+/* the path text of the leaf a point falls in, as " SW NE ..."; its depth
+ * is set to the number of levels walked
+ */
+char* walked_path(qtnode_t* tree, point_t* point, int* depth);
+
+int main() {
+    FILE* data = fmemopen(TEST_DATASET, strlen(TEST_DATASET), "r");
+    int n;
+    footpath_t** fps = read_footpaths(data, &n);
+    fclose(data);
+    CHECK(n == 2, "dataset read as %d footpaths", n);
+    point_t *bL = init_point(0, 0), *tR = init_point(1, 1);
+    qtnode_t* tree = footpath_tree(fps, n, init_square(bL, tR));
+
+    int deepest = 0;
+    for (int i=0; i < 2 * n; i++) {
+        footpath_t* fp = fps[i / 2];
+        point_t query = {.x = (i % 2) ? fp->end_lon : fp->start_lon,
+                         .y = (i % 2) ? fp->end_lat : fp->start_lat};
+        point_t walked = query, listed = query;
+        int depth;
+        char* expected = walked_path(tree, &walked, &depth);
+        if (depth > deepest) deepest = depth;
+
+        char *out, *path;
+        size_t out_len, path_len;
+        FILE* out_stream = open_memstream(&out, &out_len);
+        FILE* path_stream = open_memstream(&path, &path_len);
+        point_query(tree, &query, out_stream, path_stream);
+        fclose(out_stream);
+        fclose(path_stream);
+        CHECK(strcmp(path, expected) == 0, "location %d: path of %zu characters, expected %d "
+              "levels", i, path_len, depth);
+        char record[32];
+        snprintf(record, sizeof(record), "--> footpath_id: %d ", fp->footpath_id);
+        CHECK(strstr(out, record) != NULL, "location %d: footpath %d not printed", i,
+              fp->footpath_id);
+
+        footpath_t** found;
+        int nfound = point_footpaths(tree, &listed, &found);
+        int seen = 0;
+        for (int j=0; j < nfound; j++) seen |= found[j] == fp;
+        CHECK(seen, "location %d: footpath %d not returned", i, fp->footpath_id);
+        free(found);
+        free(expected);
+        free(out);
+        free(path);
+    }
+#ifndef QTREE_GRID
+    CHECK(deepest > TEST_DEPTH, "deepest leaf at %d levels", deepest);
+#endif
+
+    free_tree(tree);
+    free_footpaths(fps, n);
+    free(bL);
+    free(tR);
+    return check_done("stage");
+}
+
+/* the path text of the leaf a point falls in, as " SW NE ..."; its depth
+ * is set to the number of levels walked
+ */
+char* walked_path(qtnode_t* tree, point_t* point, int* depth) {
+    static const char* names[4] = {" SW", " NW", " NE", " SE"};  // by enum quadrant
+    size_t capacity = 64, length = 0;
+    char* text = (char*) malloc(capacity);
+    text[0] = '\0';
+    *depth = 0;
+    GRID_POINT(tree->square, point);
+    while (tree != NULL && !IS_LEAF(tree)) {
+        enum quadrant q = QUADRANT(tree->square, point);
+        if (length + 4 > capacity) text = (char*) realloc(text, capacity *= 2);
+        memcpy(text + length, names[q], 4);
+        length += 3;
+        (*depth)++;
+        tree = get_child(tree, q);
+    }
+    return text;
+}
@@ -0,0 +1,126 @@
+/*
+ * Query client - sends stage 3 / 4 style query lines from stdin to a
+ * query server (see server.h), or a shard coordinator (see shard.h), and
+ * prints the replies:
+ *   ./qtree_client SOCKET point|range|count|knn [-k K] [--records] < queries
+ * SOCKET may also be a TCP "host:port".
+ * Point and kNN queries are "x y" per line, range and count queries
+ * "x1 y1 x2 y2". With --records each query line is followed by the records
+ * found, as stage 3 / 4 write them to their output file; otherwise by
+ * "--> " and the footpath ids, or the count. Up to CLIENT_WINDOW requests
+ * are kept in flight on the one connection.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "proto.h"
+
+#define CLIENT_WINDOW 64      // requests sent ahead of the replies read
+#define MAX_QUERY_LEN 256     // maximum length of a query line
+
+/* print the reply to a query line, as asked for by the request */
+void print_reply(char* line, request_t* request, response_t* response,
+                 const unsigned char* payload);
+
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        fprintf(stderr, "Usage: %s SOCKET point|range|count|knn [-k K] [--records]\n",
+                argv[0]);
+        return EXIT_FAILURE;
+    }
+    request_t request = {0, 0, PROTO_IDS, 1, 0, 0, 0, 0};
+    char* ops[] = {"point", "range", "knn", "count"};
+    for (int i=0; i < 4; i++)
+        if (strcmp(argv[2], ops[i]) == 0) request.op = PROTO_POINT + i;
+    for (int i=3; i < argc; i++) {
+        if (strcmp(argv[i], "--records") == 0) request.format = PROTO_RECORDS;
+        else if (strcmp(argv[i], "-k") == 0 && i+1 < argc) request.k = atoi(argv[++i]);
+    }
+    if (request.op == 0) {
+        fprintf(stderr, "Unknown query %s!\n", argv[2]);
+        return EXIT_FAILURE;
+    }
+    int fd = connect_to(argv[1]);
+    if (fd < 0) {
+        fprintf(stderr, "Cannot connect to %s!\n", argv[1]);
+        return EXIT_FAILURE;
+    }
+
+    // read every query line, keeping those that parse
+    int windowed = (request.op == PROTO_RANGE || request.op == PROTO_COUNT);
+    char** lines = NULL;
+    double* coords = NULL;
+    int n = 0, capacity = 0;
+    char line[MAX_QUERY_LEN];
+    while (fgets(line, MAX_QUERY_LEN, stdin) != NULL) {
+        line[strcspn(line, "\r\n")] = '\0';
+        double c[4] = {0, 0, 0, 0};
+        int read = sscanf(line, "%lf %lf %lf %lf", &c[0], &c[1], &c[2], &c[3]);
+        if (read < 2 || (windowed && read < 4)) continue;
+        if (n == capacity) {
+            capacity = capacity ? capacity * 2 : 64;
+            lines = (char**) realloc(lines, sizeof(char*) * capacity);
+            coords = (double*) realloc(coords, sizeof(double) * 4 * capacity);
+        }
+        lines[n] = strdup(line);
+        memcpy(&coords[4*n], c, sizeof(c));
+        n++;
+    }
+
+    // pipeline the requests, reading replies as the window fills
+    bytes_t out = {NULL, 0, 0}, in = {NULL, 0, 0};
+    int sent = 0, status = 0;
+    for (int done=0; done < n; done++) {
+        out.length = 0;
+        for (; sent < n && sent - done < CLIENT_WINDOW; sent++) {
+            request.id = (uint32_t) sent;
+            request.x1 = coords[4*sent];
+            request.y1 = coords[4*sent+1];
+            request.x2 = coords[4*sent+2];
+            request.y2 = coords[4*sent+3];
+            encode_request(&out, &request);
+        }
+        response_t response;
+        int length;
+        if (send_all(fd, out.data, out.length) < 0 || (length = recv_frame(fd, &in)) < 0 ||
+            !decode_response(in.data + 4, (uint32_t) length, &response) ||
+            response.id != (uint32_t) done) {
+            fprintf(stderr, "Lost the server after %d replies!\n", done);
+            status = EXIT_FAILURE;
+            break;
+        }
+        if (response.status == PROTO_UNAVAILABLE)
+            fprintf(stderr, "Unavailable: %s\n", lines[done]);
+        else if (response.status != PROTO_OK)
+            fprintf(stderr, "Bad request: %s\n", lines[done]);
+        print_reply(lines[done], &request, &response, in.data + 4 + PROTO_RESPONSE_LEN);
+        bytes_consume(&in, 4 + (size_t) length);
+    }
+    close(fd);
+    for (int i=0; i < n; i++) free(lines[i]);
+    free(lines);
+    free(coords);
+    free(out.data);
+    free(in.data);
+    return status;
+}
+
+/* print the reply to a query line, as asked for by the request */
+void print_reply(char* line, request_t* request, response_t* response,
+                 const unsigned char* payload) {
+    if (request->op == PROTO_COUNT) {
+        printf("%s --> %u\n", line, response->count);
+        return;
+    }
+    if (request->format == PROTO_RECORDS) {
+        printf("%s\n", line);
+        fwrite(payload, 1, response->payload_len, stdout);
+        return;
+    }
+    printf("%s -->", line);
+    for (uint32_t i=0; i < response->payload_len / 4; i++)
+        printf(" %d", (int) get_u32(payload + 4*i));
+    printf("\n");
+}
@@ -0,0 +1,252 @@
+/*
+ * Synthetic dataset generator - writes footpath CSVs in the datasets'
+ * 19-column schema, along with matching stage 3 (point) and stage 4 (range)
+ * query files:
+ *   ./qtree_gen -n ROWS -o PREFIX [-d uniform|cluster|duplicate] [-s SEED]
+ *               [-q QUERIES] [-r HIT_RATE] [-w WINDOW]
+ * which writes PREFIX.csv, PREFIX.s3.in and PREFIX.s4.in, and prints the
+ * outer square to use on stdout. Distributions:
+ *   uniform    footpaths scattered evenly over the area
+ *   cluster    footpaths along streets, gaussian around a few street centres
+ *   duplicate  footpaths between a few shared intersections, some of which
+ *              lie within 1e-12 degrees of each other, giving many identical
+ *              points and very deep split chains
+ * A fraction HIT_RATE of the point queries are exact footpath end points
+ * (the rest miss), and of the range windows are centred on one (the rest lie
+ * in the empty margin around the data, and so are guaranteed to miss).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#define GEN_LON 144.90        // bottom left of the generated area
+#define GEN_LAT (-37.85)
+#define GEN_EXTENT 0.10       // side of the generated area, in degrees
+#define GEN_MARGIN 0.01       // empty margin around the area, for misses
+#define GEN_SEGMENT 0.001     // maximum footpath length, in degrees
+#define GEN_STREETS 200       // number of street centres when clustered
+#define GEN_SPREAD 0.002      // standard deviation around a street centre
+#define GEN_CROSSINGS 500     // number of shared intersections
+#define GEN_TWIN 1e-12        // offset of an intersection's near twin
+#define METRES_PER_DEGREE 111000.0
+#define GEN_PI 3.14159265358979323846
+#define MAX_PATH_LEN 512
+
+enum distribution {UNIFORM, CLUSTER, DUPLICATE};
+
+// a generated location
+typedef struct location {
+    double lon;
+    double lat;
+} location_t;
+
+static char* suburbs[] = {"Carlton", "East Melbourne", "Melbourne, CBD",
+                          "North Melbourne", "Parkville", "West Melbourne, Residential"};
+static char* sides[] = {"", "East", "North", "South", "West"};
+static char* streets[] = {"Swanston", "Elizabeth", "Lygon", "Queen", "Russell",
+                          "Victoria", "Drummond", "Rathdowne", "Spring", "Flinders"};
+static int statuses[] = {0, 1, 2, 3, 6, 9};
+
+/* uniformly distributed double in [0, 1) */
+double uniform();
+/* normally distributed double, mean 0 and standard deviation 1 */
+double gaussian();
+/* clamp a location to the generated area */
+location_t clamp(location_t loc);
+/* a footpath's start and end locations, by distribution */
+void generate_segment(enum distribution dist, location_t* centres,
+                      location_t* start, location_t* end);
+/* write a single footpath row */
+void write_row(FILE* f, int id, location_t start, location_t end);
+/* open a file for writing, exiting with an error if it cannot be */
+FILE* open_output(char* path);
+/* print usage and exit */
+void usage(char* prog);
+
+
+int main(int argc, char** argv) {
+    long rows = 0, queries = 1000;
+    double hit_rate = 0.5, window = 0.005;
+    unsigned seed = 20003;
+    enum distribution dist = UNIFORM;
+    char* prefix = NULL;
+    for (int i=1; i < argc; i++) {
+        if (i+1 == argc) usage(argv[0]);
+        if (strcmp(argv[i], "-n") == 0) rows = atol(argv[++i]);
+        else if (strcmp(argv[i], "-o") == 0) prefix = argv[++i];
+        else if (strcmp(argv[i], "-s") == 0) seed = (unsigned) atol(argv[++i]);
+        else if (strcmp(argv[i], "-q") == 0) queries = atol(argv[++i]);
+        else if (strcmp(argv[i], "-r") == 0) hit_rate = atof(argv[++i]);
+        else if (strcmp(argv[i], "-w") == 0) window = atof(argv[++i]);
+        else if (strcmp(argv[i], "-d") == 0) {
+            i++;
+            if (strcmp(argv[i], "uniform") == 0) dist = UNIFORM;
+            else if (strcmp(argv[i], "cluster") == 0) dist = CLUSTER;
+            else if (strcmp(argv[i], "duplicate") == 0) dist = DUPLICATE;
+            else usage(argv[0]);
+        }
+        else usage(argv[0]);
+    }
+    if (rows <= 0 || prefix == NULL || hit_rate < 0 || hit_rate > 1) usage(argv[0]);
+    srand(seed);
+
+    // street centres, or intersections in pairs of near twins
+    int ncentres = (dist == CLUSTER) ? GEN_STREETS : GEN_CROSSINGS;
+    location_t* centres = (location_t*) malloc(sizeof(location_t) * ncentres);
+    for (int i=0; i < ncentres; i++) {
+        centres[i].lon = GEN_LON + uniform() * GEN_EXTENT;
+        centres[i].lat = GEN_LAT + uniform() * GEN_EXTENT;
+        if (dist == DUPLICATE && i % 2) {
+            centres[i].lon = centres[i-1].lon + GEN_TWIN;
+            centres[i].lat = centres[i-1].lat + GEN_TWIN;
+        }
+    }
+
+    // footpaths; end points are kept for the queries, sampled by reservoir
+    char path[MAX_PATH_LEN];
+    snprintf(path, MAX_PATH_LEN, "%s.csv", prefix);
+    FILE* csv = open_output(path);
+    fprintf(csv, "footpath_id,address,clue_sa,asset_type,deltaz,distance,grade1in,"
+                 "mcc_id,mccid_int,rlmax,rlmin,segside,statusid,streetid,"
+                 "street_group,start_lat,start_lon,end_lat,end_lon\n");
+    long nsample = (queries < rows) ? queries : rows;
+    location_t* sample = (location_t*) malloc(sizeof(location_t) * (nsample ? nsample : 1));
+    location_t start, end;
+    for (long i=0; i < rows; i++) {
+        generate_segment(dist, centres, &start, &end);
+        write_row(csv, (int) i + 1, start, end);
+        long slot = (i < nsample) ? i : (long) (uniform() * (i+1));
+        if (slot < nsample) sample[slot] = (uniform() < 0.5) ? start : end;
+    }
+    fclose(csv);
+
+    // stage 3 point queries
+    snprintf(path, MAX_PATH_LEN, "%s.s3.in", prefix);
+    FILE* s3 = open_output(path);
+    for (long i=0; i < queries; i++) {
+        location_t loc = sample[i % nsample];
+        // a miss is nudged off its footpath by far more than the data's precision
+        if (uniform() >= hit_rate) {
+            loc.lon += (uniform() + 0.5) * 1e-7;
+            loc.lat += (uniform() + 0.5) * 1e-7;
+        }
+        fprintf(s3, "%.17g %.17g\n", loc.lon, loc.lat);
+    }
+    fclose(s3);
+
+    // stage 4 range queries
+    snprintf(path, MAX_PATH_LEN, "%s.s4.in", prefix);
+    FILE* s4 = open_output(path);
+    for (long i=0; i < queries; i++) {
+        location_t c = sample[i % nsample];
+        double w = (window < GEN_MARGIN) ? window : GEN_MARGIN;
+        // a miss slides the window into the empty margin left of the area
+        if (uniform() >= hit_rate)
+            c.lon = GEN_LON - GEN_MARGIN/2;
+        fprintf(s4, "%.6f %.6f %.6f %.6f\n", c.lon - w/2, c.lat - w/2,
+                c.lon + w/2, c.lat + w/2);
+    }
+    fclose(s4);
+
+    // outer square covering both the data and the margin
+    printf("%.6f %.6f %.6f %.6f\n", GEN_LON - GEN_MARGIN, GEN_LAT - GEN_MARGIN,
+           GEN_LON + GEN_EXTENT + GEN_MARGIN, GEN_LAT + GEN_EXTENT + GEN_MARGIN);
+    free(sample);
+    free(centres);
+    return 0;
+}
+
+/* a footpath's start and end locations */
+void generate_segment(enum distribution dist, location_t* centres,
+                      location_t* start, location_t* end) {
+    double angle = uniform() * 2 * GEN_PI, length = uniform() * GEN_SEGMENT;
+    if (dist == UNIFORM) {
+        start->lon = GEN_LON + uniform() * GEN_EXTENT;
+        start->lat = GEN_LAT + uniform() * GEN_EXTENT;
+    }
+    else if (dist == CLUSTER) {
+        // streets run either east-west or north-south through their centre
+        location_t c = centres[rand() % GEN_STREETS];
+        int eastwest = rand() % 2;
+        double along = gaussian() * GEN_SPREAD, across = gaussian() * GEN_SPREAD / 20;
+        start->lon = c.lon + (eastwest ? along : across);
+        start->lat = c.lat + (eastwest ? across : along);
+        angle = eastwest ? 0 : GEN_PI / 2;
+    }
+    else {
+        // every footpath runs between 2 shared intersections
+        *start = centres[rand() % GEN_CROSSINGS];
+        *end = centres[rand() % GEN_CROSSINGS];
+        return;
+    }
+    *start = clamp(*start);
+    end->lon = start->lon + cos(angle) * length;
+    end->lat = start->lat + sin(angle) * length;
+    *end = clamp(*end);
+}
+
+/* write a single footpath row, with plausible attributes */
+void write_row(FILE* f, int id, location_t start, location_t end) {
+    double dlon = end.lon - start.lon, dlat = end.lat - start.lat;
+    double distance = sqrt(dlon*dlon + dlat*dlat) * METRES_PER_DEGREE;
+    double rlmin = 10 + uniform() * 30, deltaz = uniform() * 5;
+    double grade = (deltaz > 0.01) ? distance / deltaz : 0;
+    char* suburb = suburbs[rand() % 6];
+    char* side = sides[rand() % 5];
+    int streetid = rand() % 1500;
+    int status = statuses[rand() % 6];
+    // some footpaths have no address, as in the real datasets
+    if (rand() % 4) {
+        fprintf(f, "%d,%s Street between %s Street and %s Street,", id,
+                streets[rand() % 10], streets[rand() % 10], streets[rand() % 10]);
+    }
+    else fprintf(f, "%d,,", id);
+    // quoted when the suburb contains a comma
+    if (strchr(suburb, ',')) fprintf(f, "\"%s\",", suburb);
+    else fprintf(f, "%s,", suburb);
+    fprintf(f, "Road Footway,%.2f,%.2f,%.1f,%d.0,%d.0,%.2f,%.2f,%s,%d.0,%d.0,%d.0,"
+               "%.17g,%.17g,%.17g,%.17g\n",
+            deltaz, distance, grade, 1380000 + rand() % 90000,
+            (rand() % 3) ? 20000 + rand() % 3000 : 0, rlmin + deltaz, rlmin, side,
+            status, streetid, 15000 + rand() % 15000,
+            start.lat, start.lon, end.lat, end.lon);
+}
+
+/* clamp a location to the generated area */
+location_t clamp(location_t loc) {
+    if (loc.lon < GEN_LON) loc.lon = GEN_LON;
+    if (loc.lon > GEN_LON + GEN_EXTENT) loc.lon = GEN_LON + GEN_EXTENT;
+    if (loc.lat < GEN_LAT) loc.lat = GEN_LAT;
+    if (loc.lat > GEN_LAT + GEN_EXTENT) loc.lat = GEN_LAT + GEN_EXTENT;
+    return loc;
+}
+
+/* uniformly distributed double in [0, 1) */
+double uniform() {
+    return rand() / (RAND_MAX + 1.0);
+}
+
+/* normally distributed double, by the Box-Muller transform */
+double gaussian() {
+    double u = uniform(), v = uniform();
+    return sqrt(-2 * log(1 - u)) * cos(2 * GEN_PI * v);
+}
+
+/* open a file for writing, exiting with an error if it cannot be */
+FILE* open_output(char* path) {
+    FILE* file = fopen(path, "w");
+    if (file == NULL) {
+        fprintf(stderr, "ERROR: cannot write %s\n", path);
+        exit(EXIT_FAILURE);
+    }
+    return file;
+}
+
+/* print usage and exit */
+void usage(char* prog) {
+    fprintf(stderr, "Usage: %s -n ROWS -o PREFIX [-d uniform|cluster|duplicate] "
+                    "[-s SEED] [-q QUERIES] [-r HIT_RATE] [-w WINDOW]\n", prog);
+    exit(EXIT_FAILURE);
+}